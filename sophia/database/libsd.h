@@ -13,13 +13,17 @@
 #include <sd_pageiter.h>
 #include <sd_index.h>
 #include <sd_indexiter.h>
+#include <sd_bloom.h>
 #include <sd_build.h>
 #include <sd_buildindex.h>
+#include <sd_pipe.h>
 #include <sd_merge.h>
 #include <sd_iter.h>
 #include <sd_scheme.h>
 #include <sd_schemeiter.h>
 #include <sd_io.h>
+#include <sd_pagecache.h>
+#include <sd_readahead.h>
 #include <sd_read.h>
 #include <sd_write.h>
 #include <sd_c.h>
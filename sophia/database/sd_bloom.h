@@ -0,0 +1,111 @@
+#ifndef SD_BLOOM_H_
+#define SD_BLOOM_H_
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+/* node bloom filter.
+ *
+ * Stored in the index key area right after the page
+ * min/max keys: [keys][filter][sdbloom]. Files without
+ * a filter have no bytes past the last page key.
+*/
+
+typedef struct sdbloom sdbloom;
+
+struct sdbloom {
+	uint32_t size;
+	uint32_t hashes;
+	uint32_t keys;
+} sspacked;
+
+static inline uint32_t
+sd_bloomhash(sfscheme *s, char *data)
+{
+	uint32_t h = 2166136261U;
+	int pos = 0;
+	while (pos < s->keys_count) {
+		uint32_t size;
+		unsigned char *p =
+			(unsigned char*)sf_fieldptr(s, s->keys[pos], data, &size);
+		unsigned char *end = p + size;
+		while (p < end) {
+			h = (h ^ *p) * 16777619U;
+			p++;
+		}
+		pos++;
+	}
+	return h;
+}
+
+static inline uint32_t
+sd_bloomhashes(uint32_t bits_per_key)
+{
+	/* k = bits_per_key * ln(2) */
+	uint32_t k = (bits_per_key * 69) / 100;
+	if (k < 1)
+		k = 1;
+	if (k > 30)
+		k = 30;
+	return k;
+}
+
+static inline char*
+sd_bloombits(sdbloom *b) {
+	return (char*)b - b->size;
+}
+
+static inline void
+sd_bloomset(char *bits, uint32_t size, uint32_t hashes, uint32_t h)
+{
+	uint32_t nbits = size * 8;
+	uint32_t delta = (h >> 17) | (h << 15);
+	uint32_t i = 0;
+	while (i < hashes) {
+		uint32_t pos = h % nbits;
+		bits[pos / 8] |= (1 << (pos % 8));
+		h += delta;
+		i++;
+	}
+}
+
+static inline int
+sd_bloomhas(sdbloom *b, uint32_t h)
+{
+	char *bits = sd_bloombits(b);
+	uint32_t nbits = b->size * 8;
+	uint32_t delta = (h >> 17) | (h << 15);
+	uint32_t i = 0;
+	while (i < b->hashes) {
+		uint32_t pos = h % nbits;
+		if ((bits[pos / 8] & (1 << (pos % 8))) == 0)
+			return 0;
+		h += delta;
+		i++;
+	}
+	return 1;
+}
+
+static inline sdbloom*
+sd_indexbloom(sdindex *i)
+{
+	sdindexheader *h = i->h;
+	if (ssunlikely(h == NULL || h->count == 0))
+		return NULL;
+	sdindexpage *last = sd_indexmax(i);
+	uint32_t keys = last->offsetindex + last->sizemin + last->sizemax;
+	uint32_t area = h->size - (h->count * sizeof(sdindexpage));
+	if (sslikely(area - keys < sizeof(sdbloom)))
+		return NULL;
+	sdbloom *b = (sdbloom*)(i->i.s + area - sizeof(sdbloom));
+	if (ssunlikely(b->size == 0 || b->size + sizeof(sdbloom) != area - keys))
+		return NULL;
+	return b;
+}
+
+#endif
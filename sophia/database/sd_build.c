@@ -63,7 +63,7 @@ int sd_buildbegin(sdbuild *b, sr *r, int crc,
 	h->lsnmin    = UINT64_MAX;
 	h->lsnmindup = UINT64_MAX;
 	h->tsmin     = UINT32_MAX;
-	h->reserve   = 0;
+	h->flags     = SD_PAGEPLAIN;
 	ss_bufadvance(&b->m, sizeof(sdpageheader));
 	return 0;
 }
@@ -110,6 +110,8 @@ int sd_buildadd(sdbuild *b, sr *r, char *v, uint8_t flags)
 		h->lsnmax = lsn;
 	if (lsn < h->lsnmin)
 		h->lsnmin = lsn;
+	if (flags & (SVDELETE|SVUPSERT))
+		h->flags &= ~SD_PAGEPLAIN;
 	if (flags & SVDUP) {
 		h->countdup++;
 		if (lsn < h->lsnmindup)
@@ -123,6 +125,39 @@ int sd_buildadd(sdbuild *b, sr *r, char *v, uint8_t flags)
 	return 0;
 }
 
+int sd_buildcopy(sdbuild *b, sr *r, sdpage *page, char *raw)
+{
+	/* take a page as it is written on disk, decoded
+	 * page is used only to update the node index */
+	sdpageheader *h = page->h;
+	uint32_t size = sizeof(sdpageheader);
+	if (! sf_schemefixed(r->scheme))
+		size += sizeof(uint32_t) * h->count;
+	int rc = ss_bufadd(&b->m, r->a, h, size);
+	if (ssunlikely(rc == -1))
+		return sr_oom(r->e);
+	rc = ss_bufadd(&b->v, r->a, (char*)h + size,
+	               sizeof(sdpageheader) + h->sizeorigin - size);
+	if (ssunlikely(rc == -1))
+		return sr_oom(r->e);
+	/* compressed image */
+	if (raw != (char*)h) {
+		rc = ss_bufadd(&b->c, r->a, raw, sizeof(sdpageheader) + h->size);
+		if (ssunlikely(rc == -1))
+			return sr_oom(r->e);
+	}
+	uint32_t pos = 0;
+	while (pos < h->count) {
+		uint32_t vsize = sf_size(r->scheme, sd_pagepointer(page, r, pos));
+		if (! sf_schemefixed(r->scheme))
+			vsize += sizeof(uint32_t);
+		if (vsize > b->vmax)
+			b->vmax = vsize;
+		pos++;
+	}
+	return 0;
+}
+
 static inline int
 sd_buildcompress(sdbuild *b, sr *r)
 {
@@ -49,5 +49,6 @@ sd_buildmax(sdbuild *b, sr *r)
 int sd_buildbegin(sdbuild*, sr*, int, int, ssfilterif*);
 int sd_buildend(sdbuild*, sr*);
 int sd_buildadd(sdbuild*, sr*, char*, uint8_t);
+int sd_buildcopy(sdbuild*, sr*, sdpage*, char*);
 
 #endif
@@ -17,24 +17,29 @@ void sd_buildindex_init(sdbuildindex *i)
 {
 	ss_bufinit(&i->v);
 	ss_bufinit(&i->m);
+	ss_bufinit(&i->hash);
+	i->bloom_bits = 0;
 }
 
 void sd_buildindex_free(sdbuildindex *i, sr *r)
 {
 	ss_buffree(&i->v, r->a);
 	ss_buffree(&i->m, r->a);
+	ss_buffree(&i->hash, r->a);
 }
 
 void sd_buildindex_reset(sdbuildindex *i)
 {
 	ss_bufreset(&i->v);
 	ss_bufreset(&i->m);
+	ss_bufreset(&i->hash);
 }
 
 void sd_buildindex_gc(sdbuildindex *i, sr *r, int wm)
 {
 	ss_bufgc(&i->v, r->a, wm);
 	ss_bufgc(&i->m, r->a, wm);
+	ss_bufgc(&i->hash, r->a, wm);
 }
 
 int sd_buildindex_begin(sdbuildindex *i)
@@ -58,8 +63,45 @@ int sd_buildindex_begin(sdbuildindex *i)
 	return 0;
 }
 
+static inline int
+sd_buildindex_bloom(sdbuildindex *i, sr *r)
+{
+	uint32_t keys = ss_bufused(&i->hash) / sizeof(uint32_t);
+	uint64_t nbits = (uint64_t)keys * i->bloom_bits;
+	if (nbits < 64)
+		nbits = 64;
+	uint32_t size = (nbits + 7) / 8;
+	int rc = ss_bufensure(&i->v, r->a, size + sizeof(sdbloom));
+	if (ssunlikely(rc == -1))
+		return sr_oom(r->e);
+	sdbloom b = {
+		.size   = size,
+		.hashes = sd_bloomhashes(i->bloom_bits),
+		.keys   = keys
+	};
+	char *bits = i->v.p;
+	memset(bits, 0, size);
+	uint32_t *hash = (uint32_t*)i->hash.s;
+	uint32_t pos = 0;
+	while (pos < keys) {
+		sd_bloomset(bits, size, b.hashes, hash[pos]);
+		pos++;
+	}
+	ss_bufadvance(&i->v, size);
+	memcpy(i->v.p, &b, sizeof(b));
+	ss_bufadvance(&i->v, sizeof(b));
+	i->build.size += size + sizeof(sdbloom);
+	return 0;
+}
+
 int sd_buildindex_end(sdbuildindex *i, sr *r, uint32_t align, uint64_t offset)
 {
+	/* bloom filter */
+	if (i->bloom_bits && ss_bufused(&i->hash) > 0) {
+		int rc = sd_buildindex_bloom(i, r);
+		if (ssunlikely(rc == -1))
+			return -1;
+	}
 	/* calculate index align for direct_io */
 	int size_meta  = sizeof(sdindexheader);
 	int size_align = 0;
@@ -88,6 +130,32 @@ int sd_buildindex_end(sdbuildindex *i, sr *r, uint32_t align, uint64_t offset)
 	return 0;
 }
 
+static inline int
+sd_buildindex_hash(sdbuildindex *i, sr *r, sdbuild *b)
+{
+	sdpageheader *ph = sd_buildheader(b);
+	int rc = ss_bufensure(&i->hash, r->a, ph->count * sizeof(uint32_t));
+	if (ssunlikely(rc == -1))
+		return sr_oom(r->e);
+	uint32_t *offset = (uint32_t*)(b->m.s + sizeof(sdpageheader));
+	uint32_t pos = 0;
+	while (pos < ph->count) {
+		char *v;
+		if (sf_schemefixed(r->scheme))
+			v = b->v.s + (r->scheme->var_offset * pos);
+		else
+			v = b->v.s + offset[pos];
+		pos++;
+		/* older versions share the key hash */
+		if (sf_flags(r->scheme, v) & SVDUP)
+			continue;
+		uint32_t hash = sd_bloomhash(r->scheme, v);
+		memcpy(i->hash.p, &hash, sizeof(hash));
+		ss_bufadvance(&i->hash, sizeof(hash));
+	}
+	return 0;
+}
+
 int sd_buildindex_add(sdbuildindex *i, sr *r, sdbuild *b, uint64_t offset)
 {
 	int rc = ss_bufensure(&i->m, r->a, sizeof(sdindexpage));
@@ -109,6 +177,14 @@ int sd_buildindex_add(sdbuildindex *i, sr *r, sdbuild *b, uint64_t offset)
 	p->sizemin     = 0;
 	p->sizemax     = 0;
 
+	/* bloom filter hashes, custom comparator can
+	 * match keys with different bytes */
+	if (i->bloom_bits && ph->count > 0 && r->scheme->cmp == NULL) {
+		rc = sd_buildindex_hash(i, r, b);
+		if (ssunlikely(rc == -1))
+			return -1;
+	}
+
 	/* copy keys */
 	if (ssunlikely(ph->count > 0)) {
 		char *min = sd_buildmin(b, r);
@@ -13,6 +13,8 @@ typedef struct sdbuildindex sdbuildindex;
 
 struct sdbuildindex {
 	ssbuf         v, m;
+	ssbuf         hash;
+	uint32_t      bloom_bits;
 	sdindexheader build;
 };
 
@@ -13,10 +13,11 @@ typedef struct sdcbuf sdcbuf;
 typedef struct sdc sdc;
 
 struct sdcbuf {
-	ssbuf  a; /* decompression */
-	ssbuf  b; /* transformation */
-	ssiter index_iter;
-	ssiter page_iter;
+	ssbuf   a; /* decompression */
+	ssbuf   b; /* transformation */
+	ssiter  index_iter;
+	ssiter  page_iter;
+	sdcbuf *next;
 };
 
 struct sdc {
@@ -29,8 +30,62 @@ struct sdc {
 	ssbuf  c; /* file buffer */
 	ssbuf  d; /* page read buffer */
 	sdcbuf e; /* compression buffer list */
+	int    count;
+	sdpipe *pipe;
 };
 
+static inline void
+sd_cbufinit(sdcbuf *b)
+{
+	ss_bufinit(&b->a);
+	ss_bufinit(&b->b);
+	memset(&b->index_iter, 0, sizeof(b->index_iter));
+	memset(&b->page_iter, 0, sizeof(b->page_iter));
+	b->next = NULL;
+}
+
+static inline int
+sd_censure(sdc *c, sr *r, int count)
+{
+	/* buffers of additional merge sources */
+	while (c->count < count) {
+		sdcbuf *b = ss_malloc(r->a, sizeof(sdcbuf));
+		if (ssunlikely(b == NULL))
+			return -1;
+		sd_cbufinit(b);
+		b->next = c->e.next;
+		c->e.next = b;
+		c->count++;
+	}
+	return 0;
+}
+
+static inline sdpipe*
+sd_cpipe(sdc *c, sr *r, int threads)
+{
+	/* compression pipeline is started once and
+	 * reused by the following merges */
+	if (c->pipe && c->pipe->threads_count != threads) {
+		sd_pipefree(c->pipe);
+		ss_free(r->a, c->pipe);
+		c->pipe = NULL;
+	}
+	if (c->pipe) {
+		sd_pipereset(c->pipe, r);
+		return c->pipe;
+	}
+	sdpipe *pipe = ss_malloc(r->a, sizeof(sdpipe));
+	if (ssunlikely(pipe == NULL))
+		return NULL;
+	int rc = sd_pipeinit(pipe, r, threads);
+	if (ssunlikely(rc == -1)) {
+		ss_free(r->a, pipe);
+		return NULL;
+	}
+	c->pipe = pipe;
+	return pipe;
+}
+
 static inline void
 sd_cinit(sdc *sc)
 {
@@ -42,10 +97,9 @@ sd_cinit(sdc *sc)
 	ss_bufinit(&sc->b);
 	ss_bufinit(&sc->c);
 	ss_bufinit(&sc->d);
-	ss_bufinit(&sc->e.a);
-	ss_bufinit(&sc->e.b);
-	memset(&sc->e.index_iter, 0, sizeof(sc->e.index_iter));
-	memset(&sc->e.page_iter, 0, sizeof(sc->e.page_iter));
+	sd_cbufinit(&sc->e);
+	sc->count = 0;
+	sc->pipe = NULL;
 }
 
 static inline void
@@ -59,8 +113,22 @@ sd_cfree(sdc *sc, sr *r)
 	ss_buffree(&sc->b, r->a);
 	ss_buffree(&sc->c, r->a);
 	ss_buffree(&sc->d, r->a);
-	ss_buffree(&sc->e.a, r->a);
-	ss_buffree(&sc->e.b, r->a);
+	sdcbuf *b = &sc->e;
+	while (b) {
+		sdcbuf *next = b->next;
+		ss_buffree(&b->a, r->a);
+		ss_buffree(&b->b, r->a);
+		if (b != &sc->e)
+			ss_free(r->a, b);
+		b = next;
+	}
+	sc->e.next = NULL;
+	sc->count = 0;
+	if (sc->pipe) {
+		sd_pipefree(sc->pipe);
+		ss_free(r->a, sc->pipe);
+		sc->pipe = NULL;
+	}
 }
 
 static inline void
@@ -73,8 +141,12 @@ sd_cgc(sdc *sc, sr *r, int wm)
 	ss_bufgc(&sc->b, r->a, wm);
 	ss_bufgc(&sc->c, r->a, wm);
 	ss_bufgc(&sc->d, r->a, wm);
-	ss_bufgc(&sc->e.a, r->a, wm);
-	ss_bufgc(&sc->e.b, r->a, wm);
+	sdcbuf *b = &sc->e;
+	while (b) {
+		ss_bufgc(&b->a, r->a, wm);
+		ss_bufgc(&b->b, r->a, wm);
+		b = b->next;
+	}
 }
 
 static inline void
@@ -88,8 +160,12 @@ sd_creset(sdc *sc, sr *r ssunused)
 	ss_bufreset(&sc->b);
 	ss_bufreset(&sc->c);
 	ss_bufreset(&sc->d);
-	ss_bufreset(&sc->e.a);
-	ss_bufreset(&sc->e.b);
+	sdcbuf *b = &sc->e;
+	while (b) {
+		ss_bufreset(&b->a);
+		ss_bufreset(&b->b);
+		b = b->next;
+	}
 }
 
 #endif
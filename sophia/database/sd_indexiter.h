@@ -23,14 +23,14 @@ struct sdindexiter {
 static inline int
 sd_indexiter_route(sdindexiter *i)
 {
+	sfsearch s;
+	sf_searchinit(&s, i->r->scheme, i->key);
 	int begin = 0;
 	int end = i->index->h->count - 1;
 	while (begin != end) {
 		int mid = begin + (end - begin) / 2;
 		sdindexpage *page = sd_indexpage(i->index, mid);
-		int rc = sf_compare(i->r->scheme,
-		                    sd_indexpage_max(i->index, page),
-		                    i->key);
+		int rc = sf_searchcmp(&s, sd_indexpage_max(i->index, page));
 		if (rc < 0) {
 			begin = mid + 1;
 		} else {
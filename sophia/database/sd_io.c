@@ -121,6 +121,23 @@ int sd_iowrite(sdio *s, sr *r, ssfile *f, char *buf, int size)
 	return 0;
 }
 
+static inline uint32_t
+sd_ioalign(sdio *s, uint64_t *offset, int *size)
+{
+	/* calculate aligned offset and size, returns position
+	 * of the data inside the aligned block */
+	if (! s->direct)
+		return 0;
+	uint32_t page_size = s->size_page;
+	uint32_t offset_align = *offset % page_size;
+	*offset -= offset_align;
+	*size   += offset_align;
+	uint32_t size_align = *size % page_size;
+	if (size_align > 0)
+		*size += page_size - size_align;
+	return offset_align;
+}
+
 static inline int
 sd_ioread_direct(sdio *s, sr *r, ssfile *f, uint64_t offset,
                  char *buf, int size, int from_compaction,
@@ -132,14 +149,7 @@ sd_ioread_direct(sdio *s, sr *r, ssfile *f, uint64_t offset,
 	char *buf_aligned =
 		(char*)((((intptr_t)buf + page_size - 1) / page_size) * page_size);
 
-	/* calculate aligned offset and size */
-	uint64_t offset_align = offset % page_size;
-	offset -= offset_align;
-	size   += offset_align;
-	uint64_t size_align   = size % page_size;
-	if (size_align > 0) {
-		size += page_size - size % page_size;
-	}
+	uint32_t offset_align = sd_ioalign(s, &offset, &size);
 
 	/* read */
 	uint64_t start = ss_utime();
@@ -177,3 +187,139 @@ int sd_ioread(sdio *s, sr *r, ssfile *f, uint64_t offset,
 	*buf_align = buf;
 	return 0;
 }
+
+void sd_iobatch_init(sdiobatch *b)
+{
+	ss_bufinit(&b->req);
+	ss_bufinit(&b->data);
+	b->count = 0;
+}
+
+void sd_iobatch_free(sdiobatch *b, sr *r)
+{
+	ss_buffree(&b->req, r->a);
+	ss_buffree(&b->data, r->a);
+	b->count = 0;
+}
+
+void sd_iobatch_reset(sdiobatch *b)
+{
+	ss_bufreset(&b->req);
+	b->count = 0;
+}
+
+int sd_iobatch_add(sdiobatch *b, sr *r, ssfile *file, uint64_t offset, int size)
+{
+	sdioreq req = {
+		.file   = file,
+		.offset = offset,
+		.size   = size,
+		.page   = NULL
+	};
+	int rc = ss_bufadd(&b->req, r->a, &req, sizeof(req));
+	if (ssunlikely(rc == -1))
+		return sr_oom(r->e);
+	b->count++;
+	return 0;
+}
+
+static inline int
+sd_iobatch_cmp(sdioreq *a, int fd, uint64_t offset)
+{
+	if (a->file->fd != fd)
+		return (a->file->fd > fd) ? 1 : -1;
+	if (a->offset == offset)
+		return 0;
+	return (a->offset > offset) ? 1 : -1;
+}
+
+static int
+sd_iobatch_sortcmp(const void *p1, const void *p2)
+{
+	sdioreq *b = (sdioreq*)p2;
+	return sd_iobatch_cmp((sdioreq*)p1, b->file->fd, b->offset);
+}
+
+sdioreq *sd_iobatch_match(sdiobatch *b, ssfile *file, uint64_t offset)
+{
+	sdioreq *req = (sdioreq*)b->req.s;
+	int min = 0;
+	int max = b->count - 1;
+	while (max >= min) {
+		int mid = min + ((max - min) >> 1);
+		int rc = sd_iobatch_cmp(&req[mid], file->fd, offset);
+		if (rc == 0)
+			return (req[mid].page) ? &req[mid] : NULL;
+		if (rc > 0)
+			max = mid - 1;
+		else
+			min = mid + 1;
+	}
+	return NULL;
+}
+
+int sd_iobatch_read(sdiobatch *b, sdio *s, sr *r, int from_compaction)
+{
+	if (ssunlikely(b->count == 0))
+		return 0;
+	sdioreq *req = (sdioreq*)b->req.s;
+	qsort(req, b->count, sizeof(sdioreq), sd_iobatch_sortcmp);
+
+	/* every request gets its own buffer, aligned
+	 * for direct_io */
+	uint32_t page_size = (s->direct) ? s->size_page : 8;
+	uint64_t size = sizeof(ssvfsio) * b->count + page_size;
+	int k = 0;
+	while (k < b->count) {
+		uint64_t offset = req[k].offset;
+		int len = req[k].size;
+		sd_ioalign(s, &offset, &len);
+		size += (len + 7) & ~7;
+		k++;
+	}
+	ss_bufreset(&b->data);
+	int rc = ss_bufensure(&b->data, r->a, size);
+	if (ssunlikely(rc == -1))
+		return sr_oom(r->e);
+	ssvfsio *io = (ssvfsio*)b->data.s;
+	char *p = b->data.s + sizeof(ssvfsio) * b->count;
+	p = (char*)((((intptr_t)p + page_size - 1) / page_size) * page_size);
+	k = 0;
+	while (k < b->count) {
+		uint64_t offset = req[k].offset;
+		int len = req[k].size;
+		uint32_t offset_align = sd_ioalign(s, &offset, &len);
+		io[k].fd     = req[k].file->fd;
+		io[k].offset = offset;
+		io[k].buf    = p;
+		io[k].size   = len;
+		io[k].rc     = 0;
+		req[k].page  = p + offset_align;
+		p += (len + 7) & ~7;
+		k++;
+	}
+
+	/* all requests are queued at once */
+	ssvfs *vfs = req[0].file->vfs;
+	uint64_t start = ss_utime();
+	rc = ss_vfspread_batch(vfs, io, b->count);
+	if (ssunlikely(rc == -1)) {
+		int error = errno;
+		k = 0;
+		while (io[k].rc == io[k].size && k < b->count - 1)
+			k++;
+		sr_error(r->e, "db file '%s' read error: %s",
+		         ss_pathof(&req[k].file->path),
+		         strerror(error));
+		k = 0;
+		while (k < b->count)
+			req[k++].page = NULL;
+		return -1;
+	}
+	k = 0;
+	while (k < b->count) {
+		sr_statpread(r->stat, start, from_compaction);
+		k++;
+	}
+	return 0;
+}
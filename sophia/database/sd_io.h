@@ -10,6 +10,8 @@
 */
 
 typedef struct sdio sdio;
+typedef struct sdioreq sdioreq;
+typedef struct sdiobatch sdiobatch;
 
 struct sdio {
 	ssbuf    buf;
@@ -18,6 +20,22 @@ struct sdio {
 	uint32_t size_align;
 };
 
+/* page read request of a batch, page points to the
+ * page data once the batch is complete */
+
+struct sdioreq {
+	ssfile  *file;
+	uint64_t offset;
+	int      size;
+	char    *page;
+};
+
+struct sdiobatch {
+	ssbuf req;
+	ssbuf data;
+	int   count;
+};
+
 static inline uint64_t
 sd_iosize(sdio *s, ssfile *f) {
 	return f->size + (ss_bufused(&s->buf) - s->size_align);
@@ -31,4 +49,11 @@ int sd_ioflush(sdio*, sr*, ssfile*);
 int sd_iowrite(sdio*, sr*, ssfile*, char*, int);
 int sd_ioread(sdio*, sr*, ssfile*, uint64_t, char*, int, int, char**);
 
+void     sd_iobatch_init(sdiobatch*);
+void     sd_iobatch_free(sdiobatch*, sr*);
+void     sd_iobatch_reset(sdiobatch*);
+int      sd_iobatch_add(sdiobatch*, sr*, ssfile*, uint64_t, int);
+int      sd_iobatch_read(sdiobatch*, sdio*, sr*, int);
+sdioreq *sd_iobatch_match(sdiobatch*, ssfile*, uint64_t);
+
 #endif
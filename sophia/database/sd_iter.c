@@ -148,6 +148,94 @@ ssiterif sd_iter =
 	sr_errorreset(ri->r->e);
 #endif
 
+static inline int
+sd_iter_valid(sr *r, char *start, sdindexheader *h)
+{
+	uint64_t pos = (char*)h - start;
+	if (h->offset >= pos || (pos - h->offset) != (uint64_t)h->align + h->size)
+		return 0;
+	uint32_t crc = ss_crcs(r->crc, h, sizeof(sdindexheader), 0);
+	return h->crc == crc;
+}
+
+static inline int
+sd_iter_header(sr *r, char *start, uint64_t run, uint64_t pos)
+{
+	/* header at pos closes the run started at run */
+	sdindexheader *h = (sdindexheader*)(start + pos);
+	if (h->offset >= pos || h->offset < run)
+		return 0;
+	if ((pos - h->offset) != (uint64_t)h->align + h->size)
+		return 0;
+	if ((h->offset - run) != h->total)
+		return 0;
+	uint32_t crc = ss_crcs(r->crc, h, sizeof(sdindexheader), 0);
+	return h->crc == crc;
+}
+
+static inline uint64_t
+sd_iter_end(sr *r, char *start, uint64_t size)
+{
+	/* walk runs from the file start, only positions
+	 * which close the current run are checked */
+	uint64_t end = 0;
+	uint64_t pos = 0;
+	while (pos + sizeof(sdindexheader) <= size) {
+		if (sd_iter_header(r, start, end, pos)) {
+			pos += sizeof(sdindexheader);
+			end = pos;
+			continue;
+		}
+		pos++;
+	}
+	return end;
+}
+
+int sd_iter_truncate(sr *r, ssfile *file)
+{
+	/* drop the tail of a file left by an interrupted
+	 * run append, up to the end of the last complete run */
+	if (ssunlikely(file->size < sizeof(sdindexheader)))
+		return 0;
+	ssmmap map;
+	int rc = ss_vfsmmap(r->vfs, &map, file->fd, file->size, 1);
+	if (ssunlikely(rc == -1)) {
+		sr_malfunction(r->e, "failed to mmap db file '%s': %s",
+		               ss_pathof(&file->path),
+		               strerror(errno));
+		return -1;
+	}
+	uint64_t pos = file->size - sizeof(sdindexheader);
+	uint64_t end = file->size;
+	if (! sd_iter_valid(r, map.p, (sdindexheader*)(map.p + pos))) {
+		end = sd_iter_end(r, map.p, file->size);
+		/* a whole run with a bad crc is not an interrupted
+		 * append, leave it to the iterator */
+		sdindexheader *h = (sdindexheader*)(map.p + pos);
+		if (end > 0 && h->offset < pos && h->offset >= end &&
+		    (pos - h->offset) == (uint64_t)h->align + h->size &&
+		    (h->offset - end) == h->total)
+			end = 0;
+	}
+	ss_vfsmunmap(r->vfs, &map);
+	/* nothing to recover, corruption is reported
+	 * by the iterator */
+	if (sslikely(end == file->size || end == 0))
+		return 0;
+	if (r->log)
+		sr_log(r->log, "db file '%s': truncating %" PRIu64 " bytes "
+		       "of an incomplete run", ss_pathof(&file->path),
+		       file->size - end);
+	rc = ss_filerlb(file, end);
+	if (ssunlikely(rc == -1)) {
+		sr_malfunction(r->e, "db file '%s' truncate error: %s",
+		               ss_pathof(&file->path),
+		               strerror(errno));
+		return -1;
+	}
+	return 1;
+}
+
 int sd_iter_iserror(ssiter *i)
 {
 	sditer *ri = (sditer*)i->priv;
@@ -12,6 +12,7 @@
 int sd_iter_open(ssiter*, sr*, ssfile*);
 int sd_iter_iserror(ssiter*);
 int sd_iter_isroot(ssiter*);
+int sd_iter_truncate(sr*, ssfile*);
 
 extern ssiterif sd_iter;
 
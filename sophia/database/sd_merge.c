@@ -46,10 +46,30 @@ int sd_mergefree(sdmerge *m)
 	return 0;
 }
 
+static inline int
+sd_mergeresume(sdmerge *m)
+{
+	if (m->resume) {
+		m->resume = 0;
+		if (ssunlikely(! sv_writeiter_resume(&m->i)))
+			return 0;
+	}
+	return ss_iterhas(sv_writeiter, &m->i);
+}
+
+static inline int
+sd_mergeleft(sdmerge *m)
+{
+	/* pages queued for compression are written first */
+	if (m->conf->pipe && sd_pipecount(m->conf->pipe) > 0)
+		return 1;
+	return sd_mergeresume(m);
+}
+
 static inline int
 sd_mergehas(sdmerge *m)
 {
-	if (! ss_iterhas(sv_writeiter, &m->i))
+	if (! sd_mergeleft(m))
 		return 0;
 	if (m->current > m->limit)
 		return 0;
@@ -58,11 +78,12 @@ sd_mergehas(sdmerge *m)
 
 int sd_merge(sdmerge *m)
 {
-	if (ssunlikely(! ss_iterhas(sv_writeiter, &m->i)))
+	if (ssunlikely(! sd_mergeleft(m)))
 		return 0;
 	sdmergeconf *conf = m->conf;
 	sd_indexinit(&m->index);
 	sd_buildindex_reset(m->build_index);
+	m->build_index->bloom_bits = conf->bloom_bits;
 	int rc = sd_buildindex_begin(m->build_index);
 	if (ssunlikely(rc == -1))
 		return -1;
@@ -81,42 +102,145 @@ int sd_merge(sdmerge *m)
 	return sd_mergehas(m);
 }
 
-int sd_mergepage(sdmerge *m, uint64_t offset)
+static inline sdread*
+sd_mergepassthrough(sdmerge *m)
 {
+	/* a page of the source can be written as it is, if
+	 * it is not overlapped by other merge sources and
+	 * the merge would not change it */
 	sdmergeconf *conf = m->conf;
-	sd_buildreset(m->build);
-	if (m->resume) {
-		m->resume = 0;
-		if (ssunlikely(! sv_writeiter_resume(&m->i)))
-			return 0;
+	ssiter *src = conf->passthrough;
+	svmergeiter *im = (svmergeiter*)m->merge->priv;
+	if (sslikely(im->v == NULL || im->v->i != src || im->v->dup))
+		return NULL;
+	sdread *i = sd_read_pagestart(src);
+	if (sslikely(i == NULL))
+		return NULL;
+	if (sv_writeiter_is_duplicate(&m->i) ||
+	    ss_iterof(sv_writeiter, &m->i) != ss_iteratorof(src))
+		return NULL;
+	sdpageheader *h = i->page.h;
+	if (! (h->flags & SD_PAGEPLAIN))
+		return NULL;
+	if (h->countdup > 0 && h->lsnmindup <= conf->vlsn)
+		return NULL;
+	if (conf->expire > 0 && (conf->timestamp - h->tsmin) >= conf->expire)
+		return NULL;
+	if (conf->checksum && h->crcdata == 0)
+		return NULL;
+	char *max = sd_pagepointer(sd_readpage(i), m->r, h->count - 1);
+	if (im->limit && sf_compare(m->r->scheme, max, im->limit) >= 0)
+		return NULL;
+	svmergesrc *s = im->src;
+	for (; s < im->end; s = sv_mergenextof(s)) {
+		if (s == im->v)
+			continue;
+		char *v = ss_iteratorof(s->i);
+		if (v && sf_compare(m->r->scheme, v, max) <= 0)
+			return NULL;
+	}
+	return i;
+}
+
+static inline int
+sd_mergecopy(sdmerge *m, sdbuild *b, sdread *i)
+{
+	int rc = sd_buildcopy(b, m->r, sd_readpage(i), i->raw);
+	if (ssunlikely(rc == -1))
+		return -1;
+	sr_statpassthrough(m->r->stat);
+	/* continue after the page */
+	sd_read_skip(m->conf->passthrough);
+	sv_mergeiter_update(m->merge);
+	sv_writeiter_restart(&m->i);
+	return 2;
+}
+
+static inline int
+sd_mergefill(sdmerge *m, sdbuild *b)
+{
+	/* returns 2 for a complete copied page, 1 when
+	 * the page needs sd_buildend() */
+	sdmergeconf *conf = m->conf;
+	if (conf->passthrough) {
+		sdread *pass = sd_mergepassthrough(m);
+		if (pass)
+			return sd_mergecopy(m, b, pass);
 	}
-	if (! sd_mergehas(m))
-		return 0;
 	int rc;
-	rc = sd_buildbegin(m->build, m->r, conf->checksum,
+	rc = sd_buildbegin(b, m->r, conf->checksum,
 	                   conf->compression,
 	                   conf->compression_if);
 	if (ssunlikely(rc == -1))
 		return -1;
 	while (ss_iterhas(sv_writeiter, &m->i))
 	{
+		/* end the page before a page which is copied */
+		if (conf->passthrough && sd_mergepassthrough(m))
+			break;
 		char *v = ss_iterof(sv_writeiter, &m->i);
 		uint8_t flags = sf_flags(m->r->scheme, v);
 		if (sv_writeiter_is_duplicate(&m->i))
 			flags |= SVDUP;
-		rc = sd_buildadd(m->build, m->r, v, flags);
+		rc = sd_buildadd(b, m->r, v, flags);
 		if (ssunlikely(rc == -1))
 			return -1;
 		ss_iternext(sv_writeiter, &m->i);
 	}
-	rc = sd_buildend(m->build, m->r);
+	m->resume = 1;
+	return 1;
+}
+
+static inline int
+sd_mergepipe(sdmerge *m, uint64_t offset)
+{
+	sdpipe *pipe = m->conf->pipe;
+	sd_pipeshift(pipe);
+	if (m->current > m->limit)
+		return 0;
+	/* queue pages ahead, pages left after the node
+	 * limit are written to the next node */
+	int rc;
+	while (! sd_pipefull(pipe) && sd_mergeresume(m)) {
+		sdbuild *b = sd_pipeprepare(pipe);
+		rc = sd_mergefill(m, b);
+		if (ssunlikely(rc == -1))
+			return -1;
+		sd_pipepush(pipe, rc == 2);
+	}
+	if (sd_pipecount(pipe) == 0)
+		return 0;
+	/* take pages in the stream order */
+	sdbuild *b = sd_pipepop(pipe, &rc);
+	if (ssunlikely(rc == -1))
+		return -1;
+	rc = sd_buildindex_add(m->build_index, m->r, b, offset);
 	if (ssunlikely(rc == -1))
 		return -1;
+	m->current = m->build_index->build.total;
+	m->build   = b;
+	return 1;
+}
+
+int sd_mergepage(sdmerge *m, uint64_t offset)
+{
+	if (m->conf->pipe)
+		return sd_mergepipe(m, offset);
+	sd_buildreset(m->build);
+	if (! sd_mergehas(m))
+		return 0;
+	int rc = sd_mergefill(m, m->build);
+	if (ssunlikely(rc == -1))
+		return -1;
+	if (rc == 1) {
+		rc = sd_buildend(m->build, m->r);
+		if (ssunlikely(rc == -1))
+			return -1;
+	}
 	rc = sd_buildindex_add(m->build_index, m->r, m->build, offset);
 	if (ssunlikely(rc == -1))
 		return -1;
 	m->current = m->build_index->build.total;
-	m->resume  = 1;
 	return 1;
 }
 
@@ -19,6 +19,7 @@ struct sdmergeconf {
 	uint64_t    size_node;
 	uint32_t    size_page;
 	uint32_t    checksum;
+	uint32_t    bloom_bits;
 	uint32_t    expire;
 	uint32_t    timestamp;
 	uint32_t    compression;
@@ -26,6 +27,8 @@ struct sdmergeconf {
 	uint32_t    direct_io;
 	uint32_t    direct_io_page_size;
 	uint64_t    vlsn;
+	ssiter     *passthrough;
+	sdpipe     *pipe;
 };
 
 struct sdmerge {
@@ -12,6 +12,9 @@
 typedef struct sdpageheader sdpageheader;
 typedef struct sdpage sdpage;
 
+/* page has no delete or upsert statements */
+#define SD_PAGEPLAIN 1
+
 struct sdpageheader {
 	uint32_t crc;
 	uint32_t crcdata;
@@ -23,7 +26,7 @@ struct sdpageheader {
 	uint64_t lsnmindup;
 	uint64_t lsnmax;
 	uint32_t tsmin;
-	uint32_t reserve;
+	uint32_t flags;
 } sspacked;
 
 struct sdpage {
@@ -0,0 +1,260 @@
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <libss.h>
+#include <libsf.h>
+#include <libsr.h>
+#include <libsv.h>
+#include <libsd.h>
+
+int sd_pagecache_init(sdpagecache *c, ssa *a)
+{
+	ss_mutexinit(&c->lock);
+	c->limit          = 0;
+	c->used           = 0;
+	c->used_protected = 0;
+	c->count          = 0;
+	c->hit            = 0;
+	c->miss           = 0;
+	c->i              = NULL;
+	c->size           = 0;
+	c->a              = a;
+	ss_listinit(&c->probation);
+	ss_listinit(&c->protected);
+	return 0;
+}
+
+int sd_pagecache_free(sdpagecache *c)
+{
+	sslist *i, *n;
+	ss_listforeach_safe(&c->probation, i, n) {
+		sdpagecachenode *node = sscast(i, sdpagecachenode, link);
+		ss_free(c->a, node);
+	}
+	ss_listforeach_safe(&c->protected, i, n) {
+		sdpagecachenode *node = sscast(i, sdpagecachenode, link);
+		ss_free(c->a, node);
+	}
+	if (c->i)
+		ss_free(c->a, c->i);
+	ss_mutexfree(&c->lock);
+	return 0;
+}
+
+static inline uint32_t
+sd_pagecache_sizeof(sdpagecachenode *n) {
+	return sizeof(sdpagecachenode) + n->size;
+}
+
+static inline uint32_t
+sd_pagecache_hash(uint64_t id, uint64_t offset)
+{
+	char key[16];
+	memcpy(key, &id, sizeof(id));
+	memcpy(key + 8, &offset, sizeof(offset));
+	return ss_fnv(key, sizeof(key));
+}
+
+static inline sdpagecachenode**
+sd_pagecache_find(sdpagecache *c, uint32_t hash,
+                  uint64_t id, uint64_t offset)
+{
+	sdpagecachenode **p = &c->i[hash % c->size];
+	while (*p) {
+		sdpagecachenode *n = *p;
+		if (n->hash == hash && n->id == id && n->offset == offset)
+			break;
+		p = &n->next;
+	}
+	return p;
+}
+
+static inline int
+sd_pagecache_resize(sdpagecache *c)
+{
+	uint32_t size = (c->size == 0) ? 1024 : c->size * 2;
+	int sz = size * sizeof(sdpagecachenode*);
+	sdpagecachenode **i = ss_malloc(c->a, sz);
+	if (ssunlikely(i == NULL))
+		return -1;
+	memset(i, 0, sz);
+	uint32_t pos = 0;
+	while (pos < c->size) {
+		sdpagecachenode *n = c->i[pos];
+		while (n) {
+			sdpagecachenode *next = n->next;
+			n->next = i[n->hash % size];
+			i[n->hash % size] = n;
+			n = next;
+		}
+		pos++;
+	}
+	if (c->i)
+		ss_free(c->a, c->i);
+	c->i = i;
+	c->size = size;
+	return 0;
+}
+
+static inline void
+sd_pagecache_unlink(sdpagecache *c, sdpagecachenode **p)
+{
+	sdpagecachenode *n = *p;
+	*p = n->next;
+	ss_listunlink(&n->link);
+	c->used -= sd_pagecache_sizeof(n);
+	if (n->protected)
+		c->used_protected -= sd_pagecache_sizeof(n);
+	c->count--;
+	ss_free(c->a, n);
+}
+
+static inline void
+sd_pagecache_remove(sdpagecache *c, sdpagecachenode *n)
+{
+	sdpagecachenode **p =
+		sd_pagecache_find(c, n->hash, n->id, n->offset);
+	assert(*p == n);
+	sd_pagecache_unlink(c, p);
+}
+
+static inline void
+sd_pagecache_evict(sdpagecache *c)
+{
+	while (c->used > c->limit) {
+		sslist *victim;
+		if (! ss_listempty(&c->probation))
+			victim = c->probation.next;
+		else
+		if (! ss_listempty(&c->protected))
+			victim = c->protected.next;
+		else
+			break;
+		sd_pagecache_remove(c, sscast(victim, sdpagecachenode, link));
+	}
+}
+
+static inline void
+sd_pagecache_promote(sdpagecache *c, sdpagecachenode *n)
+{
+	ss_listunlink(&n->link);
+	if (! n->protected) {
+		n->protected = 1;
+		c->used_protected += sd_pagecache_sizeof(n);
+	}
+	ss_listappend(&c->protected, &n->link);
+	/* keep protected segment within 80% of the limit,
+	 * demoted pages get another chance in probation */
+	uint64_t limit = (c->limit * 8) / 10;
+	while (c->used_protected > limit) {
+		sslist *first = c->protected.next;
+		sdpagecachenode *d = sscast(first, sdpagecachenode, link);
+		if (d == n)
+			break;
+		ss_listunlink(&d->link);
+		d->protected = 0;
+		c->used_protected -= sd_pagecache_sizeof(d);
+		ss_listappend(&c->probation, &d->link);
+	}
+}
+
+int sd_pagecache_get(sdpagecache *c, ssbuf *dest, sr *r,
+                     uint64_t id, uint64_t offset)
+{
+	uint32_t hash = sd_pagecache_hash(id, offset);
+	ss_mutexlock(&c->lock);
+	if (ssunlikely(c->size == 0)) {
+		c->miss++;
+		ss_mutexunlock(&c->lock);
+		return 0;
+	}
+	sdpagecachenode *n = *sd_pagecache_find(c, hash, id, offset);
+	if (n == NULL) {
+		c->miss++;
+		ss_mutexunlock(&c->lock);
+		return 0;
+	}
+	int rc = ss_bufensure(dest, r->a, n->size);
+	if (ssunlikely(rc == -1)) {
+		ss_mutexunlock(&c->lock);
+		return sr_oom(r->e);
+	}
+	memcpy(dest->p, sd_pagecache_data(n), n->size);
+	ss_bufadvance(dest, n->size);
+	sd_pagecache_promote(c, n);
+	c->hit++;
+	ss_mutexunlock(&c->lock);
+	return 1;
+}
+
+int sd_pagecache_set(sdpagecache *c, uint64_t id, uint64_t offset,
+                     char *data, uint32_t size)
+{
+	uint32_t hash = sd_pagecache_hash(id, offset);
+	uint32_t total = sizeof(sdpagecachenode) + size;
+	ss_mutexlock(&c->lock);
+	if (ssunlikely(total > c->limit)) {
+		ss_mutexunlock(&c->lock);
+		return 0;
+	}
+	if (ssunlikely(c->count >= c->size)) {
+		int rc = sd_pagecache_resize(c);
+		if (ssunlikely(rc == -1)) {
+			ss_mutexunlock(&c->lock);
+			return -1;
+		}
+	}
+	sdpagecachenode **p = sd_pagecache_find(c, hash, id, offset);
+	if (*p) {
+		/* concurrently added by another reader */
+		ss_mutexunlock(&c->lock);
+		return 0;
+	}
+	sdpagecachenode *n = ss_malloc(c->a, total);
+	if (ssunlikely(n == NULL)) {
+		ss_mutexunlock(&c->lock);
+		return -1;
+	}
+	n->hash      = hash;
+	n->id        = id;
+	n->offset    = offset;
+	n->size      = size;
+	n->protected = 0;
+	n->next      = NULL;
+	memcpy(sd_pagecache_data(n), data, size);
+	*p = n;
+	ss_listappend(&c->probation, &n->link);
+	c->used += total;
+	c->count++;
+	sd_pagecache_evict(c);
+	ss_mutexunlock(&c->lock);
+	return 0;
+}
+
+int sd_pagecache_drop(sdpagecache *c, uint64_t id, sdindex *index)
+{
+	if (index->h == NULL)
+		return 0;
+	ss_mutexlock(&c->lock);
+	if (c->count == 0) {
+		ss_mutexunlock(&c->lock);
+		return 0;
+	}
+	uint32_t pos = 0;
+	while (pos < index->h->count) {
+		sdindexpage *page = sd_indexpage(index, pos);
+		uint32_t hash = sd_pagecache_hash(id, page->offset);
+		sdpagecachenode **p =
+			sd_pagecache_find(c, hash, id, page->offset);
+		if (*p)
+			sd_pagecache_unlink(c, p);
+		pos++;
+	}
+	ss_mutexunlock(&c->lock);
+	return 0;
+}
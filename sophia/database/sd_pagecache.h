@@ -0,0 +1,66 @@
+#ifndef SD_PAGECACHE_H_
+#define SD_PAGECACHE_H_
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+/* shared cache of decompressed pages.
+ *
+ * Pages are keyed by (node id, page offset), node ids
+ * are unique across databases.
+ * Eviction is a segmented lru: new pages are placed
+ * in probation and only a repeated hit promotes a page
+ * to the protected segment, so a single scan can not
+ * flush the hot set.
+*/
+
+typedef struct sdpagecachenode sdpagecachenode;
+typedef struct sdpagecache sdpagecache;
+
+struct sdpagecachenode {
+	uint32_t         hash;
+	uint64_t         id;
+	uint64_t         offset;
+	uint32_t         size;
+	int              protected;
+	sdpagecachenode *next;
+	sslist           link;
+};
+
+struct sdpagecache {
+	ssmutex           lock;
+	uint64_t          limit;
+	uint64_t          used;
+	uint64_t          used_protected;
+	uint32_t          count;
+	uint64_t          hit;
+	uint64_t          miss;
+	sdpagecachenode **i;
+	uint32_t          size;
+	sslist            probation;
+	sslist            protected;
+	ssa              *a;
+};
+
+static inline char*
+sd_pagecache_data(sdpagecachenode *n) {
+	return (char*)n + sizeof(sdpagecachenode);
+}
+
+static inline int
+sd_pagecache_enabled(sdpagecache *c) {
+	return c != NULL && c->limit > 0;
+}
+
+int sd_pagecache_init(sdpagecache*, ssa*);
+int sd_pagecache_free(sdpagecache*);
+int sd_pagecache_get(sdpagecache*, ssbuf*, sr*, uint64_t, uint64_t);
+int sd_pagecache_set(sdpagecache*, uint64_t, uint64_t, char*, uint32_t);
+int sd_pagecache_drop(sdpagecache*, uint64_t, sdindex*);
+
+#endif
@@ -43,16 +43,40 @@ sd_pageiter_cmp(sdpageiter *i, sr *r, uint32_t pos)
 	return sf_compare(r->scheme, sd_pagepointer(i->page, i->r, pos), i->key);
 }
 
+static inline int
+sd_pageiter_lowerbound(sdpageiter *i, sfsearch *s)
+{
+	/* branchless search over fixed size records, each
+	 * step is a conditional move */
+	char *base = (char*)i->page->h + sizeof(sdpageheader);
+	uint32_t stride = s->scheme->var_offset;
+	uint32_t pos = 0;
+	uint32_t n = i->page->h->count;
+	if (ssunlikely(n == 0))
+		return 0;
+	while (n > 1) {
+		uint32_t half = n / 2;
+		uint64_t v = sf_searchnormalize(s, base + (pos + half) * stride);
+		pos = (v < s->value) ? pos + half : pos;
+		n -= half;
+	}
+	return pos + (sf_searchnormalize(s, base + pos * stride) < s->value);
+}
+
 static inline int
 sd_pageiter_search(sdpageiter *i)
 {
+	sfsearch s;
+	sf_searchinit(&s, i->r->scheme, i->key);
+	if (s.exact && sf_schemefixed(s.scheme))
+		return sd_pageiter_lowerbound(i, &s);
 	int min = 0;
 	int mid = 0;
 	int max = i->page->h->count - 1;
 	while (max >= min)
 	{
 		mid = min + (max - min) / 2;
-		int rc = sd_pageiter_cmp(i, i->r, mid);
+		int rc = sf_searchcmp(&s, sd_pagepointer(i->page, i->r, mid));
 		switch (rc) {
 		case -1: min = mid + 1;
 			continue;
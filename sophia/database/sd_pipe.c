@@ -0,0 +1,176 @@
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <libss.h>
+#include <libsf.h>
+#include <libsr.h>
+#include <libsv.h>
+#include <libsd.h>
+
+static inline int
+sd_pipejob(sdpipe *p)
+{
+	/* take the oldest queued page, copied
+	 * pages are queued complete */
+	while (p->next < p->tail && p->pages[p->next % p->size].done)
+		p->next++;
+	if (p->next == p->tail)
+		return 0;
+	sdpipepage *page = &p->pages[p->next % p->size];
+	p->next++;
+	p->busy++;
+	ss_mutexunlock(&p->lock);
+	int rc = sd_buildend(&page->b, p->r);
+	ss_mutexlock(&p->lock);
+	p->busy--;
+	page->rc   = rc;
+	page->done = 1;
+	ss_condbroadcast(&p->cond_done);
+	return 1;
+}
+
+static void*
+sd_pipef(void *arg)
+{
+	ssthread *self = arg;
+	sdpipe *p = self->arg;
+	ss_mutexlock(&p->lock);
+	for (;;) {
+		if (sd_pipejob(p))
+			continue;
+		if (p->shutdown)
+			break;
+		ss_condwait(&p->cond, &p->lock);
+	}
+	ss_mutexunlock(&p->lock);
+	return NULL;
+}
+
+int sd_pipeinit(sdpipe *p, sr *r, int threads)
+{
+	memset(p, 0, sizeof(*p));
+	p->r    = r;
+	p->size = threads * 2;
+	ss_mutexinit(&p->lock);
+	ss_condinit(&p->cond);
+	ss_condinit(&p->cond_done);
+	p->pages = ss_malloc(r->a, sizeof(sdpipepage) * p->size);
+	if (ssunlikely(p->pages == NULL))
+		goto error;
+	uint32_t i = 0;
+	while (i < p->size) {
+		sd_buildinit(&p->pages[i].b);
+		p->pages[i].done = 0;
+		p->pages[i].rc   = 0;
+		i++;
+	}
+	p->threads = ss_malloc(r->a, sizeof(ssthread) * threads);
+	if (ssunlikely(p->threads == NULL))
+		goto error;
+	while (p->threads_count < threads) {
+		int rc = ss_threadnew(&p->threads[p->threads_count], sd_pipef, p);
+		if (ssunlikely(rc == -1))
+			goto error;
+		p->threads_count++;
+	}
+	return 0;
+error:
+	sd_pipefree(p);
+	return -1;
+}
+
+int sd_pipefree(sdpipe *p)
+{
+	/* pages left in the queue are dropped */
+	ss_mutexlock(&p->lock);
+	p->shutdown = 1;
+	p->next = p->tail;
+	ss_condbroadcast(&p->cond);
+	ss_mutexunlock(&p->lock);
+	int rcret = 0;
+	int k = 0;
+	while (k < p->threads_count) {
+		int rc = ss_threadjoin(&p->threads[k]);
+		if (ssunlikely(rc == -1))
+			rcret = -1;
+		k++;
+	}
+	if (p->threads)
+		ss_free(p->r->a, p->threads);
+	if (p->pages) {
+		uint32_t i = 0;
+		while (i < p->size) {
+			sd_buildfree(&p->pages[i].b, p->r);
+			i++;
+		}
+		ss_free(p->r->a, p->pages);
+	}
+	ss_condfree(&p->cond_done);
+	ss_condfree(&p->cond);
+	ss_mutexfree(&p->lock);
+	return rcret;
+}
+
+void sd_pipereset(sdpipe *p, sr *r)
+{
+	/* drop pages left by a previous merge, pages
+	 * being compressed are waited for */
+	ss_mutexlock(&p->lock);
+	p->next = p->tail;
+	while (p->busy > 0)
+		ss_condwait(&p->cond_done, &p->lock);
+	p->head = 0;
+	p->tail = 0;
+	p->next = 0;
+	p->out  = 0;
+	p->r    = r;
+	ss_mutexunlock(&p->lock);
+}
+
+void sd_pipepush(sdpipe *p, int done)
+{
+	sdpipepage *page = &p->pages[p->tail % p->size];
+	ss_mutexlock(&p->lock);
+	page->done = done;
+	page->rc   = 0;
+	p->tail++;
+	if (! done)
+		ss_condsignal(&p->cond);
+	ss_mutexunlock(&p->lock);
+}
+
+sdbuild *sd_pipepop(sdpipe *p, int *rc)
+{
+	assert(! p->out && p->head < p->tail);
+	sdpipepage *page = &p->pages[p->head % p->size];
+	ss_mutexlock(&p->lock);
+	while (! page->done) {
+		/* compress pages too, instead of waiting */
+		if (sd_pipejob(p))
+			continue;
+		ss_condwait(&p->cond_done, &p->lock);
+	}
+	ss_mutexunlock(&p->lock);
+	p->out = 1;
+	*rc = page->rc;
+	return &page->b;
+}
+
+void sd_pipeshift(sdpipe *p)
+{
+	/* release the page taken by the writer */
+	if (! p->out)
+		return;
+	ss_mutexlock(&p->lock);
+	p->head++;
+	if (p->next < p->head)
+		p->next = p->head;
+	ss_mutexunlock(&p->lock);
+	p->out = 0;
+}
@@ -0,0 +1,73 @@
+#ifndef SD_PIPE_H_
+#define SD_PIPE_H_
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+/* page compression pipeline.
+ *
+ * Merge fills page builds in stream order, compression
+ * threads finish them (crc and compression) in parallel
+ * and the writer takes them back in the same order.
+*/
+
+#define SD_PIPE_MAX 32
+
+typedef struct sdpipepage sdpipepage;
+typedef struct sdpipe sdpipe;
+
+struct sdpipepage {
+	sdbuild b;
+	int     done;
+	int     rc;
+};
+
+struct sdpipe {
+	ssmutex     lock;
+	sscond      cond;
+	sscond      cond_done;
+	sdpipepage *pages;
+	uint32_t    size;
+	uint64_t    head;
+	uint64_t    tail;
+	uint64_t    next;
+	int         out;
+	int         busy;
+	int         shutdown;
+	ssthread   *threads;
+	int         threads_count;
+	sr         *r;
+};
+
+static inline uint32_t
+sd_pipecount(sdpipe *p) {
+	return p->tail - p->head;
+}
+
+static inline int
+sd_pipefull(sdpipe *p) {
+	return sd_pipecount(p) == p->size;
+}
+
+static inline sdbuild*
+sd_pipeprepare(sdpipe *p)
+{
+	/* slots after tail are not seen by the threads */
+	sdpipepage *page = &p->pages[p->tail % p->size];
+	sd_buildreset(&page->b);
+	return &page->b;
+}
+
+int sd_pipeinit(sdpipe*, sr*, int);
+int sd_pipefree(sdpipe*);
+void sd_pipereset(sdpipe*, sr*);
+void sd_pipepush(sdpipe*, int);
+sdbuild *sd_pipepop(sdpipe*, int*);
+void sd_pipeshift(sdpipe*);
+
+#endif
@@ -13,34 +13,45 @@ typedef struct sdread sdread;
 typedef struct sdreadarg sdreadarg;
 
 struct sdreadarg {
-	sdio       *io;
-	sdindex    *index;
-	ssbuf      *buf;
-	ssbuf      *buf_read;
-	ssiter     *index_iter;
-	ssiter     *page_iter;
-	ssmmap     *mmap;
-	ssfile     *file;
-	ssorder     o;
-	int         from_compaction;
-	int         has;
-	uint64_t    has_vlsn;
-	int         use_mmap;
-	int         use_mmap_copy;
-	int         use_compression;
-	int         use_direct_io;
-	int         direct_io_page_size;
-	ssfilterif *compression_if;
-	sr         *r;
+	sdio        *io;
+	sdindex     *index;
+	ssbuf       *buf;
+	ssbuf       *buf_read;
+	ssiter      *index_iter;
+	ssiter      *page_iter;
+	ssmmap      *mmap;
+	ssfile      *file;
+	ssorder      o;
+	int          from_compaction;
+	int          has;
+	uint64_t     has_vlsn;
+	int          use_mmap;
+	int          use_mmap_copy;
+	int          use_compression;
+	int          use_direct_io;
+	int          direct_io_page_size;
+	ssfilterif  *compression_if;
+	sdpagecache *pagecache;
+	uint64_t     pagecache_id;
+	sdiobatch   *prefetch;
+	sdreadahead *readahead;
+	sr          *r;
 };
 
 struct sdread {
 	sdreadarg    ra;
 	sdindexpage *ref;
+	sdindexpage *loaded;
 	sdpage       page;
+	char        *raw;
 	int          reads;
 } sspacked;
 
+static inline sdpage*
+sd_readpage(sdread *i) {
+	return &i->page;
+}
+
 static inline int
 sd_read_page(sdread *i, sdindexpage *ref)
 {
@@ -49,6 +60,7 @@ sd_read_page(sdread *i, sdindexpage *ref)
 
 	int page_align = arg->io->size_page * 4;
 	i->reads++;
+	i->raw = NULL;
 
 	ss_bufreset(arg->buf);
 	int rc = ss_bufensure(arg->buf, r->a, ref->sizeorigin + page_align);
@@ -59,9 +71,32 @@ sd_read_page(sdread *i, sdindexpage *ref)
 	char *page_pointer;
 	if (arg->use_compression)
 	{
+		/* shared page cache */
+		int use_pagecache = !arg->from_compaction &&
+		                    sd_pagecache_enabled(arg->pagecache);
+		if (use_pagecache) {
+			rc = sd_pagecache_get(arg->pagecache, arg->buf, r,
+			                      arg->pagecache_id, ref->offset);
+			if (ssunlikely(rc == -1))
+				return -1;
+			sr_statpagecache(r->stat, rc);
+			if (rc == 1) {
+				sd_pageinit(sd_readpage(i), (sdpageheader*)arg->buf->s);
+				return 0;
+			}
+		}
+
+		uint64_t trace;
+		sdioreq *prefetched = NULL;
+		if (arg->prefetch)
+			prefetched = sd_iobatch_match(arg->prefetch, arg->file, ref->offset);
 		if (arg->use_mmap) {
 			page_pointer = arg->mmap->p + ref->offset;
+		} else
+		if (prefetched) {
+			page_pointer = prefetched->page;
 		} else {
+			trace = sr_stattrace_begin(r->stat);
 			ss_bufreset(arg->buf_read);
 			rc = ss_bufensure(arg->buf_read, r->a, ref->size + page_align);
 			if (ssunlikely(rc == -1))
@@ -73,13 +108,17 @@ sd_read_page(sdread *i, sdindexpage *ref)
 			if (ssunlikely(rc == -1))
 				return -1;
 			ss_bufadvance(arg->buf_read, ref->size);
+			if (! arg->from_compaction)
+				sr_stattrace(r->stat, SR_PHASE_PAGEREAD, trace);
 		}
+		i->raw = page_pointer;
 
 		/* copy header */
 		memcpy(arg->buf->p, page_pointer, sizeof(sdpageheader));
 		ss_bufadvance(arg->buf, sizeof(sdpageheader));
 
 		/* decompression */
+		trace = sr_stattrace_begin(r->stat);
 		ssfilter f;
 		rc = ss_filterinit(&f, (ssfilterif*)arg->compression_if, r->a, SS_FOUTPUT);
 		if (ssunlikely(rc == -1)) {
@@ -95,7 +134,16 @@ sd_read_page(sdread *i, sdindexpage *ref)
 			return -1;
 		}
 		ss_filterfree(&f);
-		sd_pageinit(&i->page, (sdpageheader*)arg->buf->s);
+		if (! arg->from_compaction)
+			sr_stattrace(r->stat, SR_PHASE_DECOMPRESS, trace);
+		if (use_pagecache) {
+			rc = sd_pagecache_set(arg->pagecache, arg->pagecache_id,
+			                      ref->offset,
+			                      arg->buf->s, ss_bufused(arg->buf));
+			if (ssunlikely(rc == -1))
+				return sr_oom(r->e);
+		}
+		sd_pageinit(sd_readpage(i), (sdpageheader*)arg->buf->s);
 		return 0;
 	}
 
@@ -103,14 +151,29 @@ sd_read_page(sdread *i, sdindexpage *ref)
 	if (arg->use_mmap) {
 		if (arg->use_mmap_copy) {
 			memcpy(arg->buf->s, arg->mmap->p + ref->offset, ref->sizeorigin);
-			sd_pageinit(&i->page, (sdpageheader*)(arg->buf->s));
+			sd_pageinit(sd_readpage(i), (sdpageheader*)(arg->buf->s));
 		} else {
-			sd_pageinit(&i->page, (sdpageheader*)(arg->mmap->p + ref->offset));
+			sd_pageinit(sd_readpage(i), (sdpageheader*)(arg->mmap->p + ref->offset));
 		}
+		i->raw = (char*)i->page.h;
 		return 0;
 	}
 
+	/* page is already read by a batch */
+	if (arg->prefetch) {
+		sdioreq *prefetched =
+			sd_iobatch_match(arg->prefetch, arg->file, ref->offset);
+		if (prefetched) {
+			memcpy(arg->buf->s, prefetched->page, ref->size);
+			ss_bufadvance(arg->buf, ref->size);
+			sd_pageinit(sd_readpage(i), (sdpageheader*)arg->buf->s);
+			i->raw = (char*)i->page.h;
+			return 0;
+		}
+	}
+
 	/* default */
+	uint64_t trace = sr_stattrace_begin(r->stat);
 	rc = sd_ioread(arg->io, r, arg->file, ref->offset,
 	               arg->buf->s, ref->size,
 	               arg->from_compaction,
@@ -118,21 +181,42 @@ sd_read_page(sdread *i, sdindexpage *ref)
 	if (ssunlikely(rc == -1))
 		return -1;
 	ss_bufadvance(arg->buf, ref->size);
-	sd_pageinit(&i->page, (sdpageheader*)page_pointer);
+	if (! arg->from_compaction)
+		sr_stattrace(r->stat, SR_PHASE_PAGEREAD, trace);
+	sd_pageinit(sd_readpage(i), (sdpageheader*)page_pointer);
+	i->raw = page_pointer;
 	return 0;
 }
 
+static inline int
+sd_read_ahead(sdread *i)
+{
+	sdreadarg *arg = &i->ra;
+	sdreadahead *ra = arg->readahead;
+	/* batched pages are served from the batch */
+	if (arg->io->direct || ra->batched)
+		arg->prefetch = &ra->batch;
+	int pos = i->ref - sd_indexpage(arg->index, 0);
+	int forward = arg->o == SS_GT || arg->o == SS_GTE;
+	return sd_readahead(ra, arg->io, arg->r, arg->index, arg->file,
+	                    arg->pagecache_id, pos, forward,
+	                    arg->from_compaction);
+}
+
 static inline int
 sd_read_openpage(sdread *i, char *key)
 {
 	sdreadarg *arg = &i->ra;
 	assert(i->ref != NULL);
 	int rc = sd_read_page(i, i->ref);
-	if (ssunlikely(rc == -1))
+	if (ssunlikely(rc == -1)) {
+		i->loaded = NULL;
 		return -1;
+	}
+	i->loaded = i->ref;
 	ss_iterinit(sd_pageiter, arg->page_iter);
 	return ss_iteropen(sd_pageiter, arg->page_iter, arg->r,
-	                   &i->page, arg->o, key);
+	                   sd_readpage(i), arg->o, key);
 }
 
 static inline void
@@ -143,6 +227,8 @@ sd_read_open(ssiter *iptr, sdreadarg *arg, char *key)
 {
 	sdread *i = (sdread*)iptr->priv;
 	i->reads = 0;
+	i->loaded = NULL;
+	i->raw = NULL;
 	i->ra = *arg;
 	ss_iterinit(sd_indexiter, arg->index_iter);
 	ss_iteropen(sd_indexiter, arg->index_iter, arg->r, arg->index,
@@ -157,7 +243,52 @@ sd_read_open(ssiter *iptr, sdreadarg *arg, char *key)
 			return 0;
 		}
 	}
-	int rc = sd_read_openpage(i, key);
+	int rc;
+	/* stream continues from a previous node */
+	if (arg->readahead && arg->readahead->sequential) {
+		rc = sd_read_ahead(i);
+		if (ssunlikely(rc == -1)) {
+			i->ref = NULL;
+			return -1;
+		}
+	}
+	rc = sd_read_openpage(i, key);
+	if (ssunlikely(rc == -1)) {
+		i->ref = NULL;
+		return -1;
+	}
+	if (ssunlikely(! ss_iterhas(sd_pageiter, i->ra.page_iter))) {
+		sd_read_next(iptr);
+		rc = 0;
+	}
+	return rc;
+}
+
+static inline int
+sd_read_reopen(ssiter *iptr, char *key)
+{
+	/* position opened stream to a new key of the same
+	 * node, page is read only if the key routes to a
+	 * different one */
+	sdread *i = (sdread*)iptr->priv;
+	sdreadarg *arg = &i->ra;
+	assert(! arg->has);
+	i->reads = 0;
+	ss_iterinit(sd_indexiter, arg->index_iter);
+	ss_iteropen(sd_indexiter, arg->index_iter, arg->r, arg->index,
+	            arg->o, key);
+	i->ref = ss_iterof(sd_indexiter, arg->index_iter);
+	if (i->ref == NULL)
+		return 0;
+	int rc;
+	/* direct_io page may point to the shared io buffer */
+	if (i->ref == i->loaded && !arg->use_direct_io) {
+		ss_iterinit(sd_pageiter, arg->page_iter);
+		rc = ss_iteropen(sd_pageiter, arg->page_iter, arg->r,
+		                 sd_readpage(i), arg->o, key);
+	} else {
+		rc = sd_read_openpage(i, key);
+	}
 	if (ssunlikely(rc == -1)) {
 		i->ref = NULL;
 		return -1;
@@ -195,12 +326,8 @@ sd_read_of(ssiter *iptr)
 }
 
 static inline void
-sd_read_next(ssiter *iptr)
+sd_read_nextpage(sdread *i)
 {
-	sdread *i = (sdread*)iptr->priv;
-	if (ssunlikely(i->ref == NULL))
-		return;
-	ss_iternext(sd_pageiter, i->ra.page_iter);
 retry:
 	if (sslikely(ss_iterhas(sd_pageiter, i->ra.page_iter)))
 		return;
@@ -208,7 +335,16 @@ retry:
 	i->ref = ss_iterof(sd_indexiter, i->ra.index_iter);
 	if (i->ref == NULL)
 		return;
-	int rc = sd_read_openpage(i, NULL);
+	int rc;
+	if (i->ra.readahead) {
+		i->ra.readahead->sequential++;
+		rc = sd_read_ahead(i);
+		if (ssunlikely(rc == -1)) {
+			i->ref = NULL;
+			return;
+		}
+	}
+	rc = sd_read_openpage(i, NULL);
 	if (ssunlikely(rc == -1)) {
 		i->ref = NULL;
 		return;
@@ -216,6 +352,41 @@ retry:
 	goto retry;
 }
 
+static inline void
+sd_read_next(ssiter *iptr)
+{
+	sdread *i = (sdread*)iptr->priv;
+	if (ssunlikely(i->ref == NULL))
+		return;
+	ss_iternext(sd_pageiter, i->ra.page_iter);
+	sd_read_nextpage(i);
+}
+
+static inline sdread*
+sd_read_pagestart(ssiter *iptr)
+{
+	/* stream is at the first document of a page and
+	 * the page image read from disk is available */
+	sdread *i = (sdread*)iptr->priv;
+	if (ssunlikely(i->ref == NULL || i->raw == NULL))
+		return NULL;
+	sdpageiter *pi = (sdpageiter*)i->ra.page_iter->priv;
+	if (pi->pos != 0)
+		return NULL;
+	return i;
+}
+
+static inline void
+sd_read_skip(ssiter *iptr)
+{
+	/* skip the rest of the current page */
+	sdread *i = (sdread*)iptr->priv;
+	if (ssunlikely(i->ref == NULL))
+		return;
+	sd_pageiter_end((sdpageiter*)i->ra.page_iter->priv);
+	sd_read_nextpage(i);
+}
+
 static inline int
 sd_read_stat(ssiter *iptr)
 {
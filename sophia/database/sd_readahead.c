@@ -0,0 +1,103 @@
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <libss.h>
+#include <libsf.h>
+#include <libsr.h>
+#include <libsv.h>
+#include <libsd.h>
+
+int sd_readahead_advise(sdindex *index, ssfile *file, int from, int to)
+{
+	assert(from <= to);
+	sdindexpage *min = sd_indexpage(index, from);
+	sdindexpage *max = sd_indexpage(index, to);
+	uint64_t size = (max->offset + max->size) - min->offset;
+	/* advise is only a hint, errors are ignored */
+	ss_fileadvise(file, SS_VFSADVISE_WILLNEED, min->offset, size);
+	return 0;
+}
+
+static inline int
+sd_readahead_batch(sdreadahead *ra, sdio *io, sr *r, sdindex *index,
+                   ssfile *file, int from, int to,
+                   int from_compaction)
+{
+	sd_iobatch_reset(&ra->batch);
+	int pos = from;
+	while (pos <= to) {
+		sdindexpage *page = sd_indexpage(index, pos);
+		int rc = sd_iobatch_add(&ra->batch, r, file, page->offset, page->size);
+		if (ssunlikely(rc == -1))
+			goto error;
+		pos++;
+	}
+	int rc = sd_iobatch_read(&ra->batch, io, r, from_compaction);
+	if (ssunlikely(rc == -1))
+		goto error;
+	return 0;
+error:
+	sd_iobatch_reset(&ra->batch);
+	return -1;
+}
+
+int sd_readahead(sdreadahead *ra, sdio *io, sr *r, sdindex *index,
+                 ssfile *file, uint64_t id, int pos, int forward,
+                 int from_compaction)
+{
+	if (ssunlikely(ra->window == 0))
+		return 0;
+	if (ra->id != id) {
+		sd_readahead_rewind(ra);
+		ra->id = id;
+	}
+	int count  = index->h->count;
+	int window = ra->window;
+	int step   = (forward) ? 1 : -1;
+
+	/* number of pages already requested ahead of
+	 * the current one */
+	int ahead = -1;
+	if (ra->pos != -1)
+		ahead = (ra->pos - pos) * step;
+
+	int start, end;
+	int batched = io->direct || ra->batched;
+	if (batched) {
+		/* current page is read by the batch too */
+		if (ahead >= 0)
+			return 0;
+		start = pos;
+		end   = pos + step * (window - 1);
+	} else {
+		if (ahead > window / 2)
+			return 0;
+		start = (ahead >= 0) ? ra->pos + step : pos + step;
+		end   = pos + step * window;
+	}
+	if (end < 0)
+		end = 0;
+	if (end >= count)
+		end = count - 1;
+	if ((end - start) * step < 0) {
+		/* node end is reached */
+		if (! ra->edge)
+			ra->edge = 1;
+		return 0;
+	}
+	ra->pos = end;
+	int min = (forward) ? start : end;
+	int max = (forward) ? end : start;
+	if (batched)
+		return sd_readahead_batch(ra, io, r, index, file, min, max,
+		                          from_compaction);
+	if (end == ((forward) ? count - 1 : 0) && !ra->edge)
+		ra->edge = 1;
+	return sd_readahead_advise(index, file, min, max);
+}
@@ -0,0 +1,73 @@
+#ifndef SD_READAHEAD_H_
+#define SD_READAHEAD_H_
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+/* sequential read-ahead.
+ *
+ * Once a stream moves from one page to the next, a window
+ * of the following pages is requested ahead of the reader:
+ * buffered and mmap files are advised with WILLNEED, direct_io
+ * pages are read by a single batch and served from it.
+ * Compaction reads buffered files by the batch too.
+*/
+
+typedef struct sdreadahead sdreadahead;
+
+struct sdreadahead {
+	uint32_t  window;
+	int       sequential;
+	uint64_t  id;
+	int       pos;
+	int       edge;
+	int       batched;
+	sdiobatch batch;
+};
+
+static inline void
+sd_readahead_init(sdreadahead *ra)
+{
+	ra->window     = 0;
+	ra->sequential = 0;
+	ra->id         = UINT64_MAX;
+	ra->pos        = -1;
+	ra->edge       = 0;
+	ra->batched    = 0;
+	sd_iobatch_init(&ra->batch);
+}
+
+static inline void
+sd_readahead_free(sdreadahead *ra, sr *r)
+{
+	sd_iobatch_free(&ra->batch, r);
+}
+
+static inline void
+sd_readahead_rewind(sdreadahead *ra)
+{
+	/* stream moves to another node, sequential
+	 * state is kept */
+	ra->id   = UINT64_MAX;
+	ra->pos  = -1;
+	ra->edge = 0;
+	sd_iobatch_reset(&ra->batch);
+}
+
+static inline void
+sd_readahead_reset(sdreadahead *ra)
+{
+	sd_readahead_rewind(ra);
+	ra->sequential = 0;
+}
+
+int sd_readahead_advise(sdindex*, ssfile*, int, int);
+int sd_readahead(sdreadahead*, sdio*, sr*, sdindex*, ssfile*,
+                 uint64_t, int, int, int);
+
+#endif
@@ -39,7 +39,7 @@ se_worker(void *arg)
 		if (ssunlikely(rc == -1))
 			break;
 		if (ssunlikely(rc == 0))
-			ss_sleep(10000000); /* 10ms */
+			sc_wait(&e->scheduler);
 	}
 	sc_workerpool_push(&e->scheduler.wp, w);
 	return NULL;
@@ -146,8 +146,10 @@ se_destroy(so *o)
 	sx_managerfree(&e->xm);
 	ss_vfsfree(&e->vfs);
 	si_cachepool_free(&e->cachepool);
+	sd_pagecache_free(&e->pagecache);
 	se_conffree(&e->conf);
 	ss_mutexfree(&e->apilock);
+	sr_statfree(&e->stat);
 
 	sr_seqfree(&e->seq);
 	sr_statusfree(&e->status);
@@ -185,6 +187,7 @@ static soif seif =
 	.upsert       = NULL,
 	.del          = NULL,
 	.get          = NULL,
+	.getbatch     = NULL,
 	.begin        = se_begin,
 	.prepare      = NULL,
 	.commit       = NULL,
@@ -216,10 +219,11 @@ so *se_new(void)
 	sr_seqinit(&e->seq);
 	sr_loginit(&e->log);
 	sr_errorinit(&e->error, &e->log);
+	sr_statinit(&e->stat);
 	sscrcf crc = ss_crc32c_function();
 	sr_init(&e->r, &e->status, &e->log, &e->error, &e->a, NULL,
 	        &e->vfs, &e->seq, NULL, NULL,
-	        &e->ei, NULL, crc, NULL);
+	        &e->ei, &e->stat, crc, NULL);
 	sy_init(&e->rep);
 	e->rep_conf = sy_conf(&e->rep);
 	sw_managerinit(&e->wm, &e->r);
@@ -227,6 +231,7 @@ so *se_new(void)
 	sr_statxm_init(&e->xm_stat);
 	sx_managerinit(&e->xm, &e->seq, &e->a);
 	si_cachepool_init(&e->cachepool, &e->r);
+	sd_pagecache_init(&e->pagecache, &e->a);
 	sc_init(&e->scheduler, &e->r, &e->wm);
 	return &e->o;
 error:
@@ -27,12 +27,16 @@ struct se {
 	ssa          a_oom;
 	ssa          a;
 	sicachepool  cachepool;
+	sdpagecache  pagecache;
 	syconf      *rep_conf;
 	sy           rep;
 	swconf      *wm_conf;
 	swmanager    wm;
 	sxmanager    xm;
 	srstatxm     xm_stat;
+	srstat       stat;
+	srstatv      statrt;
+	srstatsz     statsz;
 	sc           scheduler;
 	srlog        log;
 	srerror      error;
@@ -55,6 +59,13 @@ se_apiunlock(so *o) {
 	ss_mutexunlock(&((se*)o)->apilock);
 }
 
+static inline void
+se_commitlock(se *e) {
+	uint64_t trace = sr_stattrace_begin(&e->stat);
+	sx_commitlock(&e->xm);
+	sr_stattrace(&e->stat, SR_PHASE_COMMITLOCK, trace);
+}
+
 static inline se *se_of(so *o) {
 	return (se*)o->env;
 }
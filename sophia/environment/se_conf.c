@@ -211,14 +211,30 @@ se_conflog(se *e, seconfrt *rt, srconf **pc)
 	sr_c(&p, pc, se_confv_offline, "enable", SS_U32, &e->wm_conf->enable);
 	sr_c(&p, pc, se_confv_offline, "path", SS_STRINGPTR, &e->wm_conf->path);
 	sr_c(&p, pc, se_confv_offline, "sync", SS_U32, &e->wm_conf->sync_on_write);
+	sr_c(&p, pc, se_confv_offline, "group_commit", SS_U32, &e->wm_conf->group_commit);
 	sr_c(&p, pc, se_confv_offline, "rotate_wm", SS_U32, &e->wm_conf->rotatewm);
 	sr_c(&p, pc, se_confv_offline, "rotate_sync", SS_U32, &e->wm_conf->sync_on_rotate);
 	sr_c(&p, pc, se_conflog_rotate, "rotate", SS_FUNCTION, NULL);
 	sr_c(&p, pc, se_conflog_gc, "gc", SS_FUNCTION, NULL);
 	sr_C(&p, pc, se_confv, "files", SS_U32, &rt->log_files, SR_RO, NULL);
+	sr_C(&p, pc, se_confv, "writes", SS_U64, &rt->log_writes, SR_RO, NULL);
+	sr_C(&p, pc, se_confv, "commits", SS_U64, &rt->log_commits, SR_RO, NULL);
 	return sr_C(NULL, pc, NULL, "log", SS_UNDEF, log, SR_NS, NULL);
 }
 
+static inline srconf*
+se_confpagecache(se *e, seconfrt *rt, srconf **pc)
+{
+	srconf *page_cache = *pc;
+	srconf *p = NULL;
+	sr_c(&p, pc, se_confv_offline, "limit", SS_U64, &e->pagecache.limit);
+	sr_C(&p, pc, se_confv, "used", SS_U64, &rt->page_cache_used, SR_RO, NULL);
+	sr_C(&p, pc, se_confv, "count", SS_U32, &rt->page_cache_count, SR_RO, NULL);
+	sr_C(&p, pc, se_confv, "hit", SS_U64, &rt->page_cache_hit, SR_RO, NULL);
+	sr_C(&p, pc, se_confv, "miss", SS_U64, &rt->page_cache_miss, SR_RO, NULL);
+	return sr_C(NULL, pc, NULL, "page_cache", SS_UNDEF, page_cache, SR_NS, NULL);
+}
+
 static inline srconf*
 se_conftransaction(se *e ssunused, seconfrt *rt, srconf **pc)
 {
@@ -230,8 +246,8 @@ se_conftransaction(se *e ssunused, seconfrt *rt, srconf **pc)
 	sr_C(&p, pc, se_confv, "rollback", SS_U64, &rt->tx_stat.tx_rlb, SR_RO, NULL);
 	sr_C(&p, pc, se_confv, "conflict", SS_U64, &rt->tx_stat.tx_conflict, SR_RO, NULL);
 	sr_C(&p, pc, se_confv, "lock", SS_U64, &rt->tx_stat.tx_lock, SR_RO, NULL);
-	sr_C(&p, pc, se_confv, "latency", SS_STRING, rt->tx_stat.tx_latency.sz, SR_RO, NULL);
-	sr_C(&p, pc, se_confv, "log", SS_STRING, rt->tx_stat.tx_stmts.sz, SR_RO, NULL);
+	sr_C(&p, pc, se_confv, "latency", SS_STRING, rt->tx_latency, SR_RO, NULL);
+	sr_C(&p, pc, se_confv, "log", SS_STRING, rt->tx_stmts, SR_RO, NULL);
 	sr_C(&p, pc, se_confv, "vlsn", SS_U64, &rt->tx_vlsn, SR_RO, NULL);
 	sr_C(&p, pc, se_confv, "gc", SS_U32, &rt->tx_gc, SR_RO, NULL);
 	return sr_C(NULL, pc, NULL, "transaction", SS_UNDEF, xm, SR_NS, NULL);
@@ -251,6 +267,52 @@ se_confmetric(se *e ssunused, seconfrt *rt, srconf **pc)
 	return sr_C(NULL, pc, NULL, "metric", SS_UNDEF, metric, SR_NS, NULL);
 }
 
+static inline int
+se_conftrace_enable(srconf *c, srconfstmt *s)
+{
+	int rc = se_confv(c, s);
+	if (s->op != SR_WRITE || ssunlikely(rc == -1))
+		return rc;
+	se *e = s->ptr;
+	sslist *i;
+	ss_listforeach(&e->db.list, i) {
+		sedb *db = (sedb*)sscast(i, so, link);
+		db->stat.trace = e->stat.trace;
+	}
+	return 0;
+}
+
+static inline int
+se_conftrace_reset(srconf *c, srconfstmt *s)
+{
+	if (s->op != SR_WRITE)
+		return se_confv(c, s);
+	se *e = s->ptr;
+	sr_statreset(&e->stat);
+	sslist *i;
+	ss_listforeach(&e->db.list, i) {
+		sedb *db = (sedb*)sscast(i, so, link);
+		sr_statreset(&db->stat);
+	}
+	return 0;
+}
+
+static inline srconf*
+se_conftrace(se *e, srconf **pc, int serialize)
+{
+	sr_statcopy(&e->stat, &e->statrt);
+	sr_statprepare(&e->statrt, &e->statsz);
+	srconf *trace = *pc;
+	srconf *p = NULL;
+	sr_c(&p, pc, se_conftrace_enable, "enable", SS_U32, &e->stat.trace);
+	if (! serialize)
+		sr_c(&p, pc, se_conftrace_reset, "reset", SS_FUNCTION, NULL);
+	sr_C(&p, pc, se_confv, "commit_lock", SS_STRING, e->statsz.phase[SR_PHASE_COMMITLOCK], SR_RO, NULL);
+	sr_C(&p, pc, se_confv, "log_write", SS_STRING, e->statsz.phase[SR_PHASE_LOGWRITE], SR_RO, NULL);
+	sr_C(&p, pc, se_confv, "log_sync", SS_STRING, e->statsz.phase[SR_PHASE_LOGSYNC], SR_RO, NULL);
+	return sr_C(NULL, pc, NULL, "trace", SS_UNDEF, trace, SR_NS, NULL);
+}
+
 static inline int
 se_confdb_set(srconf *c ssunused, srconfstmt *s)
 {
@@ -486,7 +548,7 @@ se_confdb(se *e, seconfrt *rt ssunused, srconf **pc, int serialize)
 	{
 		sedb *o = (sedb*)sscast(i, so, link);
 		sr_statcopy(&o->stat, &o->statrt);
-		sr_statprepare(&o->statrt);
+		sr_statprepare(&o->statrt, &o->statsz);
 		sc_profiler(&e->scheduler, &o->scp, o->index);
 		si_profilerbegin(&o->rtp, o->index);
 		si_profiler(&o->rtp);
@@ -499,6 +561,11 @@ se_confdb(se *e, seconfrt *rt ssunused, srconf **pc, int serialize)
 		sr_C(&p, pc, se_confv_dboffline, "node_size", SS_U64, &o->scheme->compaction.node_size, 0, o);
 		sr_C(&p, pc, se_confv_dboffline, "page_size", SS_U32, &o->scheme->compaction.node_page_size, 0, o);
 		sr_C(&p, pc, se_confv_dboffline, "page_checksum", SS_U32, &o->scheme->compaction.node_page_checksum, 0, o);
+		sr_C(&p, pc, se_confv_dboffline, "bloom_bits", SS_U32, &o->scheme->compaction.bloom_bits, 0, o);
+		sr_C(&p, pc, se_confv_dboffline, "parallel", SS_U32, &o->scheme->compaction.parallel, 0, o);
+		sr_C(&p, pc, se_confv_dboffline, "delta_runs", SS_U32, &o->scheme->compaction.delta_runs, 0, o);
+		sr_C(&p, pc, se_confv_dboffline, "delta_wm", SS_U32, &o->scheme->compaction.delta_wm, 0, o);
+		sr_C(&p, pc, se_confv_dboffline, "compression_threads", SS_U32, &o->scheme->compaction.compression_threads, 0, o);
 		sr_C(&p, pc, se_confv_dboffline, "expire_period", SS_U32, &o->scheme->compaction.expire_period, 0, o);
 		sr_C(&p, pc, se_confv_dboffline, "gc_wm", SS_U32, &o->scheme->compaction.gc_wm, 0, o);
 		sr_C(&p, pc, se_confv_dboffline, "gc_period", SS_U32, &o->scheme->compaction.gc_period, 0, o);
@@ -520,24 +587,38 @@ se_confdb(se *e, seconfrt *rt ssunused, srconf **pc, int serialize)
 		p = NULL;
 		sr_C(&p, pc, se_confv, "documents_used", SS_U64, &o->statrt.v_allocated, SR_RO, NULL);
 		sr_C(&p, pc, se_confv, "documents", SS_U64, &o->statrt.v_count, SR_RO, NULL);
-		sr_C(&p, pc, se_confv, "field", SS_STRING, o->statrt.field.sz, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "field", SS_STRING, o->statsz.field, SR_RO, NULL);
 		sr_C(&p, pc, se_confv, "set", SS_U64, &o->statrt.set, SR_RO, NULL);
-		sr_C(&p, pc, se_confv, "set_latency", SS_STRING, o->statrt.set_latency.sz, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "set_latency", SS_STRING, o->statsz.set_latency, SR_RO, NULL);
 		sr_C(&p, pc, se_confv, "delete", SS_U64, &o->statrt.del, SR_RO, NULL);
-		sr_C(&p, pc, se_confv, "delete_latency", SS_STRING, o->statrt.del_latency.sz, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "delete_latency", SS_STRING, o->statsz.del_latency, SR_RO, NULL);
 		sr_C(&p, pc, se_confv, "upsert", SS_U64, &o->statrt.upsert, SR_RO, NULL);
-		sr_C(&p, pc, se_confv, "upsert_latency", SS_STRING, o->statrt.upsert_latency.sz, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "upsert_latency", SS_STRING, o->statsz.upsert_latency, SR_RO, NULL);
 		sr_C(&p, pc, se_confv, "get", SS_U64, &o->statrt.get, SR_RO, NULL);
-		sr_C(&p, pc, se_confv, "get_latency", SS_STRING, o->statrt.get_latency.sz, SR_RO, NULL);
-		sr_C(&p, pc, se_confv, "get_read_disk", SS_STRING, o->statrt.get_read_disk.sz, SR_RO, NULL);
-		sr_C(&p, pc, se_confv, "get_read_cache", SS_STRING, o->statrt.get_read_cache.sz, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "get_latency", SS_STRING, o->statsz.get_latency, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "get_read_disk", SS_STRING, o->statsz.get_read_disk, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "get_read_cache", SS_STRING, o->statsz.get_read_cache, SR_RO, NULL);
 		sr_C(&p, pc, se_confv, "pread", SS_U64, &o->statrt.pread, SR_RO, NULL);
-		sr_C(&p, pc, se_confv, "pread_latency", SS_STRING, o->statrt.pread_latency.sz, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "pread_latency", SS_STRING, o->statsz.pread_latency, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "page_cache_hit", SS_U64, &o->statrt.page_cache_hit, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "page_cache_miss", SS_U64, &o->statrt.page_cache_miss, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "bloom_skip", SS_U64, &o->statrt.bloom_skip, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "bloom_false_positive", SS_U64, &o->statrt.bloom_false_positive, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "page_passthrough", SS_U64, &o->statrt.page_passthrough, SR_RO, NULL);
 		sr_C(&p, pc, se_confv, "cursor", SS_U64, &o->statrt.cursor, SR_RO, NULL);
-		sr_C(&p, pc, se_confv, "cursor_latency", SS_STRING, o->statrt.cursor_latency.sz, SR_RO, NULL);
-		sr_C(&p, pc, se_confv, "cursor_read_disk", SS_STRING, o->statrt.cursor_read_disk.sz, SR_RO, NULL);
-		sr_C(&p, pc, se_confv, "cursor_read_cache", SS_STRING, o->statrt.cursor_read_cache.sz, SR_RO, NULL);
-		sr_C(&p, pc, se_confv, "cursor_ops", SS_STRING, o->statrt.cursor_ops.sz, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "cursor_latency", SS_STRING, o->statsz.cursor_latency, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "cursor_read_disk", SS_STRING, o->statsz.cursor_read_disk, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "cursor_read_cache", SS_STRING, o->statsz.cursor_read_cache, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "cursor_ops", SS_STRING, o->statsz.cursor_ops, SR_RO, NULL);
+
+		/* trace */
+		srconf *trace = *pc;
+		p = NULL;
+		sr_C(&p, pc, se_confv, "index_lock", SS_STRING, o->statsz.phase[SR_PHASE_INDEXLOCK], SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "index_search", SS_STRING, o->statsz.phase[SR_PHASE_INDEXSEARCH], SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "page_read", SS_STRING, o->statsz.phase[SR_PHASE_PAGEREAD], SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "decompress", SS_STRING, o->statsz.phase[SR_PHASE_DECOMPRESS], SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "upsert", SS_STRING, o->statsz.phase[SR_PHASE_UPSERT], SR_RO, NULL);
 
 		/* scheduler */
 		srconf *scheduler = *pc;
@@ -557,6 +638,7 @@ se_confdb(se *e, seconfrt *rt ssunused, srconf **pc, int serialize)
 		sr_C(&p, pc, se_confv, "count_dup", SS_U64, &o->rtp.count_dup, SR_RO, NULL);
 		sr_C(&p, pc, se_confv, "read_disk", SS_U64, &o->rtp.read_disk, SR_RO, NULL);
 		sr_C(&p, pc, se_confv, "read_cache", SS_U64, &o->rtp.read_cache, SR_RO, NULL);
+		sr_C(&p, pc, se_confv, "writers_max", SS_U32, &o->rtp.writers_max, SR_RO, NULL);
 		sr_C(&p, pc, se_confv, "node_count", SS_U32, &o->rtp.total_node_count, SR_RO, NULL);
 		sr_C(&p, pc, se_confv, "page_count", SS_U32, &o->rtp.total_page_count, SR_RO, NULL);
 
@@ -578,9 +660,11 @@ se_confdb(se *e, seconfrt *rt ssunused, srconf **pc, int serialize)
 		sr_C(&p, pc, se_confv_dboffline, "path", SS_STRINGPTR, &o->scheme->path, 0, o);
 		sr_C(&p, pc, se_confv_dboffline, "mmap", SS_U32, &o->scheme->mmap, 0, o);
 		sr_C(&p, pc, se_confv_dboffline, "direct_io", SS_U32, &o->scheme->direct_io, 0, o);
+		sr_C(&p, pc, se_confv, "read_ahead", SS_U32, &o->scheme->read_ahead, 0, o);
 		sr_C(&p, pc, se_confv_dboffline, "sync", SS_U32, &o->scheme->sync, 0, o);
 		sr_C(&p, pc, se_confv_dboffline, "expire", SS_U32, &o->scheme->expire, 0, o);
 		sr_C(&p, pc, se_confv_dboffline, "compression", SS_STRINGPTR, &o->scheme->compression_sz, 0, o);
+		sr_C(&p, pc, se_confv_dboffline, "memtable", SS_STRINGPTR, &o->scheme->memtable_sz, 0, o);
 		sr_C(&p, pc, se_confdb_upsert, "comparator", SS_STRING, NULL, 0, o);
 		sr_C(&p, pc, se_confdb_upsertarg, "comparator_arg", SS_STRING, NULL, 0, o);
 		sr_C(&p, pc, se_confdb_upsert, "upsert", SS_STRING, NULL, 0, o);
@@ -590,6 +674,7 @@ se_confdb(se *e, seconfrt *rt ssunused, srconf **pc, int serialize)
 		sr_C(&p, pc, NULL, "compaction", SS_UNDEF, compaction, SR_NS, o);
 		sr_C(&p, pc, NULL, "limit", SS_UNDEF, limit, SR_NS, o);
 		sr_C(&p, pc, NULL, "stat", SS_UNDEF, stat, SR_NS, o);
+		sr_C(&p, pc, NULL, "trace", SS_UNDEF, trace, SR_NS, o);
 		sr_C(&p, pc, NULL, "scheduler", SS_UNDEF, scheduler, SR_NS, o);
 		sr_C(&p, pc, NULL, "index", SS_UNDEF, index, SR_NS, o);
 		sr_C(&p, pc, se_confdb_scheme, "scheme", SS_UNDEF, scheme, SR_NS, o);
@@ -684,6 +769,8 @@ se_confprepare(se *e, seconfrt *rt, srconf *c, int serialize)
 	srconf *transaction = se_conftransaction(e, rt, &pc);
 	srconf *metric      = se_confmetric(e, rt, &pc);
 	srconf *log         = se_conflog(e, rt, &pc);
+	srconf *page_cache  = se_confpagecache(e, rt, &pc);
+	srconf *trace       = se_conftrace(e, &pc, serialize);
 	srconf *db          = se_confdb(e, rt, &pc, serialize);
 	srconf *debug       = se_confdebug(e, rt, &pc);
 
@@ -692,7 +779,9 @@ se_confprepare(se *e, seconfrt *rt, srconf *c, int serialize)
 	scheduler->next   = transaction;
 	transaction->next = metric;
 	metric->next      = log;
-	log->next         = db;
+	log->next         = page_cache;
+	page_cache->next  = trace;
+	trace->next       = db;
 	if (! serialize)
 		db->next = debug;
 	return sophia;
@@ -720,6 +809,18 @@ se_confrt(se *e, seconfrt *rt)
 
 	/* log */
 	rt->log_files = sw_managerfiles(&e->wm);
+	ss_mutexlock(&e->wm.group_lock);
+	rt->log_writes  = e->wm.writes;
+	rt->log_commits = e->wm.commits;
+	ss_mutexunlock(&e->wm.group_lock);
+
+	/* page cache */
+	ss_mutexlock(&e->pagecache.lock);
+	rt->page_cache_used  = e->pagecache.used;
+	rt->page_cache_count = e->pagecache.count;
+	rt->page_cache_hit   = e->pagecache.hit;
+	rt->page_cache_miss  = e->pagecache.miss;
+	ss_mutexunlock(&e->pagecache.lock);
 
 	/* backup */
 	ss_mutexlock(&e->scheduler.lock);
@@ -729,13 +830,12 @@ se_confrt(se *e, seconfrt *rt)
 	ss_mutexunlock(&e->scheduler.lock);
 
 	/* metric */
-	sr_seqlock(&e->seq);
-	rt->seq = e->seq;
-	sr_sequnlock(&e->seq);
+	sr_seqcopy(&e->seq, &rt->seq);
 
 	/* transaction */
-	sr_statxm_prepare(&e->xm_stat);
 	rt->tx_stat = e->xm_stat;
+	ss_histprepare(&rt->tx_stat.tx_latency, rt->tx_latency, SS_HIST_SZ);
+	ss_histprepare(&rt->tx_stat.tx_stmts, rt->tx_stmts, SS_HIST_SZ);
 	rt->tx_ro   = e->xm.count_rd;
 	rt->tx_rw   = e->xm.count_rw;
 	rt->tx_gc   = e->xm.count_gc;
@@ -25,10 +25,19 @@ struct seconfrt {
 	uint32_t backup_last_complete;
 	/* log */
 	uint32_t log_files;
+	uint64_t log_writes;
+	uint64_t log_commits;
+	/* page cache */
+	uint64_t page_cache_used;
+	uint32_t page_cache_count;
+	uint64_t page_cache_hit;
+	uint64_t page_cache_miss;
 	/* metric */
 	srseq    seq;
 	/* transaction */
 	srstatxm tx_stat;
+	char     tx_latency[SS_HIST_SZ];
+	char     tx_stmts[SS_HIST_SZ];
 	uint32_t tx_ro;
 	uint32_t tx_rw;
 	uint32_t tx_gc;
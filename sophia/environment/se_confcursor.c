@@ -78,6 +78,7 @@ static soif seconfkvif =
 	.upsert       = NULL,
 	.del          = NULL,
 	.get          = NULL,
+	.getbatch     = NULL,
 	.begin        = NULL,
 	.prepare      = NULL,
 	.commit       = NULL,
@@ -185,6 +186,7 @@ static soif seconfcursorif =
 	.upsert       = NULL,
 	.del          = NULL,
 	.get          = se_confcursor_get,
+	.getbatch     = NULL,
 	.begin        = NULL,
 	.prepare      = NULL,
 	.commit       = NULL,
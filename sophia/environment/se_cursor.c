@@ -82,6 +82,7 @@ static soif secursorif =
 	.upsert       = NULL,
 	.del          = NULL,
 	.get          = se_cursorget,
+	.getbatch     = NULL,
 	.begin        = NULL,
 	.prepare      = NULL,
 	.commit       = NULL,
@@ -113,6 +114,7 @@ so *se_cursornew(se *e, uint64_t vlsn)
 		sr_oom(&e->error);
 		return NULL;
 	}
+	c->cache->stream = 1;
 	sx_begin(&e->xm, &c->t, SX_RO, &c->log, vlsn);
 	so_pooladd(&e->cursor, &c->o);
 	return &c->o;
@@ -42,6 +42,7 @@ se_dbscheme_init(sedb *db, char *name, int size)
 	scheme->direct_io             = 0;
 	scheme->direct_io_page_size   = 4096;
 	scheme->direct_io_buffer_size = 8 * 1024 * 1024;
+	scheme->read_ahead            = 8;
 	scheme->compression           = 0;
 	scheme->compression_if        = &ss_nonefilter;
 	scheme->expire                = 0;
@@ -50,6 +51,10 @@ se_dbscheme_init(sedb *db, char *name, int size)
 		ss_strdup(&e->a, scheme->compression_if->name);
 	if (ssunlikely(scheme->compression_sz == NULL))
 		goto error;
+	scheme->memtable    = SV_INDEXRB;
+	scheme->memtable_sz = ss_strdup(&e->a, "rbtree");
+	if (ssunlikely(scheme->memtable_sz == NULL))
+		goto error;
 	sf_upsertinit(&scheme->upsert);
 	sf_schemeinit(&scheme->scheme);
 	return 0;
@@ -113,6 +118,14 @@ se_dbscheme_set(sedb *db)
 		return -1;
 	}
 	s->compression = s->compression_if != &ss_nonefilter;
+	/* in-memory index */
+	int memtable = sv_indextype(s->memtable_sz);
+	if (ssunlikely(memtable == -1)) {
+		sr_error(&e->error, "unknown memtable type '%s'",
+		         s->memtable_sz);
+		return -1;
+	}
+	s->memtable = memtable;
 	/* path */
 	if (s->path == NULL) {
 		char path[1024];
@@ -133,6 +146,16 @@ se_dbscheme_set(sedb *db)
 	/* convert periodic times from sec to usec */
 	c->gc_period_us     = c->gc_period * 1000000;
 	c->expire_period_us = c->expire_period * 1000000;
+	if (ssunlikely(c->delta_runs > SI_DELTA_MAX)) {
+		sr_error(&e->error, "compaction.delta_runs is limited to %d",
+		         SI_DELTA_MAX);
+		return -1;
+	}
+	if (ssunlikely(c->compression_threads > SD_PIPE_MAX)) {
+		sr_error(&e->error, "compaction.compression_threads is limited to %d",
+		         SD_PIPE_MAX);
+		return -1;
+	}
 
 	/* .. */
 	db->r->scheme = &s->scheme;
@@ -221,23 +244,30 @@ se_dbwrite(sedb *db, sedocument *o, uint8_t flags)
 	sv_loginit_index(&log, db->index->scheme.id, db->r);
 
 	sx x;
+	se_commitlock(e);
+	sx_lock(&e->xm);
 	sxstate state =
 		sx_set_autocommit(&e->xm, &db->coindex, &x, &log, v);
+	sx_unlock(&e->xm);
 	if (ssunlikely(state != SX_COMMIT)) {
 		/* rollback */
+		sx_commitunlock(&e->xm);
 		sv_logfree(&log, db->r);
 		return 1;
 	}
 
-	/* write wal and index */
-	rc = sc_commit(&e->scheduler, &log, 0, 0);
-	if (ssunlikely(rc == -1)) {
-		svlogv *lv = sv_logat(&log, 0);
-		sv_vunref(db->r, lv->v);
-	}
+	/* assign lsn under the commit lock, write wal
+	 * and index without it */
+	sctx tx;
+	rc = sc_begin(&e->scheduler, &tx, &log, 0, 0);
+	sx_commitunlock(&e->xm);
+	if (sslikely(rc == 0))
+		rc = sc_commit(&e->scheduler, &tx);
 	sv_logfree(&log, db->r);
 
+	sx_lock(&e->xm);
 	sx_gc(&x);
+	sx_unlock(&e->xm);
 	return rc;
 
 error:
@@ -290,10 +320,18 @@ se_dbget(so *o, so *v)
 {
 	sedb *db = se_cast(o, sedb*, SEDB);
 	sedocument *key = se_cast(v, sedocument*, SEDOCUMENT);
-	uint64_t vlsn = sr_seq(db->r->seq, SR_LSN);
+	uint64_t vlsn = sr_seq(db->r->seq, SR_VLSN);
 	return se_read(db, key, NULL, vlsn, NULL);
 }
 
+static int
+se_dbgetbatch(so *o, so **keys, so **result, int count)
+{
+	sedb *db = se_cast(o, sedb*, SEDB);
+	uint64_t vlsn = sr_seq(db->r->seq, SR_VLSN);
+	return se_readbatch(db, (sedocument**)keys, result, count, vlsn);
+}
+
 static void*
 se_dbdocument(so *o)
 {
@@ -317,6 +355,7 @@ static soif sedbif =
 	.upsert       = se_dbupsert,
 	.del          = se_dbdel,
 	.get          = se_dbget,
+	.getbatch     = se_dbgetbatch,
 	.begin        = NULL,
 	.prepare      = NULL,
 	.commit       = NULL,
@@ -333,19 +372,29 @@ so *se_dbnew(se *e, char *name, int size)
 	memset(o, 0, sizeof(*o));
 	so_init(&o->o, &se_o[SEDB], &sedbif, &e->o, &e->o);
 	sr_statinit(&o->stat);
+	o->stat.trace = e->stat.trace;
 	int rc;
 	rc = sf_limitinit(&o->limit, &e->a);
 	if (ssunlikely(rc == -1)) {
 		ss_free(&e->a, o);
 		return NULL;
 	}
-	o->a = e->a;
+	/* documents are allocated from the database slab */
+	rc = ss_aopen(&o->a, &ss_slaba, &e->a);
+	if (ssunlikely(rc == -1)) {
+		sr_oom(&e->error);
+		sf_limitfree(&o->limit, &e->a);
+		ss_free(&e->a, o);
+		return NULL;
+	}
 	o->index = si_init(&e->r, &o->o);
 	if (ssunlikely(o->index == NULL)) {
 		sf_limitfree(&o->limit, &e->a);
+		ss_aclose(&o->a);
 		ss_free(&e->a, o);
 		return NULL;
 	}
+	o->index->pagecache = &e->pagecache;
 	o->r = si_r(o->index);
 	o->scheme = si_scheme(o->index);
 
@@ -353,6 +402,7 @@ so *se_dbnew(se *e, char *name, int size)
 	if (ssunlikely(rc == -1)) {
 		sf_limitfree(&o->limit, &e->a);
 		si_close(o->index);
+		ss_aclose(&o->a);
 		ss_free(&e->a, o);
 		return NULL;
 	}
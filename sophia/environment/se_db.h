@@ -23,7 +23,8 @@ struct sedb {
 	sxindex    coindex;
 	sflimit    limit;
 	srstat     stat;
-	srstat     statrt;
+	srstatv    statrt;
+	srstatsz   statsz;
 };
 
 int  se_dbopen(so*);
@@ -101,15 +101,12 @@ int se_document_create(sedocument *o, uint8_t flags)
 	return 0;
 }
 
-int se_document_createkey(sedocument *o)
+static inline int
+se_document_preparekey(sedocument *o)
 {
 	sedb *db = (sedb*)o->o.parent;
 	se *e = se_of(&db->o);
 
-	if (o->created)
-		return 0;
-	assert(o->v == NULL);
-
 	/* set prefix */
 	if (o->prefix) {
 		if (db->scheme->scheme.keys[0]->type != SS_STRING)
@@ -136,7 +133,34 @@ int se_document_createkey(sedocument *o)
 		o->fields_count = db->scheme->scheme.fields_count;
 		o->fields_count_keys = db->scheme->scheme.keys_count;
 	}
+	return 0;
+}
+
+int se_document_createkey(sedocument *o)
+{
+	sedb *db = (sedb*)o->o.parent;
+	se *e = se_of(&db->o);
+
+	if (o->created) {
+		if (sslikely(! o->shared))
+			return 0;
+		/* read result may reference an in-memory version
+		 * of the index, transaction tracks its own copy
+		 * of the key */
+		svv *v = sv_vbuildraw(db->r, sv_vpointer(o->v));
+		if (ssunlikely(v == NULL))
+			return sr_oom(&e->error);
+		sf_flagsset(db->r->scheme, sv_vpointer(v), SVGET);
+		si_gcv(db->r, o->v);
+		o->v = v;
+		o->shared = 0;
+		return 0;
+	}
+	assert(o->v == NULL);
 
+	int rc = se_document_preparekey(o);
+	if (ssunlikely(rc == -1))
+		return -1;
 	o->v = sv_vbuild(db->r, o->fields);
 	if (ssunlikely(o->v == NULL))
 		return sr_oom(&e->error);
@@ -145,6 +169,33 @@ int se_document_createkey(sedocument *o)
 	return 0;
 }
 
+char *se_document_key(sedocument *o, ssbuf *buf)
+{
+	sedb *db = (sedb*)o->o.parent;
+	se *e = se_of(&db->o);
+
+	if (o->created)
+		return sv_vpointer(o->v);
+
+	/* encode a transient lookup key, the buffer
+	 * is expected to have reserved space */
+	int rc = se_document_preparekey(o);
+	if (ssunlikely(rc == -1))
+		return NULL;
+	sfscheme *scheme = db->r->scheme;
+	int size = sf_writesize(scheme, o->fields);
+	rc = ss_bufensure(buf, &e->a, (size + 7) & ~7);
+	if (ssunlikely(rc == -1)) {
+		sr_oom(&e->error);
+		return NULL;
+	}
+	char *key = buf->p;
+	sf_write(scheme, o->fields, key);
+	sf_flagsset(scheme, key, SVGET);
+	ss_bufadvance(buf, (size + 7) & ~7);
+	return key;
+}
+
 static void
 se_document_free(so *o)
 {
@@ -167,6 +218,7 @@ se_document_destroy(so *o)
 	v->prefix_copy = NULL;
 	v->prefix = NULL;
 	v->created = 0;
+	v->shared = 0;
 	so_mark_destroyed(&v->o);
 	so_poolgc(&e->document, &v->o);
 	return 0;
@@ -455,6 +507,7 @@ static soif sedocumentif =
 	.upsert       = NULL,
 	.del          = NULL,
 	.get          = NULL,
+	.getbatch     = NULL,
 	.begin        = NULL,
 	.prepare      = NULL,
 	.commit       = NULL,
@@ -14,6 +14,7 @@ typedef struct sedocument sedocument;
 struct sedocument {
 	so        o;
 	int       created;
+	int       shared;
 	svv      *v;
 	ssorder   order;
 	int       orderset;
@@ -37,6 +38,7 @@ struct sedocument {
 so *se_document_new(se*, so*, svv*);
 int se_document_create(sedocument*, uint8_t);
 int se_document_createkey(sedocument*);
+char *se_document_key(sedocument*, ssbuf*);
 
 static inline int
 se_document_validate(sedocument *o, so *dest)
@@ -56,6 +56,7 @@ se_readresult(se *e, sedb *db, siread *r)
 	}
 
 	v->created   = 1;
+	v->shared    = 1;
 	return &v->o;
 }
 
@@ -68,19 +69,24 @@ so *se_read(sedb *db, sedocument *o, sx *x, uint64_t vlsn,
 
 	uint64_t start = ss_utime();
 
-	/* prepare the key */
 	int rc = se_document_validate_ro(o, &db->o);
-	if (ssunlikely(rc == -1))
-		goto error;
-	rc = se_document_createkey(o);
 	if (ssunlikely(rc == -1))
 		goto error;
 
 	sedocument *ret = NULL;
 	svv *vup = NULL;
+	char *key;
+	char keyreserve[256];
+	ssbuf keybuf;
+	ss_bufinit_reserve(&keybuf, keyreserve, sizeof(keyreserve));
 
 	/* concurrent */
 	if (x && o->order == SS_EQ) {
+		/* key is tracked by the transaction */
+		rc = se_document_createkey(o);
+		if (ssunlikely(rc == -1))
+			goto error;
+		key = sv_vpointer(o->v);
 		/* note: prefix is ignored during concurrent
 		 * index search */
 		int rc = sx_get(x, &db->coindex, o->v, &vup);
@@ -99,6 +105,11 @@ so *se_read(sedb *db, sedocument *o, sx *x, uint64_t vlsn,
 			return &ret->o;
 		}
 	} else {
+		/* transient key, no allocation unless
+		 * the key is large */
+		key = se_document_key(o, &keybuf);
+		if (ssunlikely(key == NULL))
+			goto error;
 		sx_get_autocommit(&e->xm, &db->coindex);
 	}
 
@@ -110,18 +121,17 @@ so *se_read(sedb *db, sedocument *o, sx *x, uint64_t vlsn,
 		if (ssunlikely(cache == NULL)) {
 			if (vup)
 				sv_vunref(db->r, vup);
+			ss_buffree(&keybuf, &e->a);
 			sr_oom(&e->error);
 			goto error;
 		}
 	}
 
-	sv_vref(o->v);
-
 	/* do read */
 	siread rq;
 	si_readopen(&rq, db->index, cache, o->order,
 	            vlsn,
-	            sv_vpointer(o->v),
+	            key,
 	            vup ? sv_vpointer(vup): NULL,
 	            o->prefix_copy,
 	            o->prefix_size,
@@ -138,12 +148,11 @@ so *se_read(sedb *db, sedocument *o, sx *x, uint64_t vlsn,
 	}
 
 	/* cleanup */
-	if (o->v)
-		sv_vunref(db->r, o->v);
+	ss_buffree(&keybuf, &e->a);
 	if (vup)
 		sv_vunref(db->r, vup);
 	if (ret == NULL && rq.result)
-		sv_vunref(db->r, rq.result);
+		si_gcv(db->r, rq.result);
 	if (cachegc && cache)
 		si_cachepool_push(cache);
 
@@ -154,3 +163,110 @@ error:
 	return NULL;
 }
 
+
+int se_readbatch(sedb *db, sedocument **keys, so **result, int count,
+                 uint64_t vlsn)
+{
+	se *e = se_of(&db->o);
+	int k;
+	for (k = 0; k < count; k++)
+		result[k] = NULL;
+
+	/* upsert and range searches use a generic path */
+	int batch = !sf_upserthas(&db->scheme->upsert);
+	for (k = 0; k < count && batch; k++)
+		batch = keys[k]->order == SS_EQ;
+	if (! batch) {
+		for (k = 0; k < count; k++)
+			result[k] = se_read(db, keys[k], NULL, vlsn, NULL);
+		return 0;
+	}
+
+	siread *rq = NULL;
+	sicache *cache = NULL;
+	char keyreserve[1024];
+	ssbuf keybuf;
+	ss_bufinit_reserve(&keybuf, keyreserve, sizeof(keyreserve));
+	if (ssunlikely(! se_active(e)))
+		goto error;
+
+	uint64_t start = ss_utime();
+
+	rq = ss_malloc(&e->a, (sizeof(siread) + sizeof(siread*)) * count);
+	if (ssunlikely(rq == NULL)) {
+		sr_oom(&e->error);
+		goto error;
+	}
+
+	/* prepare keys, all keys are encoded into a single
+	 * buffer and referenced by offset until it is complete */
+	siread **q = (siread**)(rq + count);
+	uintptr_t *offset = (uintptr_t*)q;
+	int rc;
+	for (k = 0; k < count; k++) {
+		rc = se_document_validate_ro(keys[k], &db->o);
+		if (ssunlikely(rc == -1))
+			goto error;
+		char *key = se_document_key(keys[k], &keybuf);
+		if (ssunlikely(key == NULL))
+			goto error;
+		offset[k] = UINTPTR_MAX;
+		if (! keys[k]->created)
+			offset[k] = key - keybuf.s;
+	}
+	sx_get_autocommit(&e->xm, &db->coindex);
+
+	cache = si_cachepool_pop(&e->cachepool);
+	if (ssunlikely(cache == NULL)) {
+		sr_oom(&e->error);
+		goto error;
+	}
+
+	/* do read, results are returned in request order */
+	for (k = 0; k < count; k++) {
+		sedocument *o = keys[k];
+		char *key;
+		if (offset[k] == UINTPTR_MAX)
+			key = sv_vpointer(o->v);
+		else
+			key = keybuf.s + offset[k];
+		si_readopen(&rq[k], db->index, cache, SS_EQ,
+		            vlsn,
+		            key,
+		            NULL,
+		            o->prefix_copy,
+		            o->prefix_size,
+		            0,
+		            start);
+		q[k] = &rq[k];
+	}
+	rc = si_readbatch(q, count);
+
+	/* prepare result and cleanup */
+	for (k = 0; k < count; k++) {
+		sedocument *o = keys[k];
+		siread *p = &rq[k];
+		if (rc == 0 && p->result) {
+			result[k] = se_readresult(e, db, p);
+			if (result[k])
+				o->prefix_copy = NULL;
+		}
+		if (result[k] == NULL && p->result)
+			si_gcv(db->r, p->result);
+		si_readclose(p);
+		so_destroy(&o->o);
+	}
+	ss_free(&e->a, rq);
+	ss_buffree(&keybuf, &e->a);
+	si_cachepool_push(cache);
+	return rc;
+error:
+	if (rq)
+		ss_free(&e->a, rq);
+	ss_buffree(&keybuf, &e->a);
+	if (cache)
+		si_cachepool_push(cache);
+	for (k = 0; k < count; k++)
+		so_destroy(&keys[k]->o);
+	return -1;
+}
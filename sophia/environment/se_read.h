@@ -10,5 +10,6 @@
 */
 
 so *se_read(sedb*, sedocument*, sx*, uint64_t, sicache*);
+int se_readbatch(sedb*, sedocument**, so**, int, uint64_t);
 
 #endif
@@ -20,29 +20,113 @@
 #include <libsc.h>
 #include <libse.h>
 
-static int
-se_recover_log(se *e, sw *log)
+/* log replay.
+ *
+ * Journal is decoded and validated by a reader thread
+ * into batches of whole transactions, while the current
+ * thread inserts a previous batch into node indexes.
+ * Recovered documents are not tracked by the
+ * transaction manager.
+*/
+
+typedef struct serecoverbatch serecoverbatch;
+typedef struct serecover serecover;
+
+enum {
+	SE_RECOVERBATCH = 4096
+};
+
+struct serecoverbatch {
+	svlog    log;
+	uint64_t lsn;
+	int      ready;
+};
+
+struct serecover {
+	se             *e;
+	sw             *log;
+	ssmutex         lock;
+	sscond          cond;
+	serecoverbatch  batch[2];
+	int             eof;
+	int             stop;
+	int             rc;
+};
+
+static serecoverbatch*
+se_recover_push(serecover *p, int *current)
+{
+	ss_mutexlock(&p->lock);
+	p->batch[*current].ready = 1;
+	*current = !*current;
+	serecoverbatch *b = &p->batch[*current];
+	ss_condbroadcast(&p->cond);
+	while (b->ready && !p->stop)
+		ss_condwait(&p->cond, &p->lock);
+	if (p->stop)
+		b = NULL;
+	ss_mutexunlock(&p->lock);
+	return b;
+}
+
+static void
+se_recover_eof(serecover *p, int rc)
+{
+	ss_mutexlock(&p->lock);
+	p->rc  = rc;
+	p->eof = 1;
+	ss_condbroadcast(&p->cond);
+	ss_mutexunlock(&p->lock);
+}
+
+static inline int
+se_recover_add(serecover *p, serecoverbatch *b, sedb *db, swv *v)
+{
+	se *e = p->e;
+	char *data = sw_vpointer(v);
+	int flags = sf_flags(db->r->scheme, data);
+	if (ssunlikely(flags == SVUPSERT &&
+	               !sf_upserthas(&db->scheme->upsert)))
+		return sr_error(&e->error, "%s", "upsert callback is not set");
+	svv *vv = sv_vbuildraw(db->r, data);
+	if (ssunlikely(vv == NULL))
+		return sr_oom(&e->error);
+	vv->log = p->log;
+	svlogv lv;
+	sv_logvinit(&lv, v->dsn);
+	lv.v = vv;
+	int rc = sv_logadd(&b->log, db->r, &lv);
+	if (ssunlikely(rc == -1)) {
+		sv_vunref(db->r, vv);
+		return sr_oom(&e->error);
+	}
+	b->lsn = sf_lsn(db->r->scheme, data);
+	return 0;
+}
+
+static void*
+se_recover_reader(void *arg)
 {
-	so *tx = NULL;
+	ssthread *self = arg;
+	serecover *p = self->arg;
+	se *e = p->e;
+	sw *log = p->log;
 	sedb *db = NULL;
+	int current = 0;
+	serecoverbatch *b = &p->batch[current];
+	int processed = 0;
 	ssiter i;
 	ss_iterinit(sw_iter, &i);
-	int processed = 0;
 	int rc = ss_iteropen(sw_iter, &i, &e->r, &log->file, 1);
-	if (ssunlikely(rc == -1))
-		return -1;
+	if (ssunlikely(rc == -1)) {
+		se_recover_eof(p, -1);
+		return NULL;
+	}
 	for (;;)
 	{
 		swv *v = ss_iteratorof(&i);
 		if (ssunlikely(v == NULL))
 			break;
-
-		/* reply transaction */
-		uint64_t lsn = UINT64_MAX;
-		tx = so_begin(&e->o);
-		if (ssunlikely(tx == NULL))
-			goto error;
-
 		while (ss_iteratorhas(&i)) {
 			v = ss_iteratorof(&i);
 			/* match a database */
@@ -52,28 +136,11 @@ se_recover_log(se *e, sw *log)
 			if (ssunlikely(db == NULL)) {
 				sr_malfunction(&e->error, "database id %" PRIu32
 				               " is not declared", dsn);
-				goto rlb;
-			}
-			char *data = sw_vpointer(v);
-			lsn = sf_lsn(db->r->scheme, data);
-			so *o = so_document(&db->o);
-			if (ssunlikely(o == NULL))
-				goto rlb;
-			so_setstring(o, "raw", data, 0);
-			so_setstring(o, "log", log, 0);
-			
-			int flags = sf_flags(db->r->scheme, data);
-			if (flags == SVDELETE) {
-				rc = so_delete(tx, o);
-			} else
-			if (flags == SVUPSERT) {
-				rc = so_upsert(tx, o);
-			} else {
-				assert(flags == 0);
-				rc = so_set(tx, o);
+				goto error;
 			}
+			rc = se_recover_add(p, b, db, v);
 			if (ssunlikely(rc == -1))
-				goto rlb;
+				goto error;
 			ss_gcmark(&log->gc, 1);
 			processed++;
 			if ((processed % 100000) == 0)
@@ -81,12 +148,14 @@ se_recover_log(se *e, sw *log)
 			ss_iteratornext(&i);
 		}
 		if (ssunlikely(sw_iter_error(&i)))
-			goto rlb;
-
-		so_setint(tx, "lsn", lsn);
-		rc = so_commit(tx);
-		if (ssunlikely(rc != 0))
 			goto error;
+
+		/* pass whole transactions for apply */
+		if (sv_logcount(&b->log) >= SE_RECOVERBATCH) {
+			b = se_recover_push(p, &current);
+			if (ssunlikely(b == NULL))
+				goto error;
+		}
 		rc = sw_iter_continue(&i);
 		if (ssunlikely(rc == -1))
 			goto error;
@@ -94,12 +163,98 @@ se_recover_log(se *e, sw *log)
 			break;
 	}
 	ss_iteratorclose(&i);
-	return 0;
-rlb:
-	so_destroy(tx);
+	if (sv_logcount(&b->log) > 0)
+		se_recover_push(p, &current);
+	se_recover_eof(p, 0);
+	return NULL;
 error:
 	ss_iteratorclose(&i);
-	return -1;
+	se_recover_eof(p, -1);
+	return NULL;
+}
+
+static inline void
+se_recover_batchfree(se *e, serecoverbatch *b)
+{
+	/* free documents which were not applied */
+	ssiter i;
+	ss_iterinit(ss_bufiter, &i);
+	ss_iteropen(ss_bufiter, &i, &b->log.buf, sizeof(svlogv));
+	for (; ss_iterhas(ss_bufiter, &i); ss_iternext(ss_bufiter, &i))
+	{
+		svlogv *lv = ss_iterof(ss_bufiter, &i);
+		sv_vunref(sv_logindex(&b->log, lv->index_id)->r, lv->v);
+	}
+	sv_logfree(&b->log, &e->r);
+}
+
+static int
+se_recover_log(se *e, sw *log)
+{
+	serecover p;
+	memset(&p, 0, sizeof(p));
+	p.e   = e;
+	p.log = log;
+	ss_mutexinit(&p.lock);
+	ss_condinit(&p.cond);
+	int rc;
+	int k = 0;
+	while (k < 2) {
+		serecoverbatch *b = &p.batch[k];
+		rc = sv_loginit(&b->log, &e->r, e->db.n);
+		if (ssunlikely(rc == -1)) {
+			sr_oom(&e->error);
+			goto done;
+		}
+		sslist *i;
+		ss_listforeach(&e->db.list, i) {
+			sedb *db = (sedb*)sscast(i, so, link);
+			sv_loginit_index(&b->log, db->index->scheme.id, db->r);
+		}
+		k++;
+	}
+
+	ssthread reader;
+	rc = ss_threadnew(&reader, se_recover_reader, &p);
+	if (ssunlikely(rc == -1)) {
+		sr_malfunction(&e->error, "%s", "failed to start log reader thread");
+		goto done;
+	}
+	int current = 0;
+	for (;;) {
+		serecoverbatch *b = &p.batch[current];
+		ss_mutexlock(&p.lock);
+		while (! b->ready && ! p.eof)
+			ss_condwait(&p.cond, &p.lock);
+		int ready = b->ready;
+		ss_mutexunlock(&p.lock);
+		if (! ready)
+			break;
+		rc = sc_replay(&e->scheduler, &b->log, b->lsn);
+		ss_mutexlock(&p.lock);
+		sv_logreset(&b->log, e->db.n);
+		b->lsn   = 0;
+		b->ready = 0;
+		if (ssunlikely(rc == -1))
+			p.stop = 1;
+		ss_condbroadcast(&p.cond);
+		ss_mutexunlock(&p.lock);
+		if (ssunlikely(rc == -1))
+			break;
+		current = !current;
+	}
+	ss_threadjoin(&reader);
+	if (rc == 0)
+		rc = p.rc;
+done:
+	k = 0;
+	while (k < 2) {
+		se_recover_batchfree(e, &p.batch[k]);
+		k++;
+	}
+	ss_condfree(&p.cond);
+	ss_mutexfree(&p.lock);
+	return rc;
 }
 
 static inline int
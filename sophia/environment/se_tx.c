@@ -118,10 +118,12 @@ static inline void
 se_txend(setx *t, int rlb, int conflict)
 {
 	se *e = se_of(&t->o);
-	sx_gc(&t->t);
 	uint32_t count = sv_logcount(&t->log);
-	sv_logreset(&t->log, e->db.n);
+	sx_lock(&e->xm);
+	sx_gc(&t->t);
 	sr_statxm(&e->xm_stat, t->start, count, rlb, conflict);
+	sx_unlock(&e->xm);
+	sv_logreset(&t->log, e->db.n);
 	so_mark_destroyed(&t->o);
 	so_poolgc(&e->tx, &t->o);
 }
@@ -130,7 +132,10 @@ static int
 se_txdestroy(so *o)
 {
 	setx *t = se_cast(o, setx*, SETX);
+	se *e = se_of(o);
+	sx_lock(&e->xm);
 	sx_rollback(&t->t);
+	sx_unlock(&e->xm);
 	se_txend(t, 1, 0);
 	return 0;
 }
@@ -140,6 +145,10 @@ se_txprepare(sx *x, svv *v, so *o, void *ptr)
 {
 	sicache *cache = ptr;
 	sedb *db = (sedb*)o;
+	se *e = se_of(o);
+	/* statements of commits which are not visible
+	 * yet must be in the index */
+	sc_commitwait(&e->scheduler, sr_seq(&e->seq, SR_LSN));
 	siread rq;
 	si_readopen(&rq, db->index, cache,
 	            SS_EQ,
@@ -167,6 +176,7 @@ se_txcommit(so *o)
 	int rc;
 
 	/* prepare transaction */
+	se_commitlock(e);
 	if (t->t.state == SX_READY || t->t.state == SX_LOCK)
 	{
 		sicache *cache = NULL;
@@ -174,43 +184,44 @@ se_txcommit(so *o)
 		if (! recover) {
 			prepare = se_txprepare;
 			cache = si_cachepool_pop(&e->cachepool);
-			if (ssunlikely(cache == NULL))
+			if (ssunlikely(cache == NULL)) {
+				sx_commitunlock(&e->xm);
 				return sr_oom(&e->error);
+			}
 		}
+		sx_lock(&e->xm);
 		sxstate s = sx_prepare(&t->t, prepare, cache);
 		if (cache)
 			si_cachepool_push(cache);
 		if (s == SX_LOCK) {
 			sr_statxm_lock(&e->xm_stat);
+			sx_unlock(&e->xm);
+			sx_commitunlock(&e->xm);
 			return 2;
 		}
 		if (s == SX_ROLLBACK) {
 			sx_rollback(&t->t);
+			sx_unlock(&e->xm);
+			sx_commitunlock(&e->xm);
 			se_txend(t, 0, 1);
 			return 1;
 		}
 		assert(s == SX_PREPARE);
 
 		sx_commit(&t->t);
+		sx_unlock(&e->xm);
 	}
 	assert(t->t.state == SX_COMMIT);
 
-	/* wal write and multi-index write */
-	rc = sc_commit(&e->scheduler, &t->log, t->lsn, recover);
-	if (ssunlikely(rc == -1)) {
-		/* free the transaction log in case of
-		 * commit error */
-		ssiter i;
-		ss_iterinit(ss_bufiter, &i);
-		ss_iteropen(ss_bufiter, &i, &t->log.buf, sizeof(svlogv));
-		for (; ss_iterhas(ss_bufiter, &i); ss_iternext(ss_bufiter, &i))
-		{
-			svlogv *lv = ss_iterof(ss_bufiter, &i);
-			sedb *db = (sedb*)se_dbmatch_id(e, lv->index_id);
-			assert(db != NULL);
-			sv_vunref(db->r, lv->v);
-		}
-	}
+	/* assign lsn under the commit lock, wal write and
+	 * multi-index write run without it */
+	/* versions are released by sc_begin() and
+	 * sc_commit() on error */
+	sctx tx;
+	rc = sc_begin(&e->scheduler, &tx, &t->log, t->lsn, recover);
+	sx_commitunlock(&e->xm);
+	if (sslikely(rc == 0))
+		rc = sc_commit(&e->scheduler, &tx);
 	se_txend(t, 0, 0);
 	return rc;
 }
@@ -230,8 +241,13 @@ static int64_t
 se_txget_int(so *o, const char *path)
 {
 	setx *t = se_cast(o, setx*, SETX);
-	if (strcmp(path, "deadlock") == 0)
-		return sx_deadlock(&t->t);
+	if (strcmp(path, "deadlock") == 0) {
+		se *e = se_of(o);
+		sx_lock(&e->xm);
+		int rc = sx_deadlock(&t->t);
+		sx_unlock(&e->xm);
+		return rc;
+	}
 	return -1;
 }
 
@@ -250,6 +266,7 @@ static soif setxif =
 	.upsert       = se_txupsert,
 	.del          = se_txdelete,
 	.get          = se_txget,
+	.getbatch     = NULL,
 	.begin        = NULL,
 	.prepare      = NULL,
 	.commit       = se_txcommit,
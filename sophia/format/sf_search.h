@@ -0,0 +1,106 @@
+#ifndef SF_SEARCH_H_
+#define SF_SEARCH_H_
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+/* scheme specialized key search.
+ *
+ * The first key part of a searched key is normalized once
+ * into an unsigned 64-bit value which keeps the key order:
+ * numeric values are widened (inverted for _rev types) and
+ * strings are represented by the first 8 bytes in big-endian
+ * order. A probe is compared by its normalized value and falls
+ * back to sf_compare() only if the values are equal.
+*/
+
+typedef struct sfsearch sfsearch;
+
+struct sfsearch {
+	sfscheme *scheme;
+	sffield  *field;
+	char     *key;
+	uint64_t  value;
+	int       normalized;
+	int       exact;
+};
+
+static inline uint64_t
+sf_searchprefix(char *p, uint32_t size)
+{
+	uint64_t v = 0;
+	memcpy(&v, p, (size < sizeof(v)) ? size : sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+static inline uint64_t
+sf_searchnormalize(sfsearch *s, char *data)
+{
+	sffield *f = s->field;
+	char *p = data + f->fixed_offset;
+	switch (f->type) {
+	case SS_U8:     return *(uint8_t*)p;
+	case SS_U8REV:  return UINT8_MAX - *(uint8_t*)p;
+	case SS_U16:    return *(uint16_t*)p;
+	case SS_U16REV: return UINT16_MAX - *(uint16_t*)p;
+	case SS_U32:    return sscastu32(p);
+	case SS_U32REV: return UINT32_MAX - sscastu32(p);
+	case SS_U64:    return sscastu64(p);
+	case SS_U64REV: return UINT64_MAX - sscastu64(p);
+	default: break;
+	}
+	uint32_t size;
+	p = sf_fieldptr(s->scheme, f, data, &size);
+	return sf_searchprefix(p, size);
+}
+
+static inline void
+sf_searchinit(sfsearch *s, sfscheme *scheme, char *key)
+{
+	s->scheme     = scheme;
+	s->field      = scheme->keys[0];
+	s->key        = key;
+	s->value      = 0;
+	s->exact      = 0;
+	/* user comparator defines its own order */
+	s->normalized = key != NULL && scheme->cmp == NULL;
+	if (ssunlikely(! s->normalized))
+		return;
+	switch (s->field->type) {
+	case SS_STRING:
+		break;
+	case SS_U8: case SS_U8REV:
+	case SS_U16: case SS_U16REV:
+	case SS_U32: case SS_U32REV:
+	case SS_U64: case SS_U64REV:
+		s->exact = scheme->keys_count == 1;
+		break;
+	default:
+		s->normalized = 0;
+		return;
+	}
+	s->value = sf_searchnormalize(s, key);
+}
+
+static inline int
+sf_searchcmp(sfsearch *s, char *data)
+{
+	if (sslikely(s->normalized)) {
+		uint64_t v = sf_searchnormalize(s, data);
+		if (v != s->value)
+			return (v > s->value) ? 1 : -1;
+		if (s->exact)
+			return 0;
+	}
+	return sf_compare(s->scheme, data, s->key);
+}
+
+#endif
@@ -27,27 +27,52 @@ si *si_init(sr *r, so *object)
 		return NULL;
 	}
 	sd_cinit(&i->rdc);
+	sv_btreepool_init(&i->btree_pool);
 	ss_rbinit(&i->i);
-	ss_mutexinit(&i->lock);
+	ss_rwlockinit(&i->lock);
+	ss_epochinit(&i->epoch);
 	si_schemeinit(&i->scheme);
 	ss_listinit(&i->link);
 	ss_listinit(&i->gc);
-	i->gc_count   = 0;
-	i->read_disk  = 0;
-	i->read_cache = 0;
-	i->backup     = 0;
-	i->n          = 0;
-	i->object     = object;
+	i->gc_count    = 0;
+	i->read_disk   = 0;
+	i->read_cache  = 0;
+	i->writers     = 0;
+	i->writers_max = 0;
+	i->backup      = 0;
+	i->n           = 0;
+	i->pagecache   = NULL;
+	i->object      = object;
 	return i;
 }
 
 int si_open(si *i)
 {
-	return si_recover(i);
+	int rc = si_recover(i);
+	if (ssunlikely(rc == -1))
+		return -1;
+	/* read path shares direct io settings */
+	if (i->scheme.direct_io) {
+		int rcio = sd_ioprepare(&i->rdc.io, &i->r,
+		                        i->scheme.direct_io,
+		                        i->scheme.direct_io_page_size,
+		                        i->scheme.direct_io_buffer_size);
+		if (ssunlikely(rcio == -1))
+			return sr_oom(i->r.e);
+	}
+	return rc;
+}
+
+static inline void
+si_closenode(si *i, sinode *n)
+{
+	/* pages of the node are not left in the shared cache */
+	si_pagecachedrop(i, n);
+	si_nodefree(n, &i->r, 0);
 }
 
 ss_rbtruncate(si_truncate,
-              si_nodefree(sscast(n, sinode, node), (sr*)arg, 0))
+              si_closenode((si*)arg, sscast(n, sinode, node)))
 
 int si_close(si *i)
 {
@@ -56,6 +81,7 @@ int si_close(si *i)
 	sslist *p, *n;
 	ss_listforeach_safe(&i->gc, p, n) {
 		sinode *node = sscast(p, sinode, gc);
+		si_pagecachedrop(i, node);
 		rc = si_nodefree(node, &i->r, 1);
 		if (ssunlikely(rc == -1))
 			rc_ret = -1;
@@ -63,11 +89,12 @@ int si_close(si *i)
 	ss_listinit(&i->gc);
 	i->gc_count = 0;
 	if (i->i.root)
-		si_truncate(i->i.root, &i->r);
+		si_truncate(i->i.root, i);
 	i->i.root = NULL;
 	sd_cfree(&i->rdc, &i->r);
+	sv_btreepool_free(&i->btree_pool, &i->r);
 	si_plannerfree(&i->p, i->r.a);
-	ss_mutexfree(&i->lock);
+	ss_rwlockfree(&i->lock);
 	si_schemefree(&i->scheme, &i->r);
 	ss_free(i->r.a, i);
 	return rc_ret;
@@ -130,6 +157,7 @@ si_execute(si *i, sdc *c, siplan *plan, uint64_t vlsn)
 		rc = si_backup(i, c, plan);
 		break;
 	case SI_NODEGC:
+		si_pagecachedrop(i, plan->node);
 		rc = si_nodefree(plan->node, &i->r, 1);
 		break;
 	default:
@@ -12,30 +12,66 @@
 typedef struct si si;
 
 struct si {
-	ssmutex    lock;
-	siplanner  p;
-	ssrb       i;
-	int        n;
-	uint32_t   backup;
-	uint64_t   read_disk;
-	uint64_t   read_cache;
-	uint32_t   gc_count;
-	sslist     gc;
-	sdc        rdc;
-	sischeme   scheme;
-	so        *object;
-	sr         r;
-	sslist     link;
+	ssrwlock     lock;
+	ssepoch      epoch;
+	siplanner    p;
+	ssrb         i;
+	int          n;
+	uint32_t     backup;
+	uint64_t     read_disk;
+	uint64_t     read_cache;
+	uint32_t     writers;
+	uint32_t     writers_max;
+	uint32_t     gc_count;
+	sslist       gc;
+	sdc          rdc;
+	svbtreepool  btree_pool;
+	sischeme     scheme;
+	sdpagecache *pagecache;
+	so          *object;
+	sr           r;
+	sslist       link;
 };
 
 static inline void
 si_lock(si *i) {
-	ss_mutexlock(&i->lock);
+	ss_rwlockwr(&i->lock);
 }
 
 static inline void
 si_unlock(si *i) {
-	ss_mutexunlock(&i->lock);
+	ss_rwunlock(&i->lock);
+}
+
+/* the node tree is updated in place and traversed under
+ * the shared lock. In-memory indexes of a node are changed
+ * under the node lock, which is also taken by compaction.
+ * Reads release the index lock before disk io: the epoch
+ * keeps a replaced node alive until the read is done, node
+ * refs pin it across calls, and the gc list holds it until
+ * both are gone. */
+
+static inline void
+si_rdlock(si *i) {
+	ss_rwlockrd(&i->lock);
+}
+
+static inline void
+si_rdunlock(si *i) {
+	ss_rwunlock(&i->lock);
+}
+
+static inline void
+si_pagecachedrop(si *i, sinode *n)
+{
+	if (! sd_pagecache_enabled(i->pagecache))
+		return;
+	sd_pagecache_drop(i->pagecache, n->id, &n->index);
+	uint32_t k = 0;
+	while (k < n->delta_count) {
+		sd_pagecache_drop(i->pagecache, n->id, si_noderun(n, k));
+		k++;
+	}
 }
 
 static inline sr*
@@ -9,30 +9,80 @@
  * BSD License
 */
 
+typedef struct sicacherun sicacherun;
 typedef struct sicache sicache;
 typedef struct sicachepool sicachepool;
 
+struct sicacherun {
+	int    open;
+	ssiter i;
+	ssiter page_iter;
+	ssiter index_iter;
+	ssbuf  buf_a;
+	ssbuf  buf_b;
+};
+
 struct sicache {
 	uint64_t     nsn;
-	int          open;
 	sinode      *node;
 	sdindexpage *ref;
 	sdpage       page;
-	ssiter       i;
-	ssiter       page_iter;
-	ssiter       index_iter;
-	ssbuf        buf_a;
-	ssbuf        buf_b;
+	sicacherun   base;
+	sicacherun   delta[SI_DELTA_MAX];
+	uint32_t     delta_count;
+	svupsert     upsert;
+	sdiobatch   *prefetch;
+	sdreadahead  readahead;
+	/* streaming cursor */
+	int          stream;
+	int          stream_open;
+	sinodeview   stream_view;
+	uint32_t     stream_i0;
+	uint32_t     stream_i1;
+	ssorder      stream_order;
+	uint64_t     stream_vlsn;
+	svv         *stream_v;
+	sr          *stream_r;
+	svmerge      stream_merge;
+	ssiter       stream_merge_iter;
+	ssiter       stream_read_iter;
 	sicache     *next;
 	sicachepool *pool;
 };
 
 struct sicachepool {
+	ssspinlock lock;
 	sicache *head;
 	int n;
 	sr *r;
 };
 
+static inline void
+si_cacheruninit(sicacherun *run)
+{
+	run->open = 0;
+	memset(&run->i, 0, sizeof(run->i));
+	ss_iterinit(sd_read, &run->i);
+	ss_bufinit(&run->buf_a);
+	ss_bufinit(&run->buf_b);
+}
+
+static inline void
+si_cacherunfree(sicacherun *run, sicachepool *p)
+{
+	ss_buffree(&run->buf_a, p->r->a);
+	ss_buffree(&run->buf_b, p->r->a);
+}
+
+static inline void
+si_cacherunreset(sicacherun *run)
+{
+	ss_iterclose(sd_read, &run->i);
+	ss_bufreset(&run->buf_a);
+	ss_bufreset(&run->buf_b);
+	run->open = 0;
+}
+
 static inline void
 si_cacheinit(sicache *c, sicachepool *pool)
 {
@@ -40,50 +90,93 @@ si_cacheinit(sicache *c, sicachepool *pool)
 	c->nsn  = 0;
 	c->next = NULL;
 	c->pool = pool;
-	c->open = 0;
-	memset(&c->i, 0, sizeof(c->i));
-	ss_iterinit(sd_read, &c->i);
-	ss_bufinit(&c->buf_a);
-	ss_bufinit(&c->buf_b);
+	c->delta_count = 0;
+	si_cacheruninit(&c->base);
+	int i = 0;
+	while (i < SI_DELTA_MAX) {
+		si_cacheruninit(&c->delta[i]);
+		i++;
+	}
+	c->stream = 0;
+	c->stream_open = 0;
+	c->stream_v = NULL;
+	c->stream_r = NULL;
+	c->prefetch = NULL;
+	sd_readahead_init(&c->readahead);
+	sv_upsertinit(&c->upsert);
+	sv_mergeinit(&c->stream_merge);
+}
+
+static inline void
+si_cachestream_close(sicache *c)
+{
+	if (sslikely(! c->stream_open))
+		return;
+	si_nodeview_close(&c->stream_view);
+	si_gcv(c->stream_r, c->stream_v);
+	sv_mergereset(&c->stream_merge);
+	c->stream_v    = NULL;
+	c->stream_r    = NULL;
+	c->stream_open = 0;
 }
 
 static inline void
 si_cachefree(sicache *c)
 {
-	ss_buffree(&c->buf_a, c->pool->r->a);
-	ss_buffree(&c->buf_b, c->pool->r->a);
+	si_cachestream_close(c);
+	sv_mergefree(&c->stream_merge, c->pool->r->a);
+	sv_upsertfree(&c->upsert, c->pool->r);
+	sd_readahead_free(&c->readahead, c->pool->r);
+	si_cacherunfree(&c->base, c->pool);
+	int i = 0;
+	while (i < SI_DELTA_MAX) {
+		si_cacherunfree(&c->delta[i], c->pool);
+		i++;
+	}
+}
+
+static inline void
+si_cacheclose(sicache *c)
+{
+	si_cacherunreset(&c->base);
+	uint32_t i = 0;
+	while (i < c->delta_count) {
+		si_cacherunreset(&c->delta[i]);
+		i++;
+	}
+	sd_readahead_rewind(&c->readahead);
+	c->ref = NULL;
 }
 
 static inline void
 si_cachereset(sicache *c)
 {
-	ss_bufreset(&c->buf_a);
-	ss_bufreset(&c->buf_b);
-	ss_iterclose(sd_read, &c->i);
-	c->ref    = NULL;
-	c->open   = 0;
-	c->node   = NULL;
-	c->nsn    = 0;
+	si_cachestream_close(c);
+	c->stream = 0;
+	si_cacheclose(c);
+	sd_readahead_reset(&c->readahead);
+	c->node        = NULL;
+	c->nsn         = 0;
+	c->delta_count = 0;
 }
 
 static inline int
 si_cachevalidate(sicache *c, sinode *n)
 {
-	if (sslikely(c->node == n && c->nsn == n->id))
+	if (sslikely(c->node == n && c->nsn == n->id &&
+	             c->delta_count == n->delta_count))
 		return 0;
-	ss_iterclose(sd_read, &c->i);
-	ss_bufreset(&c->buf_a);
-	ss_bufreset(&c->buf_b);
-	c->ref  = NULL;
-	c->open = 0;
-	c->node = n;
-	c->nsn  = n->id;
+	si_cacheclose(c);
+	c->node        = n;
+	c->nsn         = n->id;
+	c->delta_count = n->delta_count;
 	return 0;
 }
 
 static inline void
 si_cachepool_init(sicachepool *p, sr *r)
 {
+	ss_spinlockinit(&p->lock);
 	p->head = NULL;
 	p->n    = 0;
 	p->r    = r;
@@ -100,20 +193,24 @@ si_cachepool_free(sicachepool *p)
 		ss_free(p->r->a, c);
 		c = next;
 	}
+	ss_spinlockfree(&p->lock);
 }
 
 static inline sicache*
 si_cachepool_pop(sicachepool *p)
 {
 	sicache *c;
+	ss_spinlock(&p->lock);
 	if (sslikely(p->n > 0)) {
 		c = p->head;
 		p->head = c->next;
 		p->n--;
+		ss_spinunlock(&p->lock);
 		si_cachereset(c);
 		c->pool = p;
 		return c;
 	}
+	ss_spinunlock(&p->lock);
 	c = ss_malloc(p->r->a, sizeof(sicache));
 	if (ssunlikely(c == NULL))
 		return NULL;
@@ -124,10 +221,14 @@ si_cachepool_pop(sicachepool *p)
 static inline void
 si_cachepool_push(sicache *c)
 {
+	si_cachestream_close(c);
 	sicachepool *p = c->pool;
+	sv_upsertgc(&c->upsert, p->r, 600, 512);
+	ss_spinlock(&p->lock);
 	c->next = p->head;
 	p->head = c;
 	p->n++;
+	ss_spinunlock(&p->lock);
 }
 
 #endif
@@ -85,9 +85,11 @@ si_redistribute_set(si *index, sr *r, svv *v)
 	sinode *node = ss_iterof(si_iter, &i);
 	assert(node != NULL);
 	/* update node */
+	si_nodewrlock(node);
 	svindex *vindex = si_nodeindex(node);
 	sv_indexset(vindex, r, v);
 	node->used += sv_vsize(v, &index->r);
+	si_noderwunlock(node);
 	/* schedule node */
 	si_plannerupdate(&index->p, node);
 }
@@ -138,6 +140,7 @@ static inline int
 si_split(si *index, sdc *c, ssbuf *result,
          sinode   *parent,
          ssiter   *i,
+         ssiter   *passthrough,
          uint64_t  size_node,
          uint64_t  size_stream,
          uint32_t  stream,
@@ -152,14 +155,23 @@ si_split(si *index, sdc *c, ssbuf *result,
 		.size_node           = size_node,
 		.size_page           = index->scheme.compaction.node_page_size,
 		.checksum            = index->scheme.compaction.node_page_checksum,
+		.bloom_bits          = index->scheme.compaction.bloom_bits,
 		.expire              = index->scheme.expire,
 		.timestamp           = timestamp,
 		.compression         = index->scheme.compression,
 		.compression_if      = index->scheme.compression_if,
 		.direct_io           = index->scheme.direct_io,
 		.direct_io_page_size = index->scheme.direct_io_page_size,
-		.vlsn                = vlsn
+		.vlsn                = vlsn,
+		.passthrough         = passthrough,
+		.pipe                = NULL
 	};
+	/* compress pages in separate threads of the worker
+	 * pipeline, merge is synchronous if the threads
+	 * cannot be started */
+	uint32_t threads = index->scheme.compaction.compression_threads;
+	if (threads > 0 && index->scheme.compression)
+		mergeconf.pipe = sd_cpipe(c, r, threads);
 	sinode *n = NULL;
 	sdmerge merge;
 	rc = sd_mergeinit(&merge, r, i, &c->build, &c->build_index,
@@ -170,7 +182,7 @@ si_split(si *index, sdc *c, ssbuf *result,
 	{
 		/* create new node */
 		uint64_t id = sr_seq(index->r.seq, SR_NSNNEXT);
-		n = si_nodenew(r, id, parent->id);
+		n = si_nodenew(r, &index->scheme, id, parent->id);
 		if (ssunlikely(n == NULL))
 			goto error;
 		rc = si_nodecreate(n, r, &index->scheme);
@@ -227,30 +239,12 @@ error:
 }
 
 static int
-si_merge(si *index, sdc *c, sinode *node,
-         uint64_t vlsn,
-         ssiter *stream,
-         uint64_t size_stream,
-         uint32_t n_stream)
+si_merge(si *index, sdc *c, sinode *node)
 {
 	sr *r = &index->r;
 	ssbuf *result = &c->a;
 	ssiter i;
-
-	/* begin compaction.
-	 *
-	 * Split merge stream into a number of
-	 * a new nodes.
-	 */
 	int rc;
-	rc = si_split(index, c, result,
-	              node, stream,
-	              index->scheme.compaction.node_size,
-	              size_stream,
-	              n_stream,
-	              vlsn);
-	if (ssunlikely(rc == -1))
-		return -1;
 
 	SS_INJECTION(r->i, SS_INJECTION_SI_COMPACTION_0,
 	             si_splitfree(result, r);
@@ -281,8 +275,10 @@ si_merge(si *index, sdc *c, sinode *node,
 		count++;
 	}
 
-	/* commit compaction changes */
+	/* commit compaction changes, range reads use the
+	 * in-memory index under the node lock only */
 	si_lock(index);
+	si_nodewrlock(node);
 	svindex *j = si_nodeindex(node);
 	si_plannerremove(&index->p, node);
 	si_nodesplit(node);
@@ -295,6 +291,7 @@ si_merge(si *index, sdc *c, sinode *node,
 		n = *(sinode**)result->s;
 		n->i0 = *j;
 		n->used = j->used;
+		sv_indexinit(j, j->type);
 		si_nodelock(n);
 		si_replace(index, node, n);
 		si_plannerupdate(&index->p, n);
@@ -302,6 +299,7 @@ si_merge(si *index, sdc *c, sinode *node,
 	default: /* split */
 		rc = si_redistribute(index, r, c, node, result);
 		if (ssunlikely(rc == -1)) {
+			si_noderwunlock(node);
 			si_unlock(index);
 			si_splitfree(result, r);
 			return -1;
@@ -323,7 +321,8 @@ si_merge(si *index, sdc *c, sinode *node,
 		}
 		break;
 	}
-	sv_indexinit(j);
+	sv_indexreset(j, r);
+	si_noderwunlock(node);
 	si_unlock(index);
 
 	/* compaction completion */
@@ -361,8 +360,9 @@ si_merge(si *index, sdc *c, sinode *node,
 	             return -1);
 
 	/* gc node */
-	uint16_t refs = si_noderefof(node);
-	if (sslikely(refs == 0)) {
+	uint32_t refs = si_noderefof(node);
+	if (sslikely(refs == 0 && ss_epochidle(&index->epoch))) {
+		si_pagecachedrop(index, node);
 		rc = si_nodefree(node, r, 1);
 		if (ssunlikely(rc == -1))
 			return -1;
@@ -371,6 +371,7 @@ si_merge(si *index, sdc *c, sinode *node,
 		 * delayed removal */
 		si_nodegc(node, r, &index->scheme);
 		si_lock(index);
+		node->gc_epoch = ss_epochof(&index->epoch);
 		ss_listappend(&index->gc, &node->gc);
 		index->gc_count++;
 		si_unlock(index);
@@ -409,21 +410,17 @@ si_merge(si *index, sdc *c, sinode *node,
 	return 0;
 }
 
-int si_compaction(si *index, sdc *c, siplan *plan, uint64_t vlsn)
+static int
+si_compaction_range(si *index, sdc *c, sinode *node, svindex *vindex,
+                    char *min, char *max,
+                    uint64_t size_stream,
+                    uint64_t vlsn,
+                    ssbuf *result)
 {
 	sr *r = &index->r;
-	sinode *node = plan->node;
-	assert(node->flags & SI_LOCK);
-
-	si_lock(index);
-	svindex *vindex;
-	vindex = si_noderotate(node);
-	si_unlock(index);
-
-	uint64_t size_stream = vindex->used;
 	ssiter vindex_iter;
 	ss_iterinit(sv_indexiter, &vindex_iter);
-	ss_iteropen(sv_indexiter, &vindex_iter, &index->r, vindex, SS_GTE, NULL);
+	ss_iteropen(sv_indexiter, &vindex_iter, r, vindex, SS_GTE, min);
 
 	/* prepare direct_io stream */
 	int rc;
@@ -437,15 +434,62 @@ int si_compaction(si *index, sdc *c, siplan *plan, uint64_t vlsn)
 	}
 
 	/* prepare for compaction */
+	uint32_t delta_count = node->delta_count;
+	rc = sd_censure(c, r, delta_count);
+	if (ssunlikely(rc == -1))
+		return sr_oom_malfunction(r->e);
 	svmerge merge;
 	sv_mergeinit(&merge);
-	rc = sv_mergeprepare(&merge, r, 1 + 1);
+	rc = sv_mergeprepare(&merge, r, 1 + delta_count + 1);
 	if (ssunlikely(rc == -1))
 		return -1;
 	svmergesrc *s;
 	s = sv_mergeadd(&merge, &vindex_iter);
 
-	sdcbuf *cbuf = &c->e;
+	/* delta runs, newest first */
+	sdcbuf *cbuf = c->e.next;
+	uint32_t k = delta_count;
+	while (k > 0) {
+		k--;
+		s = sv_mergeadd(&merge, NULL);
+		sdreadarg arg = {
+			.from_compaction     = 1,
+			.io                  = &c->io,
+			.index               = si_noderun(node, k),
+			.buf                 = &cbuf->a,
+			.buf_read            = &cbuf->b,
+			.index_iter          = &cbuf->index_iter,
+			.page_iter           = &cbuf->page_iter,
+			.use_mmap            = index->scheme.mmap,
+			.use_mmap_copy       = 0,
+			.use_compression     = index->scheme.compression,
+			.use_direct_io       = index->scheme.direct_io,
+			.direct_io_page_size = index->scheme.direct_io_page_size,
+			.compression_if      = index->scheme.compression_if,
+			.has                 = 0,
+			.has_vlsn            = 0,
+			.o                   = SS_GTE,
+			.mmap                = &node->map,
+			.file                = &node->file,
+			.r                   = r
+		};
+		ss_iterinit(sd_read, &s->src);
+		rc = ss_iteropen(sd_read, &s->src, &arg, min);
+		if (ssunlikely(rc == -1)) {
+			sv_mergefree(&merge, r->a);
+			return -1;
+		}
+		cbuf = cbuf->next;
+	}
+
+	/* node file is read sequentially */
+	sdreadahead readahead;
+	sd_readahead_init(&readahead);
+	readahead.window = index->scheme.read_ahead;
+	readahead.sequential = 1;
+	readahead.batched = ! index->scheme.mmap;
+
+	cbuf = &c->e;
 	s = sv_mergeadd(&merge, NULL);
 	sdreadarg arg = {
 		.from_compaction     = 1,
@@ -466,19 +510,353 @@ int si_compaction(si *index, sdc *c, siplan *plan, uint64_t vlsn)
 		.o                   = SS_GTE,
 		.mmap                = &node->map,
 		.file                = &node->file,
+		.readahead           = &readahead,
 		.r                   = r
 	};
 	ss_iterinit(sd_read, &s->src);
-	rc = ss_iteropen(sd_read, &s->src, &arg, NULL);
-	if (ssunlikely(rc == -1))
+	rc = ss_iteropen(sd_read, &s->src, &arg, min);
+	if (ssunlikely(rc == -1)) {
+		sd_readahead_free(&readahead, r);
+		sv_mergefree(&merge, r->a);
 		return -1;
-	size_stream += sd_indextotal(&node->index);
+	}
 
 	ssiter i;
 	ss_iterinit(sv_mergeiter, &i);
 	ss_iteropen(sv_mergeiter, &i, r, &merge, SS_GTE);
-	rc = si_merge(index, c, node, vlsn, &i, size_stream,
-	              sd_indexkeys(&node->index));
+	if (max)
+		sv_mergeiter_setlimit(&i, max);
+
+	/* begin compaction.
+	 *
+	 * Split merge stream into a number of
+	 * a new nodes.
+	 */
+	rc = si_split(index, c, result,
+	              node, &i, &s->src,
+	              index->scheme.compaction.node_size,
+	              size_stream,
+	              si_nodekeys(node),
+	              vlsn);
+	sd_readahead_free(&readahead, r);
 	sv_mergefree(&merge, r->a);
 	return rc;
 }
+
+typedef struct sicompactionpart sicompactionpart;
+
+struct sicompactionpart {
+	si       *index;
+	sdc      *c;
+	sdc       cbuf;
+	sinode   *node;
+	svindex  *vindex;
+	char     *min;
+	char     *max;
+	uint64_t  size_stream;
+	uint64_t  vlsn;
+	ssthread  thread;
+	int       rc;
+};
+
+static inline int
+si_compaction_partrun(sicompactionpart *p)
+{
+	return si_compaction_range(p->index, p->c, p->node, p->vindex,
+	                           p->min, p->max,
+	                           p->size_stream,
+	                           p->vlsn, &p->c->a);
+}
+
+static void*
+si_compaction_partf(void *arg)
+{
+	ssthread *self = arg;
+	sicompactionpart *p = self->arg;
+	p->rc = si_compaction_partrun(p);
+	return NULL;
+}
+
+static inline int
+si_compaction_parts(si *index, sinode *node, uint64_t size_stream)
+{
+	uint32_t parallel = index->scheme.compaction.parallel;
+	if (sslikely(parallel <= 1))
+		return 1;
+	/* every range should fill at least one node */
+	uint64_t count = size_stream / index->scheme.compaction.node_size;
+	if (count > parallel)
+		count = parallel;
+	if (count > node->index.h->count)
+		count = node->index.h->count;
+	if (count < 1)
+		count = 1;
+	return count;
+}
+
+static int
+si_compaction_parallel(si *index, sdc *c, sinode *node, svindex *vindex,
+                       int count, uint64_t vlsn)
+{
+	sr *r = &index->r;
+	sdindex *nodeindex = &node->index;
+	uint32_t pages = nodeindex->h->count;
+	/* delta runs are spread over ranges as the in-memory index */
+	uint64_t memory = vindex->used;
+	uint32_t n = 0;
+	while (n < node->delta_count) {
+		memory += sd_indextotal(si_noderun(node, n));
+		n++;
+	}
+	sicompactionpart *parts = ss_malloc(r->a, sizeof(sicompactionpart) * count);
+	if (ssunlikely(parts == NULL))
+		return sr_oom_malfunction(r->e);
+
+	/* partition by node page boundaries */
+	int k = 0;
+	while (k < count) {
+		sicompactionpart *p = &parts[k];
+		uint32_t first = ((uint64_t)pages * k) / count;
+		uint32_t last  = ((uint64_t)pages * (k + 1)) / count;
+		p->index  = index;
+		p->node   = node;
+		p->vindex = vindex;
+		p->vlsn   = vlsn;
+		p->rc     = 0;
+		p->c      = c;
+		if (k > 0) {
+			sd_cinit(&p->cbuf);
+			p->c = &p->cbuf;
+		}
+		p->min = NULL;
+		if (k > 0)
+			p->min = sd_indexpage_min(nodeindex, sd_indexpage(nodeindex, first));
+		p->max = NULL;
+		if (k < count - 1)
+			p->max = sd_indexpage_min(nodeindex, sd_indexpage(nodeindex, last));
+		/* estimate range size */
+		uint64_t total = 0;
+		uint32_t pos = first;
+		while (pos < last) {
+			total += sd_indexpage(nodeindex, pos)->size;
+			pos++;
+		}
+		p->size_stream = total + (memory * (last - first)) / pages;
+		k++;
+	}
+
+	/* merge and write ranges in parallel, the first range
+	 * is processed by the current worker */
+	int started = 1;
+	while (started < count) {
+		sicompactionpart *p = &parts[started];
+		int rc = ss_threadnew(&p->thread, si_compaction_partf, p);
+		if (ssunlikely(rc == -1))
+			break;
+		started++;
+	}
+	parts[0].rc = si_compaction_partrun(&parts[0]);
+	k = started;
+	while (k < count) {
+		parts[k].rc = si_compaction_partrun(&parts[k]);
+		k++;
+	}
+	int rcret = 0;
+	k = 1;
+	while (k < started) {
+		int rc = ss_threadjoin(&parts[k].thread);
+		if (ssunlikely(rc == -1)) {
+			sr_malfunction(r->e, "%s", "compaction thread join error");
+			rcret = -1;
+		}
+		k++;
+	}
+	k = 0;
+	while (k < count) {
+		if (parts[k].rc == -1)
+			rcret = -1;
+		k++;
+	}
+
+	/* gather new nodes in key order */
+	k = 1;
+	while (k < count && rcret == 0) {
+		ssbuf *result = &parts[k].c->a;
+		int rc = ss_bufadd(&c->a, r->a, result->s, ss_bufused(result));
+		if (ssunlikely(rc == -1)) {
+			sr_oom_malfunction(r->e);
+			rcret = -1;
+		}
+		k++;
+	}
+	if (ssunlikely(rcret == -1)) {
+		k = 0;
+		while (k < count) {
+			if (parts[k].rc == 0)
+				si_splitfree(&parts[k].c->a, r);
+			k++;
+		}
+		ss_bufreset(&c->a);
+	}
+	k = 1;
+	while (k < count) {
+		sd_cfree(&parts[k].cbuf, r);
+		k++;
+	}
+	ss_free(r->a, parts);
+	return rcret;
+}
+
+static inline int
+si_compaction_isdelta(si *index, siplan *plan, sinode *node,
+                      svindex *vindex)
+{
+	/* append in-memory index to the node file as a new
+	 * run, until runs are due for a full merge */
+	sicompaction *conf = &index->scheme.compaction;
+	if (sslikely(conf->delta_runs == 0))
+		return 0;
+	if (plan->plan != SI_CHECKPOINT && plan->plan != SI_COMPACTION)
+		return 0;
+	/* mapping and aligned writes are not extended */
+	if (index->scheme.mmap || index->scheme.direct_io)
+		return 0;
+	if (ssunlikely(vindex->count == 0))
+		return 0;
+	if (node->delta_count >= conf->delta_runs)
+		return 0;
+	uint64_t size = si_nodedelta_total(node) + vindex->used;
+	uint64_t base = node->index.h->totalorigin;
+	return size * 100 <= base * conf->delta_wm;
+}
+
+static int
+si_compaction_delta(si *index, sdc *c, sinode *node, svindex *vindex)
+{
+	sr *r = &index->r;
+	ssiter vindex_iter;
+	ss_iterinit(sv_indexiter, &vindex_iter);
+	ss_iteropen(sv_indexiter, &vindex_iter, r, vindex, SS_GTE, NULL);
+	svmerge vmerge;
+	sv_mergeinit(&vmerge);
+	int rc = sv_mergeprepare(&vmerge, r, 1);
+	if (ssunlikely(rc == -1))
+		return -1;
+	sv_mergeadd(&vmerge, &vindex_iter);
+	ssiter i;
+	ss_iterinit(sv_mergeiter, &i);
+	ss_iteropen(sv_mergeiter, &i, r, &vmerge, SS_GTE);
+
+	/* all versions and deletes are written as is, they are
+	 * shadowing older runs until the full merge */
+	sdmergeconf mergeconf = {
+		.stream              = vindex->count,
+		.size_stream         = vindex->used,
+		.size_node           = vindex->used,
+		.size_page           = index->scheme.compaction.node_page_size,
+		.checksum            = index->scheme.compaction.node_page_checksum,
+		.bloom_bits          = index->scheme.compaction.bloom_bits,
+		.expire              = 0,
+		.timestamp           = ss_timestamp(),
+		.compression         = index->scheme.compression,
+		.compression_if      = index->scheme.compression_if,
+		.direct_io           = 0,
+		.direct_io_page_size = 0,
+		.vlsn                = 0
+	};
+	sdmerge merge;
+	rc = sd_mergeinit(&merge, r, &i, &c->build, &c->build_index,
+	                  &c->upsert, &mergeconf);
+	if (ssunlikely(rc == -1)) {
+		sv_mergefree(&vmerge, r->a);
+		return -1;
+	}
+
+	/* append run to the end of the node file */
+	uint64_t svp = ss_filesvp(&node->file);
+	rc = sd_merge(&merge);
+	if (ssunlikely(rc == -1))
+		goto error;
+	assert(rc > 0);
+	uint64_t offset = sd_iosize(&c->io, &node->file);
+	while ((rc = sd_mergepage(&merge, offset)) == 1) {
+		rc = sd_writepage(r, &node->file, &c->io, merge.build);
+		if (ssunlikely(rc == -1))
+			goto error_rlb;
+		offset = sd_iosize(&c->io, &node->file);
+	}
+	if (ssunlikely(rc == -1))
+		goto error_rlb;
+	offset = sd_iosize(&c->io, &node->file);
+	rc = sd_mergeend(&merge, offset);
+	if (ssunlikely(rc == -1))
+		goto error_rlb;
+	rc = sd_writeindex(r, &node->file, &c->io, &merge.index);
+	if (ssunlikely(rc == -1))
+		goto error_rlb;
+	if (index->scheme.sync) {
+		rc = ss_filesync(&node->file);
+		if (ssunlikely(rc == -1)) {
+			sr_malfunction(r->e, "db file '%s' sync error: %s",
+			               ss_pathof(&node->file.path),
+			               strerror(errno));
+			goto error_rlb;
+		}
+	}
+
+	/* publish run and replace in-memory index, versions
+	 * are freed once nobody can reach them */
+	si_lock(index);
+	si_nodewrlock(node);
+	node->delta[node->delta_count] = merge.index;
+	node->delta_count++;
+	svindex gc = *vindex;
+	si_nodeunrotate(node);
+	node->used = node->i0.used;
+	si_noderwunlock(node);
+	si_plannerupdate(&index->p, node);
+	si_nodeunlock(node);
+	si_unlock(index);
+
+	sd_indexinit(&merge.index);
+	sd_mergefree(&merge);
+	sv_mergefree(&vmerge, r->a);
+	si_nodegc_index(r, &gc);
+	return 0;
+
+error_rlb:
+	ss_filerlb(&node->file, svp);
+error:
+	sd_mergefree(&merge);
+	sv_mergefree(&vmerge, r->a);
+	return -1;
+}
+
+int si_compaction(si *index, sdc *c, siplan *plan, uint64_t vlsn)
+{
+	sinode *node = plan->node;
+	assert(node->flags & SI_LOCK);
+
+	si_lock(index);
+	si_nodewrlock(node);
+	svindex *vindex;
+	vindex = si_noderotate(node);
+	si_noderwunlock(node);
+	si_unlock(index);
+
+	if (si_compaction_isdelta(index, plan, node, vindex))
+		return si_compaction_delta(index, c, node, vindex);
+
+	uint64_t size_stream = vindex->used + si_nodetotal(node);
+	int count = si_compaction_parts(index, node, size_stream);
+	int rc;
+	if (count > 1) {
+		rc = si_compaction_parallel(index, c, node, vindex, count, vlsn);
+	} else {
+		rc = si_compaction_range(index, c, node, vindex, NULL, NULL,
+		                         size_stream, vlsn, &c->a);
+	}
+	if (ssunlikely(rc == -1))
+		return -1;
+	return si_merge(index, c, node);
+}
@@ -16,7 +16,7 @@
 #include <libsd.h>
 #include <libsi.h>
 
-sinode *si_nodenew(sr *r, uint64_t id, uint64_t id_parent)
+sinode *si_nodenew(sr *r, sischeme *scheme, uint64_t id, uint64_t id_parent)
 {
 	sinode *n = (sinode*)ss_malloc(r->a, sizeof(sinode));
 	if (ssunlikely(n == NULL)) {
@@ -30,17 +30,18 @@ sinode *si_nodenew(sr *r, uint64_t id, uint64_t id_parent)
 	n->flags     = 0;
 	n->used      = 0;
 	n->refs      = 0;
-	ss_spinlockinit(&n->reflock);
+	n->gc_epoch  = 0;
+	ss_rwlockinit(&n->lock);
 	sd_indexinit(&n->index);
+	n->delta_count = 0;
 	ss_fileinit(&n->file, r->vfs);
 	ss_mmapinit(&n->map);
 	ss_mmapinit(&n->map_swap);
-	sv_indexinit(&n->i0);
-	sv_indexinit(&n->i1);
+	sv_indexinit(&n->i0, scheme->memtable);
+	sv_indexinit(&n->i1, scheme->memtable);
 	ss_rbinitnode(&n->node);
 	ss_rqinitnode(&n->nodememory);
 	ss_listinit(&n->gc);
-	ss_listinit(&n->commit);
 	return n;
 }
 
@@ -49,9 +50,12 @@ ss_rbtruncate(si_nodegc_indexgc,
 
 int si_nodegc_index(sr *r, svindex *i)
 {
+	if (i->type == SV_INDEXBTREE)
+		sv_btreefree(&i->bt, r, si_gcvall);
+	else
 	if (i->i.root)
 		si_nodegc_indexgc(i->i.root, r);
-	sv_indexinit(i);
+	sv_indexinit(i, i->type);
 	return 0;
 }
 
@@ -80,7 +84,6 @@ si_nodeclose(sinode *n, sr *r, int gc)
 	} else {
 		sv_indexfree(&n->i0, r);
 		sv_indexfree(&n->i1, r);
-		ss_spinlockfree(&n->reflock);
 	}
 	return rcret;
 }
@@ -88,6 +91,11 @@ si_nodeclose(sinode *n, sr *r, int gc)
 static inline int
 si_noderecover(sinode *n, sr *r)
 {
+	/* node file is a sequence of runs: the node base
+	 * followed by delta runs appended on compaction,
+	 * runs are iterated starting from the latest one */
+	sdindex run[SI_DELTA_MAX + 1];
+	int count = 0;
 	int rc;
 	ssiter i;
 	ss_iterinit(sd_iter, &i);
@@ -98,13 +106,16 @@ si_noderecover(sinode *n, sr *r)
 	while (ss_iteratorhas(&i))
 	{
 		sdindexheader *h = ss_iteratorof(&i);
-
-		sdindex index;
-		sd_indexinit(&index);
-		rc = sd_indexcopy(&index, r, h);
+		if (ssunlikely(count == SI_DELTA_MAX + 1)) {
+			sr_malfunction(r->e, "corrupted db file '%s': too many runs",
+			               ss_pathof(&n->file.path));
+			goto error;
+		}
+		sd_indexinit(&run[count]);
+		rc = sd_indexcopy(&run[count], r, h);
 		if (ssunlikely(rc == -1))
 			goto error;
-		n->index = index;
+		count++;
 
 		ss_iteratornext(&i);
 	}
@@ -113,10 +124,20 @@ si_noderecover(sinode *n, sr *r)
 	if (ssunlikely(rc == -1))
 		goto error;
 	ss_iteratorclose(&i);
+	assert(count > 0);
+
+	n->index = run[count - 1];
+	n->delta_count = 0;
+	while (count > 1) {
+		count--;
+		n->delta[n->delta_count++] = run[count - 1];
+	}
 	return 0;
 
 error:
 	ss_iteratorclose(&i);
+	while (count > 0)
+		sd_indexfree(&run[--count], r);
 	return -1;
 }
 
@@ -136,6 +157,9 @@ int si_nodeopen(sinode *n, sr *r, sischeme *scheme, sspath *path)
 		               strerror(errno));
 		return -1;
 	}
+	rc = sd_iter_truncate(r, &n->file);
+	if (ssunlikely(rc == -1))
+		return -1;
 	rc = si_noderecover(n, r);
 	if (ssunlikely(rc == -1))
 		return -1;
@@ -188,9 +212,15 @@ int si_nodefree(sinode *n, sr *r, int gc)
 		}
 	}
 	sd_indexfree(&n->index, r);
+	uint32_t i = 0;
+	while (i < n->delta_count) {
+		sd_indexfree(si_noderun(n, i), r);
+		i++;
+	}
 	rc = si_nodeclose(n, r, gc);
 	if (ssunlikely(rc == -1))
 		rcret = -1;
+	ss_rwlockfree(&n->lock);
 	ss_free(r->a, n);
 	return rcret;
 }
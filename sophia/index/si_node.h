@@ -22,26 +22,30 @@ typedef struct sinode sinode;
 #define SI_RDB_UNDEF  256
 #define SI_RDB_REMOVE 512
 
+#define SI_DELTA_MAX  8
+
 struct sinode {
+	ssrwlock   lock;
+	uint32_t   refs;
 	uint64_t   id;
 	uint64_t   id_parent;
 	uint32_t   recover;
 	uint16_t   flags;
 	uint64_t   used;
 	uint32_t   backup;
-	uint16_t   refs;
-	ssspinlock reflock;
+	uint64_t   gc_epoch;
 	sdindex    index;
+	sdindex    delta[SI_DELTA_MAX];
+	uint32_t   delta_count;
 	svindex    i0, i1;
 	ssfile     file;
 	ssmmap     map, map_swap;
 	ssrbnode   node;
 	ssrqnode   nodememory;
 	sslist     gc;
-	sslist     commit;
 } sspacked;
 
-sinode *si_nodenew(sr*, uint64_t, uint64_t);
+sinode *si_nodenew(sr*, sischeme*, uint64_t, uint64_t);
 int si_nodeopen(sinode*, sr*, sischeme*, sspath*);
 int si_nodecreate(sinode*, sr*, sischeme*);
 int si_nodefree(sinode*, sr*, int);
@@ -64,36 +68,42 @@ si_nodeunlock(sinode *node) {
 	node->flags &= ~SI_LOCK;
 }
 
+static inline void
+si_noderdlock(sinode *node) {
+	ss_rwlockrd(&node->lock);
+}
+
+static inline void
+si_nodewrlock(sinode *node) {
+	ss_rwlockwr(&node->lock);
+}
+
+static inline void
+si_noderwunlock(sinode *node) {
+	ss_rwunlock(&node->lock);
+}
+
 static inline void
 si_nodesplit(sinode *node) {
 	node->flags |= SI_SPLIT;
 }
 
 static inline void
-si_noderef(sinode *node)
-{
-	ss_spinlock(&node->reflock);
-	node->refs++;
-	ss_spinunlock(&node->reflock);
+si_noderef(sinode *node) {
+	__sync_add_and_fetch(&node->refs, 1);
 }
 
-static inline uint16_t
+static inline uint32_t
 si_nodeunref(sinode *node)
 {
-	ss_spinlock(&node->reflock);
-	assert(node->refs > 0);
-	uint16_t v = node->refs--;
-	ss_spinunlock(&node->reflock);
+	uint32_t v = __sync_fetch_and_sub(&node->refs, 1);
+	assert(v > 0);
 	return v;
 }
 
-static inline uint16_t
-si_noderefof(sinode *node)
-{
-	ss_spinlock(&node->reflock);
-	uint16_t v = node->refs;
-	ss_spinunlock(&node->reflock);
-	return v;
+static inline uint32_t
+si_noderefof(sinode *node) {
+	return __sync_fetch_and_add(&node->refs, 0);
 }
 
 static inline svindex*
@@ -107,7 +117,7 @@ si_nodeunrotate(sinode *node) {
 	assert((node->flags & SI_ROTATE) > 0);
 	node->flags &= ~SI_ROTATE;
 	node->i0 = node->i1;
-	sv_indexinit(&node->i1);
+	sv_indexinit(&node->i1, node->i0.type);
 }
 
 static inline svindex*
@@ -128,6 +138,47 @@ si_nodeindex_priority(sinode *node, svindex **second)
 	return &node->i0;
 }
 
+static inline sdindex*
+si_noderun(sinode *node, uint32_t k) {
+	return &node->delta[k];
+}
+
+static inline uint64_t
+si_nodedelta_total(sinode *node)
+{
+	uint64_t total = 0;
+	uint32_t i = 0;
+	while (i < node->delta_count) {
+		total += node->delta[i].h->totalorigin;
+		i++;
+	}
+	return total;
+}
+
+static inline uint32_t
+si_nodekeys(sinode *node)
+{
+	uint32_t keys = sd_indexkeys(&node->index);
+	uint32_t i = 0;
+	while (i < node->delta_count) {
+		keys += sd_indexkeys(si_noderun(node, i));
+		i++;
+	}
+	return keys;
+}
+
+static inline uint64_t
+si_nodetotal(sinode *node)
+{
+	uint64_t total = sd_indextotal(&node->index);
+	uint32_t i = 0;
+	while (i < node->delta_count) {
+		total += sd_indextotal(si_noderun(node, i));
+		i++;
+	}
+	return total;
+}
+
 static inline sinode*
 si_nodeof(ssrbnode *node) {
 	return sscast(node, sinode, node);
@@ -32,6 +32,7 @@ int si_plannerinit(siplanner *p, ssa *a, void *i)
 	rc = ss_rqinit(&p->memory, a, 1024 * 1024, 32000);
 	if (ssunlikely(rc == -1))
 		return -1;
+	ss_spinlockinit(&p->lock);
 	p->i = i;
 	return 0;
 }
@@ -39,6 +40,7 @@ int si_plannerinit(siplanner *p, ssa *a, void *i)
 int si_plannerfree(siplanner *p, ssa *a)
 {
 	ss_rqfree(&p->memory, a);
+	ss_spinlockfree(&p->lock);
 	return 0;
 }
 
@@ -142,18 +144,24 @@ match:
 	return SI_PMATCH;
 }
 
-static inline siplannerrc
-si_plannerpeek_memory(siplanner *p, siplan *plan)
+uint64_t si_plannerwm(siplanner *p)
 {
-	/* try to peek a node with a biggest in-memory index */
-
-	/* calculate peek wm */
+	/* in-memory index size which makes
+	 * a node due for compaction */
 	si *index = (si*)p->i;
 	double cache_per_node =
 		(double)index->scheme.compaction.cache /
 		(double)index->n;
 	if (cache_per_node >= index->scheme.compaction.node_size)
 		cache_per_node = index->scheme.compaction.node_size;
+	return cache_per_node;
+}
+
+static inline siplannerrc
+si_plannerpeek_memory(siplanner *p, siplan *plan)
+{
+	/* try to peek a node with a biggest in-memory index */
+	uint64_t cache_per_node = si_plannerwm(p);
 	sinode *n;
 	ssrqnode *pn = NULL;
 	while ((pn = ss_rqprev(&p->memory, pn))) {
@@ -210,10 +218,16 @@ si_plannerpeek_expire(siplanner *p, siplan *plan)
 	ssrqnode *pn = NULL;
 	while ((pn = ss_rqprev(&p->memory, pn))) {
 		n = sscast(pn, sinode, nodememory);
-		sdindexheader *h = n->index.h;
-		if (h->tsmin == UINT32_MAX)
+		uint32_t tsmin = n->index.h->tsmin;
+		uint32_t k = 0;
+		while (k < n->delta_count) {
+			if (n->delta[k].h->tsmin < tsmin)
+				tsmin = n->delta[k].h->tsmin;
+			k++;
+		}
+		if (tsmin == UINT32_MAX)
 			continue;
-		uint32_t diff = now - h->tsmin;
+		uint32_t diff = now - tsmin;
 		if (sslikely(diff >= plan->a)) {
 			if (n->flags & SI_LOCK) {
 				rc = SI_PRETRY;
@@ -236,10 +250,12 @@ si_plannerpeek_nodegc(siplanner *p, siplan *plan)
 	if (sslikely(index->gc_count == 0))
 		return 0;
 	siplannerrc rc = SI_PNONE;
+	ss_epochadvance(&index->epoch);
 	sslist *i;
 	ss_listforeach(&index->gc, i) {
 		sinode *n = sscast(i, sinode, gc);
-		if (sslikely(si_noderefof(n) == 0)) {
+		if (sslikely(si_noderefof(n) == 0 &&
+		             ss_epochsafe(&index->epoch, n->gc_epoch))) {
 			ss_listunlink(&n->gc);
 			index->gc_count--;
 			plan->node = n;
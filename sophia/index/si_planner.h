@@ -18,9 +18,14 @@ typedef enum {
 	SI_PRETRY
 } siplannerrc;
 
+/* committers update the memory queue under the shared
+ * index lock and the planner lock, other updates and
+ * planning run under the exclusive index lock */
+
 struct siplanner {
-	ssrq  memory;
-	void *i;
+	ssspinlock lock;
+	ssrq       memory;
+	void      *i;
 };
 
 /* plan */
@@ -54,6 +59,7 @@ int si_plannerinit(siplanner*, ssa*, void*);
 int si_plannerfree(siplanner*, ssa*);
 int si_plannertrace(siplan*, uint32_t, sstrace*);
 int si_plannerupdate(siplanner*, sinode*);
+uint64_t si_plannerwm(siplanner*);
 int si_plannerremove(siplanner*, sinode*);
 siplannerrc
 si_planner(siplanner*, siplan*);
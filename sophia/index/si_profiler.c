@@ -29,6 +29,17 @@ int si_profilerend(siprofiler *p)
 	return 0;
 }
 
+static inline void
+si_profilerrun(siprofiler *p, sdindexheader *h)
+{
+	p->count += h->keys;
+	p->count_dup += h->dupkeys;
+	int indexsize = sd_indexsize_ext(h);
+	p->total_node_size += indexsize + h->total;
+	p->total_node_origin_size += indexsize + h->totalorigin;
+	p->total_page_count += h->count;
+}
+
 int si_profiler(siprofiler *p)
 {
 	uint64_t memory_used = 0;
@@ -43,17 +54,18 @@ int si_profiler(siprofiler *p)
 		memory_used += n->i0.used;
 		memory_used += n->i1.used;
 
-		p->count += n->index.h->keys;
-		p->count_dup += n->index.h->dupkeys;
-		int indexsize = sd_indexsize_ext(n->index.h);
-		p->total_node_size += indexsize + n->index.h->total;
-		p->total_node_origin_size += indexsize + n->index.h->totalorigin;
-		p->total_page_count += n->index.h->count;
+		si_profilerrun(p, n->index.h);
+		uint32_t k = 0;
+		while (k < n->delta_count) {
+			si_profilerrun(p, n->delta[k].h);
+			k++;
+		}
 
 		pn = ss_rbnext(&p->i->i, pn);
 	}
 	p->memory_used = memory_used;
 	p->read_disk  = p->i->read_disk;
 	p->read_cache = p->i->read_cache;
+	p->writers_max = p->i->writers_max;
 	return 0;
 }
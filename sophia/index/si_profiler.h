@@ -21,6 +21,7 @@ struct siprofiler {
 	uint64_t  count_dup;
 	uint64_t  read_disk;
 	uint64_t  read_cache;
+	uint32_t  writers_max;
 	si       *i;
 } sspacked;
 
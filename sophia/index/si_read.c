@@ -45,13 +45,11 @@ int si_readopen(siread *q, si *i, sicache *c, ssorder o,
 		}
 	}
 	sv_mergeinit(&q->merge);
-	si_lock(i);
 	return 0;
 }
 
 int si_readclose(siread *q)
 {
-	si_unlock(q->index);
 	sv_mergefree(&q->merge, q->r->a);
 	return 0;
 }
@@ -70,16 +68,16 @@ si_readstat(siread *q, int cache, uint32_t reads)
 {
 	si *i = q->index;
 	if (cache) {
-		i->read_cache += reads;
+		__sync_fetch_and_add(&i->read_cache, reads);
 		q->read_cache += reads;
 	} else {
-		i->read_disk += reads;
+		__sync_fetch_and_add(&i->read_disk, reads);
 		q->read_disk += reads;
 	}
 }
 
 static inline int
-si_getresult(siread *q, char *v, int compare)
+si_getresult(siread *q, char *v, svv *ref, int compare)
 {
 	int rc;
 	if (compare) {
@@ -98,6 +96,18 @@ si_getresult(siread *q, char *v, int compare)
 		return sf_lsn(q->r->scheme, v) > q->vlsn;
 	if (ssunlikely(sf_is(q->r->scheme, v, SVDELETE)))
 		return 2;
+	/* share in-memory versions instead of a copy.
+	 *
+	 * Only svv next pointer and SVDUP bit of the flags
+	 * are changed after a version is inserted (sv_vset,
+	 * under the node lock). Documents read only fields
+	 * of a shared version, a transaction copies it before
+	 * using it as a key (se_document_createkey). */
+	if (ref) {
+		sv_vref(ref);
+		q->result = ref;
+		return 1;
+	}
 	rc = si_readdup(q, v);
 	if (ssunlikely(rc == -1))
 		return -1;
@@ -105,7 +115,7 @@ si_getresult(siread *q, char *v, int compare)
 }
 
 static inline int
-si_getindex(siread *q, sinode *n)
+si_getmemory(siread *q, sinode *n)
 {
 	svindex *second;
 	svindex *first = si_nodeindex_priority(n, &second);
@@ -135,29 +145,60 @@ result:;
 			return 0;
 		v = (char*)visible + sizeof(svv);
 	}
-	return si_getresult(q, v, 0);
+	return si_getresult(q, v, visible, 0);
 }
 
 static inline int
-si_getfile(siread *q, sinode *n, sicache *c)
+si_getindex(siread *q, sinode *n)
 {
+	/* in-memory indexes are updated under the node lock */
+	si_noderdlock(n);
+	int rc = si_getmemory(q, n);
+	si_noderwunlock(n);
+	return rc;
+}
+
+static inline int
+si_getbloom(siread *q, sdindex *index)
+{
+	/* custom comparator may match different key bytes */
+	if (q->r->scheme->cmp != NULL)
+		return 0;
+	sdbloom *bloom = sd_indexbloom(index);
+	if (sslikely(bloom == NULL))
+		return 0;
+	uint32_t hash = sd_bloomhash(q->r->scheme, q->key);
+	if (sd_bloomhas(bloom, hash))
+		return 1;
+	sr_statbloom(q->r->stat, 0);
+	return -1;
+}
+
+static inline int
+si_getfile(siread *q, sinode *n, sdindex *index, sicacherun *run,
+           int bloom, int reopen)
+{
+	sicache *c = q->cache;
 	sischeme *scheme = &q->index->scheme;
 	int rc;
 	/* choose compression type */
 	sdreadarg arg = {
 		.from_compaction     = 0,
 		.io                  = &q->index->rdc.io,
-		.index               = &n->index,
-		.buf                 = &c->buf_a,
-		.buf_read            = &q->index->rdc.d,
-		.index_iter          = &c->index_iter,
-		.page_iter           = &c->page_iter,
+		.index               = index,
+		.buf                 = &run->buf_a,
+		.buf_read            = &run->buf_b,
+		.index_iter          = &run->index_iter,
+		.page_iter           = &run->page_iter,
 		.use_mmap            = scheme->mmap,
 		.use_mmap_copy       = 0,
 		.use_compression     = scheme->compression,
 		.use_direct_io       = scheme->direct_io,
 		.direct_io_page_size = scheme->direct_io_page_size,
 		.compression_if      = scheme->compression_if,
+		.pagecache           = q->index->pagecache,
+		.pagecache_id        = n->id,
+		.prefetch            = c->prefetch,
 		.has                 = q->has,
 		.has_vlsn            = q->vlsn,
 		.o                   = SS_GTE,
@@ -165,15 +206,22 @@ si_getfile(siread *q, sinode *n, sicache *c)
 		.file                = &n->file,
 		.r                   = q->r
 	};
-	ss_iterinit(sd_read, &c->i);
-	rc = ss_iteropen(sd_read, &c->i, &arg, q->key);
-	int reads = sd_read_stat(&c->i);
+	if (reopen) {
+		rc = sd_read_reopen(&run->i, q->key);
+	} else {
+		ss_iterinit(sd_read, &run->i);
+		rc = ss_iteropen(sd_read, &run->i, &arg, q->key);
+	}
+	int reads = sd_read_stat(&run->i);
 	si_readstat(q, 0, reads);
-	if (ssunlikely(rc <= 0))
+	if (ssunlikely(rc <= 0)) {
+		if (rc == 0 && bloom && !q->has)
+			sr_statbloom(q->r->stat, 1);
 		return rc;
+	}
 	/* prepare sources */
 	sv_mergereset(&q->merge);
-	sv_mergeadd(&q->merge, &c->i);
+	sv_mergeadd(&q->merge, &run->i);
 	ssiter i;
 	ss_iterinit(sv_mergeiter, &i);
 	ss_iteropen(sv_mergeiter, &i, q->r, &q->merge, SS_GTE);
@@ -182,17 +230,50 @@ si_getfile(siread *q, sinode *n, sicache *c)
 		vlsn = UINT64_MAX;
 	ssiter j;
 	ss_iterinit(sv_readiter, &j);
-	ss_iteropen(sv_readiter, &j, q->r, &i, &q->index->rdc.upsert, vlsn, 1);
+	ss_iteropen(sv_readiter, &j, q->r, &i, &c->upsert, vlsn, 1);
 	char *v = ss_iterof(sv_readiter, &j);
+	if (bloom && !q->has) {
+		if (v == NULL || sf_compare(q->r->scheme, v, q->key) != 0)
+			sr_statbloom(q->r->stat, 1);
+	}
 	if (ssunlikely(v == NULL))
 		return 0;
-	return si_getresult(q, v, 1);
+	return si_getresult(q, v, NULL, 1);
+}
+
+static inline int
+si_getdisk(siread *q, sinode *n, int reopen)
+{
+	/* delta runs are newer than the node base and
+	 * searched first, latest run goes first */
+	sicache *c = q->cache;
+	int bloom;
+	int rc;
+	uint32_t k = c->delta_count;
+	while (k > 0) {
+		k--;
+		bloom = si_getbloom(q, si_noderun(n, k));
+		if (bloom == -1)
+			continue;
+		rc = si_getfile(q, n, si_noderun(n, k), &c->delta[k], bloom, 0);
+		if (rc != 0)
+			return rc;
+	}
+	bloom = si_getbloom(q, &n->index);
+	if (bloom == -1)
+		return 0;
+	return si_getfile(q, n, &n->index, &c->base, bloom, reopen);
 }
 
 static inline int
 si_get(siread *q)
 {
 	assert(q->key != NULL);
+	srstat *stat = q->r->stat;
+	uint64_t trace = sr_stattrace_begin(stat);
+	si_rdlock(q->index);
+	sr_stattrace(stat, SR_PHASE_INDEXLOCK, trace);
+	trace = sr_stattrace_begin(stat);
 	ssiter i;
 	ss_iterinit(si_iter, &i);
 	ss_iteropen(si_iter, &i, q->r, q->index, SS_GTE, q->key);
@@ -203,99 +284,239 @@ si_get(siread *q)
 	/* search in memory */
 	int rc;
 	rc = si_getindex(q, node);
-	if (rc != 0)
+	sr_stattrace(stat, SR_PHASE_INDEXSEARCH, trace);
+	if (rc != 0) {
+		si_rdunlock(q->index);
 		return rc;
-	sinodeview view;
-	si_nodeview_open(&view, node);
+	}
+	/* node is reclaimed only after the epoch is left */
+	uint64_t epoch = ss_epochenter(&q->index->epoch);
 	rc = si_cachevalidate(q->cache, node);
+	si_rdunlock(q->index);
 	if (ssunlikely(rc == -1)) {
+		ss_epochexit(&q->index->epoch, epoch);
 		sr_oom(q->r->e);
 		return -1;
 	}
-	si_unlock(q->index);
 
 	/* search on disk */
 	svmerge *m = &q->merge;
 	rc = sv_mergeprepare(m, q->r, 1);
 	assert(rc == 0);
+	rc = si_getdisk(q, node, 0);
 
-	rc = si_getfile(q, node, q->cache);
-
-	si_lock(q->index);
-	si_nodeview_close(&view);
+	ss_epochexit(&q->index->epoch, epoch);
 	return rc;
 }
 
 static inline int
-si_rangefile(siread *q, sinode *n, svmerge *m)
+si_rangerun(siread *q, sinode *n, sdindex *index, sicacherun *run,
+            sdreadahead *readahead, svmerge *m)
 {
 	sicache *c = q->cache;
-	assert(c->node == n);
 	/* iterate cache */
-	if (ss_iterhas(sd_read, &c->i)) {
-		svmergesrc *s = sv_mergeadd(m, &c->i);
+	if (ss_iterhas(sd_read, &run->i)) {
+		svmergesrc *s = sv_mergeadd(m, &run->i);
 		si_readstat(q, 1, 1);
 		s->ptr = c;
 		return 1;
 	}
-	if (c->open) {
+	if (run->open) {
 		return 1;
 	}
-	c->open = 1;
+	run->open = 1;
 	/* choose compression type */
 	sischeme *scheme = &q->index->scheme;
 	sdreadarg arg = {
 		.from_compaction     = 0,
 		.io                  = &q->index->rdc.io,
-		.index               = &n->index,
-		.buf                 = &c->buf_a,
-		.buf_read            = &q->index->rdc.d,
-		.index_iter          = &c->index_iter,
-		.page_iter           = &c->page_iter,
+		.index               = index,
+		.buf                 = &run->buf_a,
+		.buf_read            = &run->buf_b,
+		.index_iter          = &run->index_iter,
+		.page_iter           = &run->page_iter,
 		.use_mmap            = scheme->mmap,
 		.use_mmap_copy       = 1,
 		.use_compression     = scheme->compression,
 		.use_direct_io       = scheme->direct_io,
 		.direct_io_page_size = scheme->direct_io_page_size,
 		.compression_if      = scheme->compression_if,
+		.pagecache           = q->index->pagecache,
+		.pagecache_id        = n->id,
 		.has                 = 0,
 		.has_vlsn            = 0,
 		.o                   = q->order,
 		.mmap                = &n->map,
 		.file                = &n->file,
+		.readahead           = readahead,
 		.r                   = q->r
 	};
-	ss_iterinit(sd_read, &c->i);
-	int rc = ss_iteropen(sd_read, &c->i, &arg, q->key);
-	int reads = sd_read_stat(&c->i);
+	ss_iterinit(sd_read, &run->i);
+	int rc = ss_iteropen(sd_read, &run->i, &arg, q->key);
+	int reads = sd_read_stat(&run->i);
 	si_readstat(q, 0, reads);
 	if (ssunlikely(rc == -1))
 		return -1;
-	if (ssunlikely(! ss_iterhas(sd_read, &c->i)))
+	if (ssunlikely(! ss_iterhas(sd_read, &run->i)))
 		return 0;
-	svmergesrc *s = sv_mergeadd(m, &c->i);
+	svmergesrc *s = sv_mergeadd(m, &run->i);
 	s->ptr = c;
 	return 1;
 }
 
 static inline int
-si_range(siread *q)
+si_rangefile(siread *q, sinode *n, svmerge *m)
 {
-	assert(q->has == 0);
+	sicache *c = q->cache;
+	assert(c->node == n);
+	/* newer runs go first, read-ahead is used
+	 * only by the node base */
+	int rc;
+	uint32_t k = c->delta_count;
+	while (k > 0) {
+		k--;
+		rc = si_rangerun(q, n, si_noderun(n, k), &c->delta[k], NULL, m);
+		if (ssunlikely(rc == -1))
+			return -1;
+	}
+	c->readahead.window = q->index->scheme.read_ahead;
+	return si_rangerun(q, n, &n->index, &c->base, &c->readahead, m);
+}
 
-	ssiter i;
-	ss_iterinit(si_iter, &i);
-	ss_iteropen(si_iter, &i, q->r, q->index, q->order, q->key);
-	sinode *node;
-next_node:
-	node = ss_iterof(si_iter, &i);
-	if (ssunlikely(node == NULL))
+static inline int
+si_rangeresult(siread *q, ssiter *k, char *v)
+{
+	int rc = 1;
+	/* convert upsert search to SS_EQ */
+	if (q->upsert_eq) {
+		rc = sf_compare(q->r->scheme, v, q->key);
+		rc = rc == 0;
+	}
+	/* do prefix search */
+	if (q->prefix && rc) {
+		rc = sf_compareprefix(q->r->scheme, q->prefix,
+		                      q->prefix_size, v);
+	}
+	if (sslikely(rc == 1)) {
+		if (ssunlikely(si_readdup(q, v) == -1))
+			return -1;
+	}
+
+	/* skip a possible duplicates from data sources */
+	sv_readiter_forward(k);
+	return rc;
+}
+
+static inline int
+si_rangestream_valid(siread *q)
+{
+	sicache *c = q->cache;
+	sinode *n = c->stream_view.node;
+	if (ssunlikely(c->stream_r != q->r ||
+	               c->stream_vlsn != q->vlsn ||
+	               c->node != n ||
+	               c->delta_count != n->delta_count))
+		return 0;
+	/* cursor continues from the last returned document */
+	if (ssunlikely(sv_vpointer(c->stream_v) != q->key))
 		return 0;
+	int forward = q->order == SS_GT || q->order == SS_GTE;
+	int stream_forward = c->stream_order == SS_GT ||
+	                     c->stream_order == SS_GTE;
+	if (ssunlikely(forward != stream_forward))
+		return 0;
+	/* node has not been rotated, split or updated */
+	return n->flags == c->stream_view.flags &&
+	       n->i0.count == c->stream_i0 &&
+	       n->i1.count == c->stream_i1;
+}
+
+static inline int
+si_rangestream(siread *q)
+{
+	sicache *c = q->cache;
+	ssiter *k = &c->stream_read_iter;
+	sv_readiter_next(k);
+	char *v = ss_iterof(sv_readiter, k);
+	if (ssunlikely(v == NULL))
+		return 0;
+	si_readstat(q, 1, 1);
+	return 1;
+}
+
+static inline void
+si_rangestream_open(siread *q, sinode *node)
+{
+	sicache *c = q->cache;
+	if (! c->stream_open) {
+		si_nodeview_open(&c->stream_view, node);
+		c->stream_r     = q->r;
+		c->stream_vlsn  = q->vlsn;
+		c->stream_order = q->order;
+		c->stream_i0    = node->i0.count;
+		c->stream_i1    = node->i1.count;
+		c->stream_open  = 1;
+	} else {
+		si_gcv(c->stream_r, c->stream_v);
+	}
+	c->stream_v = q->result;
+	sv_vref(c->stream_v);
+}
+
+static inline sinode*
+si_rangenext(siread *q, sinode *n)
+{
+	/* neighbour for read-ahead, looked up under the
+	 * index lock and kept by the epoch */
+	ssrbnode *p;
+	int forward = q->order == SS_GT || q->order == SS_GTE;
+	if (forward)
+		p = ss_rbnext(&q->index->i, &n->node);
+	else
+		p = ss_rbprev(&q->index->i, &n->node);
+	if (p == NULL)
+		return NULL;
+	return si_nodeof(p);
+}
+
+static inline void
+si_rangeahead(siread *q, sinode *next)
+{
+	/* read-ahead window has reached the end of the node,
+	 * advise first pages of the next one */
+	sdreadahead *ra = &q->cache->readahead;
+	if (sslikely(ra->edge != 1))
+		return;
+	ra->edge = 2;
+	if (next == NULL)
+		return;
+	if (ssunlikely(next->index.h == NULL))
+		return;
+	int forward = q->order == SS_GT || q->order == SS_GTE;
+	int count = next->index.h->count;
+	int window = ra->window;
+	if (window > count)
+		window = count;
+	if (forward)
+		sd_readahead_advise(&next->index, &next->file, 0, window - 1);
+	else
+		sd_readahead_advise(&next->index, &next->file, count - window,
+		                    count - 1);
+}
+
+static inline int
+si_rangenode(siread *q, sinode *node, sinode *next)
+{
+	sicache *c = q->cache;
+	int rc;
 
 	/* prepare sources */
 	svmerge *m = &q->merge;
-	int count = 1 + 2 + 1;
-	int rc = sv_mergeprepare(m, q->r, count);
+	if (c->stream)
+		m = &c->stream_merge;
+	sv_mergereset(m);
+	int count = 1 + 2 + 1 + node->delta_count;
+	rc = sv_mergeprepare(m, q->r, count);
 	if (ssunlikely(rc == -1)) {
 		sr_errorreset(q->r->e);
 		return -1;
@@ -331,7 +552,7 @@ next_node:
 	}
 
 	/* read from file */
-	rc = si_cachevalidate(q->cache, node);
+	rc = si_cachevalidate(c, node);
 	if (ssunlikely(rc == -1)) {
 		sr_oom(q->r->e);
 		return -1;
@@ -340,54 +561,116 @@ next_node:
 	if (ssunlikely(rc == -1 || rc == 2))
 		return rc;
 
-	/* merge and filter data stream */
-	ssiter j;
-	ss_iterinit(sv_mergeiter, &j);
-	ss_iteropen(sv_mergeiter, &j, q->r, m, q->order);
-	ssiter k;
-	ss_iterinit(sv_readiter, &k);
-	ss_iteropen(sv_readiter, &k, q->r, &j, &q->index->rdc.upsert, q->vlsn, 0);
-	char *v = ss_iterof(sv_readiter, &k);
+	/* merge and filter data stream, streaming cursor keeps
+	 * iterators in the cache */
+	ssiter j_local, k_local;
+	ssiter *j = &j_local;
+	ssiter *k = &k_local;
+	if (c->stream && !q->upsert) {
+		j = &c->stream_merge_iter;
+		k = &c->stream_read_iter;
+	}
+	ss_iterinit(sv_mergeiter, j);
+	ss_iteropen(sv_mergeiter, j, q->r, m, q->order);
+	ss_iterinit(sv_readiter, k);
+	ss_iteropen(sv_readiter, k, q->r, j, &c->upsert, q->vlsn, 0);
+	char *v = ss_iterof(sv_readiter, k);
 	if (ssunlikely(v == NULL)) {
-		sv_mergereset(&q->merge);
-		ss_iternext(si_iter, &i);
-		goto next_node;
+		sv_mergereset(m);
+		return 0;
 	}
+	rc = si_rangeresult(q, k, v);
+	si_rangeahead(q, next);
+	if (c->stream && !q->upsert && rc == 1)
+		si_rangestream_open(q, node);
+	return rc;
+}
 
-	rc = 1;
-	/* convert upsert search to SS_EQ */
-	if (q->upsert_eq) {
-		rc = sf_compare(q->r->scheme, v, q->key);
-		rc = rc == 0;
-	}
-	/* do prefix search */
-	if (q->prefix && rc) {
-		rc = sf_compareprefix(q->r->scheme, q->prefix,
-		                      q->prefix_size, v);
-	}
-	if (sslikely(rc == 1)) {
-		if (ssunlikely(si_readdup(q, v) == -1))
-			return -1;
+static inline int
+si_range(siread *q)
+{
+	assert(q->has == 0);
+	si *index = q->index;
+	sicache *c = q->cache;
+	sinode *next;
+	uint64_t epoch;
+	int rc;
+
+	/* the index lock only routes the read to a node, the
+	 * node is kept by the epoch and its in-memory indexes
+	 * and files are read under the node lock */
+	uint64_t trace = sr_stattrace_begin(q->r->stat);
+	si_rdlock(index);
+	sr_stattrace(q->r->stat, SR_PHASE_INDEXLOCK, trace);
+
+	/* continue streaming cursor without a new search,
+	 * unless node in-memory indexes has been changed */
+	if (c->stream_open) {
+		sinode *n = c->stream_view.node;
+		si_noderdlock(n);
+		if (! si_rangestream_valid(q)) {
+			si_noderwunlock(n);
+			si_cachestream_close(c);
+			goto search;
+		}
+		next  = si_rangenext(q, n);
+		epoch = ss_epochenter(&index->epoch);
+		si_rdunlock(index);
+		int found = si_rangestream(q);
+		rc = 0;
+		if (found) {
+			rc = si_rangeresult(q, &c->stream_read_iter,
+			                    ss_iterof(sv_readiter, &c->stream_read_iter));
+			if (sslikely(rc == 1)) {
+				si_rangeahead(q, next);
+				si_rangestream_open(q, n);
+			}
+		}
+		si_noderwunlock(n);
+		if (rc != 1)
+			si_cachestream_close(c);
+		ss_epochexit(&index->epoch, epoch);
+		if (found)
+			return rc;
+		si_rdlock(index);
 	}
 
-	/* skip a possible duplicates from data sources */
-	sv_readiter_forward(&k);
-	return rc;
+search:;
+	ssiter i;
+	ss_iterinit(si_iter, &i);
+	ss_iteropen(si_iter, &i, q->r, index, q->order, q->key);
+	sinode *node;
+	while ((node = ss_iterof(si_iter, &i))) {
+		next  = si_rangenext(q, node);
+		epoch = ss_epochenter(&index->epoch);
+		si_noderdlock(node);
+		si_rdunlock(index);
+		rc = si_rangenode(q, node, next);
+		si_noderwunlock(node);
+		if (rc != 0) {
+			ss_epochexit(&index->epoch, epoch);
+			return rc;
+		}
+		/* node has no matching keys, search again if it has
+		 * been replaced meanwhile */
+		si_rdlock(index);
+		int split = node->flags & SI_SPLIT;
+		ss_epochexit(&index->epoch, epoch);
+		if (ssunlikely(split)) {
+			ss_iteropen(si_iter, &i, q->r, index, q->order, q->key);
+			continue;
+		}
+		ss_iternext(si_iter, &i);
+	}
+	si_rdunlock(index);
+	return 0;
 }
 
 int si_read(siread *q)
 {
-	int rc;
-	if (q->index->scheme.direct_io) {
-		rc = sd_ioprepare(&q->index->rdc.io, q->r,
-		                  q->index->scheme.direct_io,
-		                  q->index->scheme.direct_io_page_size,
-		                  q->index->scheme.direct_io_buffer_size);
-		if (ssunlikely(rc == -1))
-			return sr_oom(q->r->e);
-	}
 	switch (q->order) {
 	case SS_EQ:
+		si_cachestream_close(q->cache);
 		return si_get(q);
 	case SS_LT:
 	case SS_LTE:
@@ -400,6 +683,186 @@ int si_read(siread *q)
 	return -1;
 }
 
+static inline void
+si_readbatch_sort(siread **q, siread **tmp, int count)
+{
+	/* bottom-up merge sort by key */
+	sfscheme *scheme = q[0]->r->scheme;
+	int width = 1;
+	while (width < count) {
+		int lo = 0;
+		while (lo < count) {
+			int mid = lo + width;
+			if (mid > count)
+				mid = count;
+			int hi = lo + width * 2;
+			if (hi > count)
+				hi = count;
+			int a = lo;
+			int b = mid;
+			int k = lo;
+			while (a < mid && b < hi) {
+				if (sf_compare(scheme, q[b]->key, q[a]->key) < 0)
+					tmp[k++] = q[b++];
+				else
+					tmp[k++] = q[a++];
+			}
+			while (a < mid)
+				tmp[k++] = q[a++];
+			while (b < hi)
+				tmp[k++] = q[b++];
+			lo = hi;
+		}
+		memcpy(q, tmp, sizeof(siread*) * count);
+		width *= 2;
+	}
+}
+
+static inline int
+si_readbatch_prefetch(si *index, siread **q, sinode **nodes, int count,
+                      sdiobatch *batch)
+{
+	/* queue all pages required by the batch and read
+	 * them at once, instead of one page per key */
+	sischeme *scheme = &index->scheme;
+	sr *r = q[0]->r;
+	sdindexpage *prev = NULL;
+	int k = 0;
+	for (; k < count; k++) {
+		sinode *node = nodes[k];
+		if (node == NULL)
+			continue;
+		/* delta runs are read by the generic path */
+		if (node->delta_count > 0)
+			continue;
+		if (si_getbloom(q[k], &node->index) == -1) {
+			nodes[k] = NULL;
+			continue;
+		}
+		if (scheme->mmap)
+			continue;
+		ssiter i;
+		ss_iterinit(sd_indexiter, &i);
+		ss_iteropen(sd_indexiter, &i, r, &node->index,
+		            SS_GTE, q[k]->key);
+		sdindexpage *page = ss_iterof(sd_indexiter, &i);
+		if (page == NULL || page == prev)
+			continue;
+		int rc = sd_iobatch_add(batch, r, &node->file,
+		                        page->offset, page->size);
+		if (ssunlikely(rc == -1))
+			return -1;
+		prev = page;
+	}
+	/* a single page is read by the generic path */
+	if (batch->count < 2)
+		return 0;
+	return sd_iobatch_read(batch, &index->rdc.io, r, 0);
+}
+
+int si_readbatch(siread **q, int count)
+{
+	if (ssunlikely(count == 0))
+		return 0;
+	si *index = q[0]->index;
+	sicache *c = q[0]->cache;
+	sr *r = q[0]->r;
+	char *buf = ss_malloc(r->a, (sizeof(siread*) + sizeof(sinode*)) * count);
+	if (ssunlikely(buf == NULL))
+		return sr_oom(r->e);
+	siread **tmp = (siread**)buf;
+	sinode **nodes = (sinode**)(buf + sizeof(siread*) * count);
+	si_readbatch_sort(q, tmp, count);
+	si_cachestream_close(c);
+
+	/* search in memory and route the rest of keys
+	 * to nodes under a single lock */
+	uint64_t trace = sr_stattrace_begin(r->stat);
+	si_rdlock(index);
+	sr_stattrace(r->stat, SR_PHASE_INDEXLOCK, trace);
+	int rc;
+	int k = 0;
+	for (; k < count; k++) {
+		siread *p = q[k];
+		assert(p->order == SS_EQ);
+		nodes[k] = NULL;
+		ssiter i;
+		ss_iterinit(si_iter, &i);
+		ss_iteropen(si_iter, &i, r, index, SS_GTE, p->key);
+		sinode *node = ss_iterof(si_iter, &i);
+		assert(node != NULL);
+		rc = si_getindex(p, node);
+		if (ssunlikely(rc == -1)) {
+			si_rdunlock(index);
+			ss_free(r->a, buf);
+			return -1;
+		}
+		if (rc == 0)
+			nodes[k] = node;
+	}
+	/* nodes are reclaimed only after the epoch is left */
+	uint64_t epoch = ss_epochenter(&index->epoch);
+	si_rdunlock(index);
+
+	sdiobatch batch;
+	sd_iobatch_init(&batch);
+	rc = si_readbatch_prefetch(index, q, nodes, count, &batch);
+	if (ssunlikely(rc == -1)) {
+		sd_iobatch_free(&batch, r);
+		ss_epochexit(&index->epoch, epoch);
+		ss_free(r->a, buf);
+		return -1;
+	}
+	if (batch.count >= 2)
+		c->prefetch = &batch;
+
+	/* search on disk, keys are sorted so every page
+	 * of a node is read once */
+	sinode *opened = NULL;
+	rc = 0;
+	for (k = 0; k < count; k++) {
+		siread *p = q[k];
+		sinode *node = nodes[k];
+		if (node == NULL)
+			continue;
+		rc = sv_mergeprepare(&p->merge, r, 1);
+		if (ssunlikely(rc == -1))
+			break;
+		if (node != opened) {
+			rc = si_cachevalidate(c, node);
+			if (ssunlikely(rc == -1)) {
+				sr_oom(r->e);
+				break;
+			}
+		}
+		/* node base is searched for every key, unless
+		 * it has delta runs */
+		int reopen = node == opened && node->delta_count == 0;
+		rc = si_getdisk(p, node, reopen);
+		if (ssunlikely(rc == -1))
+			break;
+		opened = node;
+		rc = 0;
+	}
+	c->prefetch = NULL;
+	sd_iobatch_free(&batch, r);
+	ss_epochexit(&index->epoch, epoch);
+	ss_free(r->a, buf);
+	return rc;
+}
+
+static inline int
+si_readcommited_run(sdindex *index, sr *r, svv *v, uint64_t lsn)
+{
+	ssiter i;
+	ss_iterinit(sd_indexiter, &i);
+	ss_iteropen(sd_indexiter, &i, r, index, SS_GTE, sv_vpointer(v));
+	sdindexpage *page = ss_iterof(sd_indexiter, &i);
+	if (page == NULL)
+		return 0;
+	return page->lsnmax >= lsn;
+}
+
 int si_readcommited(si *index, sr *r, svv *v)
 {
 	/* search node index */
@@ -412,14 +875,14 @@ int si_readcommited(si *index, sr *r, svv *v)
 
 	uint64_t lsn = sf_lsn(r->scheme, sv_vpointer(v));
 
-	/* search index */
-	ss_iterinit(sd_indexiter, &i);
-	ss_iteropen(sd_indexiter, &i, r, &node->index, SS_GTE,
-	            sv_vpointer(v));
-	sdindexpage *page = ss_iterof(sd_indexiter, &i);
-	if (page == NULL)
-		return 0;
-	if (page->lsnmax >= lsn)
+	/* search index and delta runs */
+	if (si_readcommited_run(&node->index, r, v, lsn))
 		return 1;
+	uint32_t k = 0;
+	while (k < node->delta_count) {
+		if (si_readcommited_run(si_noderun(node, k), r, v, lsn))
+			return 1;
+		k++;
+	}
 	return 0;
 }
@@ -36,6 +36,7 @@ int  si_readopen(siread*, si*, sicache*, ssorder,
                  char*, uint32_t, int, int);
 int  si_readclose(siread*);
 int  si_read(siread*);
+int  si_readbatch(siread**, int);
 int  si_readcommited(si*, sr*, svv*);
 
 #endif
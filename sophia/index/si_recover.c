@@ -47,7 +47,7 @@ sinode *si_bootstrap(si *i, uint64_t parent)
 	sr *r = &i->r;
 	/* create node */
 	uint64_t id = sr_seq(r->seq, SR_NSNNEXT);
-	sinode *n = si_nodenew(r, id, parent);
+	sinode *n = si_nodenew(r, &i->scheme, id, parent);
 	if (ssunlikely(n == NULL))
 		return NULL;
 	int rc;
@@ -242,7 +242,7 @@ si_trackdir(sitrack *track, sr *r, si *i)
 			 * incomplete compaction process */
 			head = si_trackget(track, id_parent);
 			if (sslikely(head == NULL)) {
-				head = si_nodenew(r, id_parent, UINT64_MAX);
+				head = si_nodenew(r, &i->scheme, id_parent, UINT64_MAX);
 				if (ssunlikely(head == NULL))
 					goto error;
 				head->recover = SI_RDB_UNDEF;
@@ -263,7 +263,7 @@ si_trackdir(sitrack *track, sr *r, si *i)
 			}
 			assert(rc == SI_RDB_DBSEAL);
 			/* recover 'sealed' node */
-			node = si_nodenew(r, id, id_parent);
+			node = si_nodenew(r, &i->scheme, id, id_parent);
 			if (ssunlikely(node == NULL))
 				goto error;
 			node->recover = SI_RDB_DBSEAL;
@@ -292,7 +292,7 @@ si_trackdir(sitrack *track, sr *r, si *i)
 
 
 		/* recover node */
-		node = si_nodenew(r, id, id_parent);
+		node = si_nodenew(r, &i->scheme, id, id_parent);
 		if (ssunlikely(node == NULL))
 			goto error;
 		node->recover = SI_RDB;
@@ -432,8 +432,10 @@ si_recoverindex(si *i, sr *r)
 	/* set actual metrics */
 	if (track.nsn > r->seq->nsn)
 		r->seq->nsn = track.nsn;
-	if (track.lsn > r->seq->lsn)
-		r->seq->lsn = track.lsn;
+	if (track.lsn > r->seq->lsn) {
+		r->seq->lsn  = track.lsn;
+		r->seq->vlsn = track.lsn;
+	}
 	ss_buffree(&buf, r->a);
 	return 0;
 error:
@@ -31,13 +31,18 @@ enum {
 static inline void
 si_schemecompaction_init(sicompaction *c)
 {
-	c->cache              = 4ULL * 1024 * 1024 * 1024;
-	c->expire_period      = 0;
-	c->gc_period          = 60;
-	c->gc_wm              = 30;
-	c->node_size          = 64 * 1024 * 1024;
-	c->node_page_size     = 128 * 1024;
-	c->node_page_checksum = 1;
+	c->cache               = 4ULL * 1024 * 1024 * 1024;
+	c->expire_period       = 0;
+	c->gc_period           = 60;
+	c->gc_wm               = 30;
+	c->node_size           = 64 * 1024 * 1024;
+	c->node_page_size      = 128 * 1024;
+	c->node_page_checksum  = 1;
+	c->bloom_bits          = 0;
+	c->parallel            = 1;
+	c->delta_runs          = 0;
+	c->delta_wm            = 50;
+	c->compression_threads = 0;
 }
 
 void si_schemeinit(sischeme *s)
@@ -66,6 +71,10 @@ void si_schemefree(sischeme *s, sr *r)
 		ss_free(r->a, s->compression_sz);
 		s->compression_sz = NULL;
 	}
+	if (s->memtable_sz) {
+		ss_free(r->a, s->memtable_sz);
+		s->memtable_sz = NULL;
+	}
 	sf_schemefree(&s->scheme, r->a);
 }
 
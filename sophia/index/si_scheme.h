@@ -17,6 +17,11 @@ struct sicompaction {
 	uint64_t node_size;
 	uint32_t node_page_size;
 	uint32_t node_page_checksum;
+	uint32_t bloom_bits;
+	uint32_t parallel;
+	uint32_t delta_runs;
+	uint32_t delta_wm;
+	uint32_t compression_threads;
 	uint32_t expire_period;
 	uint64_t expire_period_us;
 	uint32_t gc_period;
@@ -33,6 +38,9 @@ struct sischeme {
 	uint32_t      direct_io;
 	uint32_t      direct_io_page_size;
 	uint32_t      direct_io_buffer_size;
+	uint32_t      read_ahead;
+	uint32_t      memtable;
+	char         *memtable_sz;
 	sicompaction  compaction;
 	uint32_t      sync;
 	uint32_t      expire;
@@ -47,6 +47,13 @@ si_trackmetrics(sitrack *t, sinode *n)
 		t->lsn = h->lsnmin;
 	if (h->lsnmax > t->lsn)
 		t->lsn = h->lsnmax;
+	uint32_t i = 0;
+	while (i < n->delta_count) {
+		h = n->delta[i].h;
+		if (h->lsnmax > t->lsn)
+			t->lsn = h->lsnmax;
+		i++;
+	}
 }
 
 static inline void
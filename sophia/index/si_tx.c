@@ -19,18 +19,44 @@
 void si_begin(sitx *x, si *index)
 {
 	x->index = index;
-	ss_listinit(&x->nodelist);
-	si_lock(index);
+	x->ready = 0;
+	x->node  = NULL;
+	/* node set is stable under the shared lock, in-memory
+	 * indexes are updated under the node locks */
+	si_rdlock(index);
+	/* track the peak of concurrent committers */
+	uint32_t n = __sync_add_and_fetch(&index->writers, 1);
+	uint32_t max = index->writers_max;
+	while (max < n) {
+		if (__sync_bool_compare_and_swap(&index->writers_max, max, n))
+			break;
+		max = index->writers_max;
+	}
 }
 
-void si_commit(sitx *x)
+void si_txnode(sitx *x, sinode *node)
 {
-	/* reschedule nodes */
-	sslist *i, *n;
-	ss_listforeach_safe(&x->nodelist, i, n) {
-		sinode *node = sscast(i, sinode, commit);
-		ss_listinit(&node->commit);
-		si_plannerupdate(&x->index->p, node);
+	/* reschedule the node written so far before its lock
+	 * is released, committers update the planner one
+	 * at a time */
+	sinode *prev = x->node;
+	if (prev) {
+		siplanner *p = &x->index->p;
+		ss_spinlock(&p->lock);
+		si_plannerupdate(p, prev);
+		if (prev->used >= si_plannerwm(p))
+			x->ready = 1;
+		ss_spinunlock(&p->lock);
+		si_noderwunlock(prev);
 	}
-	si_unlock(x->index);
+	if (node)
+		si_nodewrlock(node);
+	x->node = node;
+}
+
+void si_commit(sitx *x)
+{
+	si_txnode(x, NULL);
+	__sync_sub_and_fetch(&x->index->writers, 1);
+	si_rdunlock(x->index);
 }
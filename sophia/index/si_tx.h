@@ -13,17 +13,13 @@ typedef struct sitx sitx;
 
 struct sitx {
 	int ro;
-	sslist nodelist;
+	int ready;
+	sinode *node;
 	si *index;
 };
 
 void si_begin(sitx*, si*);
+void si_txnode(sitx*, sinode*);
 void si_commit(sitx*);
 
-static inline void
-si_txtrack(sitx *x, sinode *n) {
-	if (ss_listempty(&n->commit))
-		ss_listappend(&x->nodelist, &n->commit);
-}
-
 #endif
@@ -26,22 +26,28 @@ static inline int si_set(sitx *x, svv *v)
 	            sv_vpointer(v));
 	sinode *node = ss_iterof(si_iter, &i);
 	assert(node != NULL);
+	/* keep the node locked while versions are
+	 * routed to the same node */
+	if (node != x->node)
+		si_txnode(x, node);
 	/* insert into node index */
 	svindex *vindex = si_nodeindex(node);
 	svindexpos pos;
 	sv_indexget(vindex, &index->r, &pos, v);
-	sv_indexupdate(vindex, &index->r, &pos, v);
+	int rc = sv_indexupdate(vindex, &index->r, &index->btree_pool, &pos, v);
+	if (ssunlikely(rc == -1))
+		return -1;
 	/* update node */
 	node->used += sv_vsize(v, &index->r);
-	si_txtrack(x, node);
 	return 0;
 }
 
-void si_write(sitx *x, svlog *l, svlogindex *li, int recover)
+int si_write(sitx *x, svlog *l, svlogindex *li, int recover)
 {
 	sr *r = &x->index->r;
 	svlogv *cv = sv_logat(l, li->head);
 	int c = li->count;
+	int rc = 0;
 	while (c) {
 		svv *v = cv->v;
 		if (recover) {
@@ -55,10 +61,42 @@ void si_write(sitx *x, svlog *l, svlogindex *li, int recover)
 			sv_vunref(r, v);
 			goto next;
 		}
-		si_set(x, v);
+		rc = si_set(x, v);
+		if (ssunlikely(rc == -1)) {
+			/* versions which are not in the index */
+			while (c) {
+				sv_vunref(r, cv->v);
+				cv = sv_logat(l, cv->next);
+				c--;
+			}
+			break;
+		}
 next:
 		cv = sv_logat(l, cv->next);
 		c--;
 	}
-	return;
+	return rc;
+}
+
+int si_reserve(si *index, svlogindex *li)
+{
+	/* b+tree nodes for the splits are allocated before
+	 * the wal write, so the index write does not fail */
+	if (index->scheme.memtable != SV_INDEXBTREE)
+		return 0;
+	uint32_t reserve;
+	int rc = sv_btreereserve(&index->btree_pool, &index->r,
+	                         li->count, &reserve);
+	if (ssunlikely(rc == -1))
+		return sr_oom(index->r.e);
+	li->reserve = reserve;
+	return 0;
+}
+
+void si_release(si *index, svlogindex *li)
+{
+	if (li->reserve == 0)
+		return;
+	sv_btreerelease(&index->btree_pool, &index->r, li->reserve);
+	li->reserve = 0;
 }
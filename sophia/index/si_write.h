@@ -9,6 +9,8 @@
  * BSD License
 */
 
-void si_write(sitx*, svlog*, svlogindex*, int);
+int  si_write(sitx*, svlog*, svlogindex*, int);
+int  si_reserve(si*, svlogindex*);
+void si_release(si*, svlogindex*);
 
 #endif
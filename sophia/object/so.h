@@ -27,6 +27,7 @@ struct soif {
 	int      (*upsert)(so*, so*);
 	int      (*del)(so*, so*);
 	void    *(*get)(so*, so*);
+	int      (*getbatch)(so*, so**, so**, int);
 	void    *(*begin)(so*);
 	int      (*prepare)(so*);
 	int      (*commit)(so*);
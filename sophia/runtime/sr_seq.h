@@ -18,83 +18,100 @@ typedef enum {
 	SR_BSNNEXT,
 	SR_LSN,
 	SR_LSNNEXT,
+	SR_VLSN,
 	SR_LFSN,
 	SR_LFSNNEXT,
 	SR_TSN,
 	SR_TSNNEXT
 } srseqop;
 
+/* hot counters are kept on separate cache lines,
+ * sequence numbers are updated using atomic operations */
+
 typedef struct {
-	ssspinlock lock;
 	uint32_t   dsn;
-	uint64_t   nsn;
 	uint32_t   bsn;
-	uint64_t   lsn;
+	uint64_t   nsn;
 	uint64_t   lfsn;
+	char       pad0[40];
+	uint64_t   lsn;
+	char       pad1[56];
+	uint64_t   vlsn;
+	char       pad2[56];
 	uint64_t   tsn;
+	char       pad3[56];
 } srseq;
 
 static inline void
 sr_seqinit(srseq *n) {
 	memset(n, 0, sizeof(*n));
-	ss_spinlockinit(&n->lock);
 }
 
 static inline void
 sr_seqfree(srseq *n) {
-	ss_spinlockfree(&n->lock);
-}
-
-static inline void
-sr_seqlock(srseq *n) {
-	ss_spinlock(&n->lock);
-}
-
-static inline void
-sr_sequnlock(srseq *n) {
-	ss_spinunlock(&n->lock);
+	(void)n;
 }
 
 static inline uint64_t
-sr_seqdo(srseq *n, srseqop op)
+sr_seq(srseq *n, srseqop op)
 {
 	uint64_t v = 0;
 	switch (op) {
-	case SR_LSN:       v = n->lsn;
+	case SR_LSN:       v = __sync_fetch_and_add(&n->lsn, 0);
+		break;
+	case SR_LSNNEXT:   v = __sync_add_and_fetch(&n->lsn, 1);
 		break;
-	case SR_LSNNEXT:   v = ++n->lsn;
+	case SR_VLSN:      v = __sync_fetch_and_add(&n->vlsn, 0);
 		break;
-	case SR_TSN:       v = n->tsn;
+	case SR_TSN:       v = __sync_fetch_and_add(&n->tsn, 0);
 		break;
-	case SR_TSNNEXT:   v = ++n->tsn;
+	case SR_TSNNEXT:   v = __sync_add_and_fetch(&n->tsn, 1);
 		break;
-	case SR_NSN:       v = n->nsn;
+	case SR_NSN:       v = __sync_fetch_and_add(&n->nsn, 0);
 		break;
-	case SR_NSNNEXT:   v = ++n->nsn;
+	case SR_NSNNEXT:   v = __sync_add_and_fetch(&n->nsn, 1);
 		break;
-	case SR_LFSN:      v = n->lfsn;
+	case SR_LFSN:      v = __sync_fetch_and_add(&n->lfsn, 0);
 		break;
-	case SR_LFSNNEXT:  v = ++n->lfsn;
+	case SR_LFSNNEXT:  v = __sync_add_and_fetch(&n->lfsn, 1);
 		break;
-	case SR_BSN:       v = n->bsn;
+	case SR_BSN:       v = __sync_fetch_and_add(&n->bsn, 0);
 		break;
-	case SR_BSNNEXT:   v = ++n->bsn;
+	case SR_BSNNEXT:   v = __sync_add_and_fetch(&n->bsn, 1);
 		break;
-	case SR_DSN:       v = n->dsn;
+	case SR_DSN:       v = __sync_fetch_and_add(&n->dsn, 0);
 		break;
-	case SR_DSNNEXT:   v = ++n->dsn;
+	case SR_DSNNEXT:   v = __sync_add_and_fetch(&n->dsn, 1);
 		break;
 	}
 	return v;
 }
 
-static inline uint64_t
-sr_seq(srseq *n, srseqop op)
+static inline void
+sr_seqfollow(uint64_t *seq, uint64_t v)
 {
-	sr_seqlock(n);
-	uint64_t v = sr_seqdo(n, op);
-	sr_sequnlock(n);
-	return v;
+	/* advance sequence to the value, unless
+	 * it is already ahead */
+	for (;;) {
+		uint64_t current = __sync_fetch_and_add(seq, 0);
+		if (current >= v)
+			return;
+		if (__sync_bool_compare_and_swap(seq, current, v))
+			return;
+	}
+}
+
+static inline void
+sr_seqcopy(srseq *n, srseq *dest)
+{
+	memset(dest, 0, sizeof(*dest));
+	dest->dsn  = sr_seq(n, SR_DSN);
+	dest->bsn  = sr_seq(n, SR_BSN);
+	dest->nsn  = sr_seq(n, SR_NSN);
+	dest->lfsn = sr_seq(n, SR_LFSN);
+	dest->lsn  = sr_seq(n, SR_LSN);
+	dest->vlsn = sr_seq(n, SR_VLSN);
+	dest->tsn  = sr_seq(n, SR_TSN);
 }
 
 #endif
@@ -0,0 +1,24 @@
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <libss.h>
+#include <libsf.h>
+#include <libsr.h>
+
+__thread int sr_statslot_id = -1;
+
+static int sr_statslot_seq = 0;
+
+int sr_statslot_new(void)
+{
+	/* threads are assigned to slots round-robin */
+	int id = __sync_fetch_and_add(&sr_statslot_seq, 1) % SR_STAT_SLOTS;
+	sr_statslot_id = id;
+	return id;
+}
@@ -10,61 +10,129 @@
 */
 
 typedef struct srstatxm srstatxm;
+typedef struct srstatv srstatv;
+typedef struct srstatsz srstatsz;
+typedef struct srstatslot srstatslot;
 typedef struct srstat srstat;
 
+/* traced phases of an operation */
+
+enum {
+	SR_PHASE_COMMITLOCK,
+	SR_PHASE_INDEXLOCK,
+	SR_PHASE_INDEXSEARCH,
+	SR_PHASE_PAGEREAD,
+	SR_PHASE_DECOMPRESS,
+	SR_PHASE_UPSERT,
+	SR_PHASE_LOGWRITE,
+	SR_PHASE_LOGSYNC,
+	SR_PHASE_MAX
+};
+
 struct srstatxm {
 	/* transaction */
 	uint64_t tx;
 	uint64_t tx_rlb;
 	uint64_t tx_conflict;
 	uint64_t tx_lock;
-	ssavg    tx_latency;
-	ssavg    tx_stmts;
+	sshist   tx_latency;
+	sshist   tx_stmts;
 };
 
-struct srstat {
-	ssspinlock lock;
+struct srstatv {
 	/* memory */
 	uint64_t v_count;
 	uint64_t v_allocated;
 	/* field */
-	ssavg    field;
+	sshist   field;
 	/* set */
 	uint64_t set;
-	ssavg    set_latency;
+	sshist   set_latency;
 	/* delete */
 	uint64_t del;
-	ssavg    del_latency;
+	sshist   del_latency;
 	/* upsert */
 	uint64_t upsert;
-	ssavg    upsert_latency;
+	sshist   upsert_latency;
 	/* get */
 	uint64_t get;
-	ssavg    get_read_disk;
-	ssavg    get_read_cache;
-	ssavg    get_latency;
+	sshist   get_read_disk;
+	sshist   get_read_cache;
+	sshist   get_latency;
 	/* pread */
 	uint64_t pread;
-	ssavg    pread_latency;
+	sshist   pread_latency;
+	/* page cache */
+	uint64_t page_cache_hit;
+	uint64_t page_cache_miss;
+	/* bloom filter */
+	uint64_t bloom_skip;
+	uint64_t bloom_false_positive;
+	/* compaction */
+	uint64_t page_passthrough;
 	/* cursor */
 	uint64_t cursor;
-	ssavg    cursor_latency;
-	ssavg    cursor_read_disk;
-	ssavg    cursor_read_cache;
-	ssavg    cursor_ops;
+	sshist   cursor_latency;
+	sshist   cursor_read_disk;
+	sshist   cursor_read_cache;
+	sshist   cursor_ops;
+	/* trace, nanoseconds */
+	sshist   phase[SR_PHASE_MAX];
 };
 
-static inline void
-sr_statxm_init(srstatxm *s)
+/* formatted histograms, kept only for a copy */
+
+struct srstatsz {
+	char field[SS_HIST_SZ];
+	char set_latency[SS_HIST_SZ];
+	char del_latency[SS_HIST_SZ];
+	char upsert_latency[SS_HIST_SZ];
+	char get_read_disk[SS_HIST_SZ];
+	char get_read_cache[SS_HIST_SZ];
+	char get_latency[SS_HIST_SZ];
+	char pread_latency[SS_HIST_SZ];
+	char cursor_latency[SS_HIST_SZ];
+	char cursor_read_disk[SS_HIST_SZ];
+	char cursor_read_cache[SS_HIST_SZ];
+	char cursor_ops[SS_HIST_SZ];
+	char phase[SR_PHASE_MAX][SS_HIST_SZ];
+};
+
+/* statistics are accumulated in a slot of the calling
+ * thread and merged when they are read */
+
+#define SR_STAT_SLOTS 8
+
+struct srstatslot {
+	ssspinlock lock;
+	srstatv    v;
+	char       pad[64];
+};
+
+struct srstat {
+	srstatslot slots[SR_STAT_SLOTS];
+	uint32_t   trace;
+};
+
+extern __thread int sr_statslot_id;
+
+int sr_statslot_new(void);
+
+static inline srstatslot*
+sr_statslot(srstat *s)
 {
-	memset(s, 0, sizeof(*s));
+	int id = sr_statslot_id;
+	if (ssunlikely(id == -1))
+		id = sr_statslot_new();
+	return &s->slots[id];
 }
 
 static inline void
-sr_statxm_prepare(srstatxm *s)
+sr_statxm_init(srstatxm *s)
 {
-	ss_avgprepare(&s->tx_latency);
-	ss_avgprepare(&s->tx_stmts);
+	memset(s, 0, sizeof(*s));
+	ss_histinit(&s->tx_latency);
+	ss_histinit(&s->tx_stmts);
 }
 
 static inline void
@@ -75,8 +143,8 @@ sr_statxm(srstatxm *s, uint64_t start, uint32_t count,
 	s->tx++;
 	s->tx_rlb += rlb;
 	s->tx_conflict += conflict;
-	ss_avgupdate(&s->tx_stmts, count);
-	ss_avgupdate(&s->tx_latency, diff);
+	ss_histadd(&s->tx_stmts, count);
+	ss_histadd(&s->tx_latency, diff);
 }
 
 static inline void
@@ -85,82 +153,171 @@ sr_statxm_lock(srstatxm *s)
 	s->tx_lock++;
 }
 
+static inline void
+sr_statvinit(srstatv *v)
+{
+	memset(v, 0, sizeof(*v));
+	ss_histinit(&v->field);
+	ss_histinit(&v->set_latency);
+	ss_histinit(&v->del_latency);
+	ss_histinit(&v->upsert_latency);
+	ss_histinit(&v->get_read_disk);
+	ss_histinit(&v->get_read_cache);
+	ss_histinit(&v->get_latency);
+	ss_histinit(&v->pread_latency);
+	ss_histinit(&v->cursor_latency);
+	ss_histinit(&v->cursor_read_disk);
+	ss_histinit(&v->cursor_read_cache);
+	ss_histinit(&v->cursor_ops);
+	int i = 0;
+	while (i < SR_PHASE_MAX) {
+		ss_histinit(&v->phase[i]);
+		i++;
+	}
+}
+
+static inline void
+sr_statvmerge(srstatv *v, srstatv *src)
+{
+	v->v_count              += src->v_count;
+	v->v_allocated          += src->v_allocated;
+	v->set                  += src->set;
+	v->del                  += src->del;
+	v->upsert               += src->upsert;
+	v->get                  += src->get;
+	v->pread                += src->pread;
+	v->page_cache_hit       += src->page_cache_hit;
+	v->page_cache_miss      += src->page_cache_miss;
+	v->bloom_skip           += src->bloom_skip;
+	v->bloom_false_positive += src->bloom_false_positive;
+	v->page_passthrough     += src->page_passthrough;
+	v->cursor               += src->cursor;
+	ss_histmerge(&v->field, &src->field);
+	ss_histmerge(&v->set_latency, &src->set_latency);
+	ss_histmerge(&v->del_latency, &src->del_latency);
+	ss_histmerge(&v->upsert_latency, &src->upsert_latency);
+	ss_histmerge(&v->get_read_disk, &src->get_read_disk);
+	ss_histmerge(&v->get_read_cache, &src->get_read_cache);
+	ss_histmerge(&v->get_latency, &src->get_latency);
+	ss_histmerge(&v->pread_latency, &src->pread_latency);
+	ss_histmerge(&v->cursor_latency, &src->cursor_latency);
+	ss_histmerge(&v->cursor_read_disk, &src->cursor_read_disk);
+	ss_histmerge(&v->cursor_read_cache, &src->cursor_read_cache);
+	ss_histmerge(&v->cursor_ops, &src->cursor_ops);
+	int i = 0;
+	while (i < SR_PHASE_MAX) {
+		ss_histmerge(&v->phase[i], &src->phase[i]);
+		i++;
+	}
+}
+
 static inline void
 sr_statinit(srstat *s)
 {
-	memset(s, 0, sizeof(*s));
-	ss_spinlockinit(&s->lock);
+	int i = 0;
+	while (i < SR_STAT_SLOTS) {
+		srstatslot *slot = &s->slots[i];
+		ss_spinlockinit(&slot->lock);
+		sr_statvinit(&slot->v);
+		i++;
+	}
+	s->trace = 0;
+}
+
+static inline void
+sr_statfree(srstat *s)
+{
+	int i = 0;
+	while (i < SR_STAT_SLOTS) {
+		ss_spinlockfree(&s->slots[i].lock);
+		i++;
+	}
 }
 
 static inline void
-sr_statfree(srstat *s) {
-	ss_spinlockfree(&s->lock);
+sr_statprepare(srstatv *v, srstatsz *sz)
+{
+	ss_histprepare(&v->field, sz->field, SS_HIST_SZ);
+	ss_histprepare(&v->set_latency, sz->set_latency, SS_HIST_SZ);
+	ss_histprepare(&v->del_latency, sz->del_latency, SS_HIST_SZ);
+	ss_histprepare(&v->upsert_latency, sz->upsert_latency, SS_HIST_SZ);
+	ss_histprepare(&v->get_read_disk, sz->get_read_disk, SS_HIST_SZ);
+	ss_histprepare(&v->get_read_cache, sz->get_read_cache, SS_HIST_SZ);
+	ss_histprepare(&v->get_latency, sz->get_latency, SS_HIST_SZ);
+	ss_histprepare(&v->pread_latency, sz->pread_latency, SS_HIST_SZ);
+	ss_histprepare(&v->cursor_latency, sz->cursor_latency, SS_HIST_SZ);
+	ss_histprepare(&v->cursor_read_disk, sz->cursor_read_disk, SS_HIST_SZ);
+	ss_histprepare(&v->cursor_read_cache, sz->cursor_read_cache, SS_HIST_SZ);
+	ss_histprepare(&v->cursor_ops, sz->cursor_ops, SS_HIST_SZ);
+	int i = 0;
+	while (i < SR_PHASE_MAX) {
+		ss_histprepare(&v->phase[i], sz->phase[i], SS_HIST_SZ);
+		i++;
+	}
 }
 
 static inline void
-sr_statprepare(srstat *s)
+sr_statmemory(srstat *s, int count, int64_t size)
 {
-	ss_avgprepare(&s->field);
-	ss_avgprepare(&s->set_latency);
-	ss_avgprepare(&s->del_latency);
-	ss_avgprepare(&s->upsert_latency);
-	ss_avgprepare(&s->get_read_disk);
-	ss_avgprepare(&s->get_read_cache);
-	ss_avgprepare(&s->get_latency);
-	ss_avgprepare(&s->pread_latency);
-	ss_avgprepare(&s->cursor_latency);
-	ss_avgprepare(&s->cursor_read_disk);
-	ss_avgprepare(&s->cursor_read_cache);
-	ss_avgprepare(&s->cursor_ops);
+	/* documents can be freed by a different thread,
+	 * slot counters are only meaningful as a sum */
+	srstatslot *slot = sr_statslot(s);
+	__sync_add_and_fetch(&slot->v.v_count, count);
+	__sync_add_and_fetch(&slot->v.v_allocated, size);
 }
 
 static inline void
 sr_statfield(srstat *s, int size)
 {
-	ss_spinlock(&s->lock);
-	ss_avgupdate(&s->field, size);
-	ss_spinunlock(&s->lock);
+	srstatslot *slot = sr_statslot(s);
+	ss_spinlock(&slot->lock);
+	ss_histadd(&slot->v.field, size);
+	ss_spinunlock(&slot->lock);
 }
 
 static inline void
 sr_statset(srstat *s, uint64_t start)
 {
 	uint64_t diff = ss_utime() - start;
-	ss_spinlock(&s->lock);
-	s->set++;
-	ss_avgupdate(&s->set_latency, diff);
-	ss_spinunlock(&s->lock);
+	srstatslot *slot = sr_statslot(s);
+	ss_spinlock(&slot->lock);
+	slot->v.set++;
+	ss_histadd(&slot->v.set_latency, diff);
+	ss_spinunlock(&slot->lock);
 }
 
 static inline void
 sr_statdelete(srstat *s, uint64_t start)
 {
 	uint64_t diff = ss_utime() - start;
-	ss_spinlock(&s->lock);
-	s->del++;
-	ss_avgupdate(&s->del_latency, diff);
-	ss_spinunlock(&s->lock);
+	srstatslot *slot = sr_statslot(s);
+	ss_spinlock(&slot->lock);
+	slot->v.del++;
+	ss_histadd(&slot->v.del_latency, diff);
+	ss_spinunlock(&slot->lock);
 }
 
 static inline void
 sr_statupsert(srstat *s, uint64_t start)
 {
 	uint64_t diff = ss_utime() - start;
-	ss_spinlock(&s->lock);
-	s->upsert++;
-	ss_avgupdate(&s->upsert_latency, diff);
-	ss_spinunlock(&s->lock);
+	srstatslot *slot = sr_statslot(s);
+	ss_spinlock(&slot->lock);
+	slot->v.upsert++;
+	ss_histadd(&slot->v.upsert_latency, diff);
+	ss_spinunlock(&slot->lock);
 }
 
 static inline void
 sr_statget(srstat *s, uint64_t diff, int read_disk, int read_cache)
 {
-	ss_spinlock(&s->lock);
-	s->get++;
-	ss_avgupdate(&s->get_read_disk, read_disk);
-	ss_avgupdate(&s->get_read_cache, read_cache);
-	ss_avgupdate(&s->get_latency, diff);
-	ss_spinunlock(&s->lock);
+	srstatslot *slot = sr_statslot(s);
+	ss_spinlock(&slot->lock);
+	slot->v.get++;
+	ss_histadd(&slot->v.get_read_disk, read_disk);
+	ss_histadd(&slot->v.get_read_cache, read_cache);
+	ss_histadd(&slot->v.get_latency, diff);
+	ss_spinunlock(&slot->lock);
 }
 
 static inline void
@@ -169,31 +326,120 @@ sr_statpread(srstat *s, uint64_t start, int from_compaction)
 	if (from_compaction)
 		return;
 	uint64_t diff = ss_utime() - start;
-	ss_spinlock(&s->lock);
-	s->pread++;
-	ss_avgupdate(&s->pread_latency, diff);
-	ss_spinunlock(&s->lock);
+	srstatslot *slot = sr_statslot(s);
+	ss_spinlock(&slot->lock);
+	slot->v.pread++;
+	ss_histadd(&slot->v.pread_latency, diff);
+	ss_spinunlock(&slot->lock);
+}
+
+static inline void
+sr_statpagecache(srstat *s, int hit)
+{
+	srstatslot *slot = sr_statslot(s);
+	ss_spinlock(&slot->lock);
+	if (hit)
+		slot->v.page_cache_hit++;
+	else
+		slot->v.page_cache_miss++;
+	ss_spinunlock(&slot->lock);
+}
+
+static inline void
+sr_statbloom(srstat *s, int false_positive)
+{
+	srstatslot *slot = sr_statslot(s);
+	ss_spinlock(&slot->lock);
+	if (false_positive)
+		slot->v.bloom_false_positive++;
+	else
+		slot->v.bloom_skip++;
+	ss_spinunlock(&slot->lock);
+}
+
+static inline void
+sr_statpassthrough(srstat *s)
+{
+	srstatslot *slot = sr_statslot(s);
+	ss_spinlock(&slot->lock);
+	slot->v.page_passthrough++;
+	ss_spinunlock(&slot->lock);
 }
 
 static inline void
 sr_statcursor(srstat *s, uint64_t start, int read_disk, int read_cache, int ops)
 {
 	uint64_t diff = ss_utime() - start;
-	ss_spinlock(&s->lock);
-	s->cursor++;
-	ss_avgupdate(&s->cursor_read_disk, read_disk);
-	ss_avgupdate(&s->cursor_read_cache, read_cache);
-	ss_avgupdate(&s->cursor_latency, diff);
-	ss_avgupdate(&s->cursor_ops, ops);
-	ss_spinunlock(&s->lock);
+	srstatslot *slot = sr_statslot(s);
+	ss_spinlock(&slot->lock);
+	slot->v.cursor++;
+	ss_histadd(&slot->v.cursor_read_disk, read_disk);
+	ss_histadd(&slot->v.cursor_read_cache, read_cache);
+	ss_histadd(&slot->v.cursor_latency, diff);
+	ss_histadd(&slot->v.cursor_ops, ops);
+	ss_spinunlock(&slot->lock);
+}
+
+static inline uint64_t
+sr_stattrace_begin(srstat *s)
+{
+	if (sslikely(s == NULL || !s->trace))
+		return 0;
+	return ss_ntime();
+}
+
+static inline void
+sr_stattrace(srstat *s, int phase, uint64_t start)
+{
+	if (sslikely(start == 0))
+		return;
+	uint64_t diff = ss_ntime() - start;
+	if (ssunlikely(diff > UINT32_MAX))
+		diff = UINT32_MAX;
+	srstatslot *slot = sr_statslot(s);
+	ss_spinlock(&slot->lock);
+	ss_histadd(&slot->v.phase[phase], diff);
+	ss_spinunlock(&slot->lock);
+}
+
+static inline void
+sr_statreset(srstat *s)
+{
+	/* start a new interval: latency distributions are
+	 * dropped, counters are kept */
+	int i = 0;
+	while (i < SR_STAT_SLOTS) {
+		srstatslot *slot = &s->slots[i];
+		ss_spinlock(&slot->lock);
+		srstatv *v = &slot->v;
+		ss_histinit(&v->set_latency);
+		ss_histinit(&v->del_latency);
+		ss_histinit(&v->upsert_latency);
+		ss_histinit(&v->get_latency);
+		ss_histinit(&v->pread_latency);
+		ss_histinit(&v->cursor_latency);
+		int j = 0;
+		while (j < SR_PHASE_MAX) {
+			ss_histinit(&v->phase[j]);
+			j++;
+		}
+		ss_spinunlock(&slot->lock);
+		i++;
+	}
 }
 
 static inline void
-sr_statcopy(srstat *s, srstat *dest)
+sr_statcopy(srstat *s, srstatv *dest)
 {
-	ss_spinlock(&s->lock);
-	*dest = *s;
-	ss_spinunlock(&s->lock);
+	sr_statvinit(dest);
+	int i = 0;
+	while (i < SR_STAT_SLOTS) {
+		srstatslot *slot = &s->slots[i];
+		ss_spinlock(&slot->lock);
+		sr_statvmerge(dest, &slot->v);
+		ss_spinunlock(&slot->lock);
+		i++;
+	}
 }
 
 #endif
@@ -37,8 +37,18 @@ int sc_init(sc *s, sr *r, swmanager *wm)
 	s->i                        = NULL;
 	s->count                    = 0;
 	s->rr                       = 0;
+	s->idle                     = 0;
 	s->r                        = r;
 	s->wm                       = wm;
+	/* wakeup */
+	ss_mutexinit(&s->wait_lock);
+	ss_condinit(&s->wait_cond);
+	s->wait_count               = 0;
+	s->wait_pending             = 0;
+	s->wait_stop                = 0;
+	/* commit visibility */
+	ss_mutexinit(&s->commit_lock);
+	ss_condinit(&s->commit_cond);
 	ss_threadpool_init(&s->tp);
 	sc_workerpool_init(&s->wp);
 	return 0;
@@ -91,6 +101,10 @@ int sc_shutdown(sc *s)
 {
 	sr *r = s->r;
 	int rcret = 0;
+	ss_mutexlock(&s->wait_lock);
+	s->wait_stop = 1;
+	ss_condbroadcast(&s->wait_cond);
+	ss_mutexunlock(&s->wait_lock);
 	int rc = ss_threadpool_shutdown(&s->tp, r->a);
 	if (ssunlikely(rc == -1))
 		rcret = -1;
@@ -101,6 +115,97 @@ int sc_shutdown(sc *s)
 		ss_free(r->a, s->i);
 		s->i = NULL;
 	}
+	ss_condfree(&s->commit_cond);
+	ss_mutexfree(&s->commit_lock);
+	ss_condfree(&s->wait_cond);
+	ss_mutexfree(&s->wait_lock);
 	ss_mutexfree(&s->lock);
 	return rcret;
 }
+
+static inline uint64_t
+sc_timeout(sc *s)
+{
+	/* sleep until the nearest periodic task is due,
+	 * retry shortly while there is a pending task */
+	uint64_t now = ss_utime();
+	uint64_t timeout = 1000000; /* 1 sec */
+	ss_mutexlock(&s->lock);
+	if (s->backup_in_progress)
+		timeout = 10000;
+	int i = 0;
+	while (i < s->count) {
+		scdb *db = &s->i[i];
+		sicompaction *c = &db->index->scheme.compaction;
+		if (db->checkpoint || db->backup || db->expire || db->gc ||
+		    db->index->gc_count > 0)
+			timeout = 10000;
+		uint64_t due;
+		if (c->expire_period) {
+			due = db->expire_time + c->expire_period_us;
+			if (due <= now)
+				timeout = 0;
+			else
+			if (due - now < timeout)
+				timeout = due - now;
+		}
+		if (c->gc_period) {
+			due = db->gc_time + c->gc_period_us;
+			if (due <= now)
+				timeout = 0;
+			else
+			if (due - now < timeout)
+				timeout = due - now;
+		}
+		i++;
+	}
+	ss_mutexunlock(&s->lock);
+	return timeout;
+}
+
+void sc_wait(sc *s)
+{
+	/* sleep only after a full pass over all
+	 * databases found no work */
+	ss_mutexlock(&s->lock);
+	int idle = s->idle >= s->count;
+	ss_mutexunlock(&s->lock);
+	if (! idle)
+		return;
+	uint64_t timeout = sc_timeout(s);
+	if (ssunlikely(timeout == 0))
+		return;
+	ss_mutexlock(&s->wait_lock);
+	int pending = s->wait_pending;
+	if (pending) {
+		/* wakeup came during the pass, the work may
+		 * belong to a database already checked */
+		s->wait_pending = 0;
+	} else {
+		s->wait_count++;
+		__sync_synchronize();
+		if (! s->wait_pending && ! s->wait_stop)
+			ss_condtimedwait(&s->wait_cond, &s->wait_lock, timeout * 1000);
+		s->wait_count--;
+	}
+	ss_mutexunlock(&s->wait_lock);
+	if (pending) {
+		ss_mutexlock(&s->lock);
+		s->idle = 0;
+		ss_mutexunlock(&s->lock);
+	}
+}
+
+void sc_wakeup(sc *s)
+{
+	/* called on the commit path: signal only once
+	 * per worker wait and only if somebody sleeps */
+	if (__sync_lock_test_and_set(&s->wait_pending, 1) != 0)
+		return;
+	__sync_synchronize();
+	if (s->wait_count == 0)
+		return;
+	ss_mutexlock(&s->wait_lock);
+	ss_condbroadcast(&s->wait_cond);
+	ss_mutexunlock(&s->wait_lock);
+}
@@ -58,8 +58,18 @@ struct sc {
 	/* index */
 	int           rotate;
 	int           rr;
+	int           idle;
 	int           count;
 	scdb         *i;
+	/* worker wakeup */
+	ssmutex       wait_lock;
+	sscond        wait_cond;
+	int           wait_count;
+	int           wait_pending;
+	int           wait_stop;
+	/* commit visibility */
+	ssmutex       commit_lock;
+	sscond        commit_cond;
 	/* pools */
 	ssthreadpool  tp;
 	scworkerpool  wp;
@@ -72,6 +82,8 @@ int sc_set(sc*, uint32_t);
 int sc_setbackup(sc*, char*);
 int sc_run(sc*, ssthreadf, void*, int);
 int sc_shutdown(sc*);
+void sc_wait(sc*);
+void sc_wakeup(sc*);
 
 static inline void
 sc_register(sc *s, si *index)
@@ -18,17 +18,157 @@
 #include <libsy.h>
 #include <libsc.h>
 
-int sc_commit(sc *s, svlog *log, uint64_t lsn, int recover)
+static inline void
+sc_commitfree(svlog *log, svlogindex *i, svlogindex *end)
 {
-	/* write-ahead log */
-	swtx tl;
-	sw_begin(s->wm, &tl, lsn, recover);
-	int rc = sw_write(&tl, log);
+	for (; i < end; i++) {
+		svlogv *cv = sv_logat(log, i->head);
+		int c = i->count;
+		while (c) {
+			sv_vunref(i->r, cv->v);
+			cv = sv_logat(log, cv->next);
+			c--;
+		}
+	}
+}
+
+static inline void
+sc_release(svlogindex *i, svlogindex *end)
+{
+	for (; i < end; i++) {
+		if (i->count == 0)
+			continue;
+		si_release(i->r->ptr, i);
+	}
+}
+
+static inline int
+sc_reserve(svlog *log)
+{
+	svlogindex *i   = (svlogindex*)log->index.s;
+	svlogindex *end = (svlogindex*)log->index.p;
+	svlogindex *p = i;
+	for (; p < end; p++) {
+		if (p->count == 0)
+			continue;
+		int rc = si_reserve(p->r->ptr, p);
+		if (ssunlikely(rc == -1)) {
+			sc_release(i, p);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int sc_begin(sc *s, sctx *t, svlog *log, uint64_t lsn, int recover)
+{
+	/* called under the commit lock, which orders lsn
+	 * assignment, log writes and visibility */
+	t->log      = log;
+	t->recover  = recover;
+	t->lsn_prev = sr_seq(s->r->seq, SR_LSN);
+	svlogindex *i   = (svlogindex*)log->index.s;
+	svlogindex *end = (svlogindex*)log->index.p;
+	int rc = sc_reserve(log);
+	if (ssunlikely(rc == -1)) {
+		sc_commitfree(log, i, end);
+		return -1;
+	}
+	rc = sw_begin(s->wm, &t->tl, log, lsn, recover);
 	if (ssunlikely(rc == -1)) {
-		sw_rollback(&tl);
+		sc_release(i, end);
+		sc_commitfree(log, i, end);
 		return -1;
 	}
-	sw_commit(&tl);
+	return 0;
+}
+
+static inline void
+sc_publish(sc *s, sctx *t)
+{
+	/* make the transaction visible to readers after
+	 * all commits which got lsn before it */
+	srseq *seq = s->r->seq;
+	ss_mutexlock(&s->commit_lock);
+	while (sr_seq(seq, SR_VLSN) < t->lsn_prev)
+		ss_condwait(&s->commit_cond, &s->commit_lock);
+	sr_seqfollow(&seq->vlsn, t->tl.lsn);
+	ss_condbroadcast(&s->commit_cond);
+	ss_mutexunlock(&s->commit_lock);
+}
+
+void sc_commitwait(sc *s, uint64_t lsn)
+{
+	srseq *seq = s->r->seq;
+	if (sslikely(sr_seq(seq, SR_VLSN) >= lsn))
+		return;
+	ss_mutexlock(&s->commit_lock);
+	while (sr_seq(seq, SR_VLSN) < lsn)
+		ss_condwait(&s->commit_cond, &s->commit_lock);
+	ss_mutexunlock(&s->commit_lock);
+}
+
+int sc_commit(sc *s, sctx *t)
+{
+	/* versions which are not in the index are
+	 * released on error */
+	svlog *log = t->log;
+	svlogindex *i   = (svlogindex*)log->index.s;
+	svlogindex *end = (svlogindex*)log->index.p;
+
+	/* write-ahead log */
+	int ready = 0;
+	int rc = sw_write(&t->tl);
+	if (ssunlikely(rc == -1)) {
+		sc_release(i, end);
+		sc_commitfree(log, i, end);
+		goto done;
+	}
+
+	/* index, memtable nodes are reserved by sc_begin() */
+	for (; i < end; i++) {
+		if (i->count == 0)
+			continue;
+		si *index = i->r->ptr;
+		sitx x;
+		si_begin(&x, index);
+		rc = si_write(&x, log, i, t->recover);
+		si_commit(&x);
+		si_release(index, i);
+		ready |= x.ready;
+		if (ssunlikely(rc == -1)) {
+			/* the commit is in the wal but only partly
+			 * applied, it is not reported as a plain
+			 * error: the environment is stopped and
+			 * recovery applies the whole transaction */
+			sr_malfunction_set(s->r->e);
+			sc_release(i + 1, end);
+			sc_commitfree(log, i + 1, end);
+			break;
+		}
+	}
+
+done:
+	/* failed commits are published too, so the
+	 * following ones are not blocked */
+	sc_publish(s, t);
+	if (ssunlikely(rc == -1))
+		return -1;
+
+	/* wakeup workers on compaction or log rotation */
+	if (t->recover)
+		return 0;
+	if (ready || sw_managerrotate_ready(s->wm))
+		sc_wakeup(s);
+	return 0;
+}
+
+int sc_replay(sc *s, svlog *log, uint64_t lsn)
+{
+	/* recovered documents keep their own lsn,
+	 * only advance the sequence */
+	sr_seqfollow(&s->r->seq->lsn, lsn);
+	sr_seqfollow(&s->r->seq->vlsn, lsn);
 
 	/* index */
 	svlogindex *i   = (svlogindex*)log->index.s;
@@ -39,8 +179,12 @@ int sc_commit(sc *s, svlog *log, uint64_t lsn, int recover)
 		si *index = i->r->ptr;
 		sitx x;
 		si_begin(&x, index);
-		si_write(&x, log, i, recover);
+		int rc = si_write(&x, log, i, 1);
 		si_commit(&x);
+		if (ssunlikely(rc == -1)) {
+			sc_commitfree(log, i + 1, end);
+			return -1;
+		}
 	}
 	return 0;
 }
@@ -9,6 +9,18 @@
  * BSD License
 */
 
-int sc_commit(sc*, svlog*, uint64_t, int);
+typedef struct sctx sctx;
+
+struct sctx {
+	swtx     tl;
+	svlog   *log;
+	uint64_t lsn_prev;
+	int      recover;
+};
+
+int  sc_begin(sc*, sctx*, svlog*, uint64_t, int);
+int  sc_commit(sc*, sctx*);
+void sc_commitwait(sc*, uint64_t);
+int  sc_replay(sc*, svlog*, uint64_t);
 
 #endif
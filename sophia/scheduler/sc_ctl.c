@@ -57,6 +57,7 @@ int sc_ctl_expire(sc *s, si *index)
 	scdb *db = sc_of(s, index);
 	sc_task_expire(db);
 	ss_mutexunlock(&s->lock);
+	sc_wakeup(s);
 	return 0;
 }
 
@@ -66,6 +67,7 @@ int sc_ctl_gc(sc *s, si *index)
 	scdb *db = sc_of(s, index);
 	sc_task_gc(db);
 	ss_mutexunlock(&s->lock);
+	sc_wakeup(s);
 	return 0;
 }
 
@@ -75,6 +77,7 @@ int sc_ctl_checkpoint(sc *s, uint64_t vlsn, si *index)
 	scdb *db = sc_of(s, index);
 	sc_task_checkpoint(db, vlsn);
 	ss_mutexunlock(&s->lock);
+	sc_wakeup(s);
 	return 0;
 }
 
@@ -86,7 +89,10 @@ int sc_ctl_backup(sc *s)
 	if (ssunlikely(rc == 1))
 		return 0;
 	rc = sc_backupbegin(s);
-	if (ssunlikely(rc == -1))
+	if (ssunlikely(rc == -1)) {
 		sc_backupstop(s);
-	return rc;
+		return -1;
+	}
+	sc_wakeup(s);
+	return 0;
 }
@@ -267,6 +267,11 @@ sc_schedule(sc *s, sctask *task)
 	task->db = sc_current(s);
 	sc_periodic(s, task);
 	rc = sc_do(s, task);
+	if (rc == SI_PMATCH)
+		s->idle = 0;
+	else
+	if (s->idle < s->count)
+		s->idle++;
 	sc_next(s);
 	ss_mutexunlock(&s->lock);
 	return rc;
@@ -45,6 +45,29 @@ sp_cast(void *ptr, const char *method)
 	return o;
 }
 
+static inline int
+sp_concurrent(so *o)
+{
+	/* documents, transactions and cursors rely on the
+	 * locks of the subsystems they use, configuration
+	 * and ddl are serialized by the api lock */
+	return o->type == &se_o[SEDOCUMENT] ||
+	       o->type == &se_o[SETX] ||
+	       o->type == &se_o[SECURSOR];
+}
+
+static inline void
+sp_lock(so *o) {
+	if (! sp_concurrent(o))
+		se_apilock(o->env);
+}
+
+static inline void
+sp_unlock(so *o) {
+	if (! sp_concurrent(o))
+		se_apiunlock(o->env);
+}
+
 SP_API void *sp_env(void)
 {
 	return se_new();
@@ -57,11 +80,7 @@ SP_API void *sp_document(void *ptr)
 		sp_unsupported(o, __func__);
 		return NULL;
 	}
-	so *e = o->env;
-	se_apilock(e);
-	void *h = o->i->document(o);
-	se_apiunlock(e);
-	return h;
+	return o->i->document(o);
 }
 
 SP_API int sp_open(void *ptr)
@@ -91,9 +110,9 @@ SP_API int sp_destroy(void *ptr)
 		rc = o->i->destroy(o);
 		return rc;
 	}
-	se_apilock(e);
+	sp_lock(o);
 	rc = o->i->destroy(o);
-	se_apiunlock(e);
+	sp_unlock(o);
 	return rc;
 }
 
@@ -104,10 +123,9 @@ SP_API int sp_setstring(void *ptr, const char *path, const void *pointer, int si
 		sp_unsupported(o, __func__);
 		return -1;
 	}
-	so *e = o->env;
-	se_apilock(e);
+	sp_lock(o);
 	int rc = o->i->setstring(o, path, (void*)pointer, size);
-	se_apiunlock(e);
+	sp_unlock(o);
 	return rc;
 }
 
@@ -118,10 +136,9 @@ SP_API int sp_setint(void *ptr, const char *path, int64_t v)
 		sp_unsupported(o, __func__);
 		return -1;
 	}
-	so *e = o->env;
-	se_apilock(e);
+	sp_lock(o);
 	int rc = o->i->setint(o, path, v);
-	se_apiunlock(e);
+	sp_unlock(o);
 	return rc;
 }
 
@@ -132,10 +149,9 @@ SP_API void *sp_getobject(void *ptr, const char *path)
 		sp_unsupported(o, __func__);
 		return NULL;
 	}
-	so *e = o->env;
-	se_apilock(e);
+	sp_lock(o);
 	void *h = o->i->getobject(o, path);
-	se_apiunlock(e);
+	sp_unlock(o);
 	return h;
 }
 
@@ -146,10 +162,9 @@ SP_API void *sp_getstring(void *ptr, const char *path, int *size)
 		sp_unsupported(o, __func__);
 		return NULL;
 	}
-	so *e = o->env;
-	se_apilock(e);
+	sp_lock(o);
 	void *h = o->i->getstring(o, path, size);
-	se_apiunlock(e);
+	sp_unlock(o);
 	return h;
 }
 
@@ -160,10 +175,9 @@ SP_API int64_t sp_getint(void *ptr, const char *path)
 		sp_unsupported(o, __func__);
 		return -1;
 	}
-	so *e = o->env;
-	se_apilock(e);
+	sp_lock(o);
 	int64_t rc = o->i->getint(o, path);
-	se_apiunlock(e);
+	sp_unlock(o);
 	return rc;
 }
 
@@ -175,11 +189,7 @@ SP_API int sp_set(void *ptr, void *ptr_arg)
 		sp_unsupported(o, __func__);
 		return -1;
 	}
-	so *e = o->env;
-	se_apilock(e);
-	int rc = o->i->set(o, v);
-	se_apiunlock(e);
-	return rc;
+	return o->i->set(o, v);
 }
 
 SP_API int sp_upsert(void *ptr, void *ptr_arg)
@@ -190,11 +200,7 @@ SP_API int sp_upsert(void *ptr, void *ptr_arg)
 		sp_unsupported(o, __func__);
 		return -1;
 	}
-	so *e = o->env;
-	se_apilock(e);
-	int rc = o->i->upsert(o, v);
-	se_apiunlock(e);
-	return rc;
+	return o->i->upsert(o, v);
 }
 
 SP_API int sp_delete(void *ptr, void *ptr_arg)
@@ -205,11 +211,7 @@ SP_API int sp_delete(void *ptr, void *ptr_arg)
 		sp_unsupported(o, __func__);
 		return -1;
 	}
-	so *e = o->env;
-	se_apilock(e);
-	int rc = o->i->del(o, v);
-	se_apiunlock(e);
-	return rc;
+	return o->i->del(o, v);
 }
 
 SP_API void *sp_get(void *ptr, void *ptr_arg)
@@ -222,13 +224,33 @@ SP_API void *sp_get(void *ptr, void *ptr_arg)
 		sp_unsupported(o, __func__);
 		return NULL;
 	}
+	/* configuration cursor is the only non-data object
+	 * which supports get */
 	so *e = o->env;
-	se_apilock(e);
+	int lock = o->type == &se_o[SECONFCURSOR];
+	if (lock)
+		se_apilock(e);
 	void *h = o->i->get(o, v);
-	se_apiunlock(e);
+	if (lock)
+		se_apiunlock(e);
 	return h;
 }
 
+SP_API int sp_getbatch(void *ptr, void **keys, void **result, int count)
+{
+	so *o = sp_cast(ptr, __func__);
+	int i = 0;
+	while (i < count) {
+		sp_cast(keys[i], __func__);
+		i++;
+	}
+	if (ssunlikely(o->i->getbatch == NULL)) {
+		sp_unsupported(o, __func__);
+		return -1;
+	}
+	return o->i->getbatch(o, (so**)keys, (so**)result, count);
+}
+
 SP_API void *sp_cursor(void *ptr)
 {
 	so *o = sp_cast(ptr, __func__);
@@ -236,11 +258,7 @@ SP_API void *sp_cursor(void *ptr)
 		sp_unsupported(o, __func__);
 		return NULL;
 	}
-	so *e = o->env;
-	se_apilock(e);
-	void *h = o->i->cursor(o);
-	se_apiunlock(e);
-	return h;
+	return o->i->cursor(o);
 }
 
 SP_API void *sp_begin(void *ptr)
@@ -250,11 +268,7 @@ SP_API void *sp_begin(void *ptr)
 		sp_unsupported(o, __func__);
 		return NULL;
 	}
-	so *e = o->env;
-	se_apilock(e);
-	void *h = o->i->begin(o);
-	se_apiunlock(e);
-	return h;
+	return o->i->begin(o);
 }
 
 SP_API int sp_prepare(void *ptr)
@@ -264,11 +278,7 @@ SP_API int sp_prepare(void *ptr)
 		sp_unsupported(o, __func__);
 		return -1;
 	}
-	so *e = o->env;
-	se_apilock(e);
-	int rc = o->i->prepare(o);
-	se_apiunlock(e);
-	return rc;
+	return o->i->prepare(o);
 }
 
 SP_API int sp_commit(void *ptr)
@@ -278,9 +288,5 @@ SP_API int sp_commit(void *ptr)
 		sp_unsupported(o, __func__);
 		return -1;
 	}
-	so *e = o->env;
-	se_apilock(e);
-	int rc = o->i->commit(o);
-	se_apiunlock(e);
-	return rc;
+	return o->i->commit(o);
 }
@@ -35,6 +35,7 @@ SP_API int      sp_set(void*, void*);
 SP_API int      sp_upsert(void*, void*);
 SP_API int      sp_delete(void*, void*);
 SP_API void    *sp_get(void*, void*);
+SP_API int      sp_getbatch(void*, void**, void**, int);
 SP_API void    *sp_cursor(void*);
 SP_API void    *sp_begin(void*);
 SP_API int      sp_prepare(void*);
@@ -18,12 +18,14 @@
 #include <ss_iov.h>
 #include <ss_mmap.h>
 #include <ss_vfs.h>
+#include <ss_uring.h>
 #include <ss_stdvfs.h>
 #include <ss_testvfs.h>
 #include <ss_file.h>
 #include <ss_a.h>
 #include <ss_ooma.h>
 #include <ss_stda.h>
+#include <ss_slaba.h>
 #include <ss_trace.h>
 #include <ss_gc.h>
 #include <ss_order.h>
@@ -32,8 +34,10 @@
 #include <ss_crc.h>
 #include <ss_type.h>
 #include <ss_mutex.h>
+#include <ss_rwlock.h>
 #include <ss_cond.h>
 #include <ss_thread.h>
+#include <ss_epoch.h>
 #include <ss_rb.h>
 #include <ss_hash.h>
 #include <ss_ht.h>
@@ -45,6 +49,6 @@
 #include <ss_filterof.h>
 #include <ss_iter.h>
 #include <ss_bufiter.h>
-#include <ss_avg.h>
+#include <ss_hist.h>
 
 #endif
@@ -30,9 +30,25 @@ ss_condsignal(sscond *c) {
 	pthread_cond_signal(&c->c);
 }
 
+static inline void
+ss_condbroadcast(sscond *c) {
+	pthread_cond_broadcast(&c->c);
+}
+
 static inline void
 ss_condwait(sscond *c, ssmutex *m) {
 	pthread_cond_wait(&c->c, &m->m);
 }
 
+static inline void
+ss_condtimedwait(sscond *c, ssmutex *m, uint64_t ns)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ns += ts.tv_nsec;
+	ts.tv_sec += ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+	pthread_cond_timedwait(&c->c, &m->m, &ts);
+}
+
 #endif
@@ -0,0 +1,22 @@
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <libss.h>
+
+__thread int ss_epochslot_id = -1;
+
+static int ss_epochslot_seq = 0;
+
+int ss_epochslot_new(void)
+{
+	/* threads are assigned to slots round-robin */
+	int id = __sync_fetch_and_add(&ss_epochslot_seq, 1) % SS_EPOCH_SLOTS;
+	ss_epochslot_id = id;
+	return id;
+}
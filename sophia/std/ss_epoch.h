@@ -0,0 +1,113 @@
+#ifndef SS_EPOCH_H_
+#define SS_EPOCH_H_
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+/* epoch-based reclamation.
+ *
+ * Readers announce an epoch in a per-thread slot.
+ * An object retired at epoch E can be freed once
+ * the global epoch reaches E + 2. Retired objects
+ * are kept by the user until then.
+*/
+
+typedef struct ssepochslot ssepochslot;
+typedef struct ssepoch ssepoch;
+
+#define SS_EPOCH_SLOTS 64
+
+struct ssepochslot {
+	uint32_t active[2];
+	char     pad[56];
+};
+
+struct ssepoch {
+	uint64_t    epoch;
+	ssepochslot slots[SS_EPOCH_SLOTS];
+};
+
+extern __thread int ss_epochslot_id;
+
+int ss_epochslot_new(void);
+
+static inline ssepochslot*
+ss_epochslot(ssepoch *e)
+{
+	int id = ss_epochslot_id;
+	if (ssunlikely(id == -1))
+		id = ss_epochslot_new();
+	return &e->slots[id];
+}
+
+static inline void
+ss_epochinit(ssepoch *e)
+{
+	memset(e, 0, sizeof(*e));
+}
+
+static inline uint64_t
+ss_epochof(ssepoch *e) {
+	return __sync_fetch_and_add(&e->epoch, 0);
+}
+
+static inline uint64_t
+ss_epochenter(ssepoch *e)
+{
+	ssepochslot *s = ss_epochslot(e);
+	for (;;) {
+		uint64_t epoch = ss_epochof(e);
+		__sync_fetch_and_add(&s->active[epoch & 1], 1);
+		if (sslikely(ss_epochof(e) == epoch))
+			return epoch;
+		__sync_fetch_and_sub(&s->active[epoch & 1], 1);
+	}
+	return 0;
+}
+
+static inline void
+ss_epochexit(ssepoch *e, uint64_t epoch)
+{
+	ssepochslot *s = ss_epochslot(e);
+	__sync_fetch_and_sub(&s->active[epoch & 1], 1);
+}
+
+static inline uint32_t
+ss_epochactive(ssepoch *e, int parity)
+{
+	uint32_t active = 0;
+	int i = 0;
+	while (i < SS_EPOCH_SLOTS) {
+		active += __sync_fetch_and_add(&e->slots[i].active[parity], 0);
+		i++;
+	}
+	return active;
+}
+
+static inline int
+ss_epochidle(ssepoch *e) {
+	return ss_epochactive(e, 0) == 0 && ss_epochactive(e, 1) == 0;
+}
+
+static inline void
+ss_epochadvance(ssepoch *e)
+{
+	/* readers of the previous epoch share parity
+	 * with the next one */
+	uint64_t epoch = ss_epochof(e);
+	if (ss_epochactive(e, (epoch + 1) & 1) > 0)
+		return;
+	__sync_bool_compare_and_swap(&e->epoch, epoch, epoch + 1);
+}
+
+static inline int
+ss_epochsafe(ssepoch *e, uint64_t retired) {
+	return ss_epochof(e) >= retired + 2;
+}
+
+#endif
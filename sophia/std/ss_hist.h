@@ -0,0 +1,133 @@
+#ifndef SS_HIST_H_
+#define SS_HIST_H_
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+/* log-linear histogram.
+ *
+ * Values below 16 are counted exactly, larger values
+ * are split into 8 buckets per power of two (relative
+ * error is below 12.5%). Histograms can be merged.
+*/
+
+typedef struct sshist sshist;
+
+#define SS_HIST_BUCKETS 240
+#define SS_HIST_SZ      80
+
+struct sshist {
+	uint64_t count;
+	uint64_t total;
+	uint32_t min, max;
+	uint32_t buckets[SS_HIST_BUCKETS];
+};
+
+static inline void
+ss_histinit(sshist *h)
+{
+	memset(h, 0, sizeof(*h));
+	h->min = UINT32_MAX;
+}
+
+static inline int
+ss_histbucket(uint32_t v)
+{
+	if (v < 16)
+		return v;
+	int e = 31 - __builtin_clz(v);
+	return 16 + (e - 4) * 8 + ((v >> (e - 3)) & 7);
+}
+
+static inline uint32_t
+ss_histvalue(int bucket)
+{
+	/* upper bound of the bucket */
+	if (bucket < 16)
+		return bucket;
+	int e = (bucket - 16) / 8 + 4;
+	uint64_t v = (uint64_t)(8 + (bucket - 16) % 8 + 1) << (e - 3);
+	if (v > UINT32_MAX)
+		return UINT32_MAX;
+	return v - 1;
+}
+
+static inline void
+ss_histadd(sshist *h, uint32_t v)
+{
+	h->count++;
+	h->total += v;
+	if (v < h->min)
+		h->min = v;
+	if (v > h->max)
+		h->max = v;
+	h->buckets[ss_histbucket(v)]++;
+}
+
+static inline void
+ss_histmerge(sshist *h, sshist *src)
+{
+	if (src->count == 0)
+		return;
+	h->count += src->count;
+	h->total += src->total;
+	if (src->min < h->min)
+		h->min = src->min;
+	if (src->max > h->max)
+		h->max = src->max;
+	int i = 0;
+	while (i < SS_HIST_BUCKETS) {
+		h->buckets[i] += src->buckets[i];
+		i++;
+	}
+}
+
+static inline uint32_t
+ss_histpercentile(sshist *h, double percentile)
+{
+	if (h->count == 0)
+		return 0;
+	uint64_t rank = (uint64_t)(h->count * percentile / 100.0);
+	if (rank >= h->count)
+		rank = h->count - 1;
+	uint64_t sum = 0;
+	int i = 0;
+	while (i < SS_HIST_BUCKETS) {
+		sum += h->buckets[i];
+		if (sum > rank) {
+			uint32_t v = ss_histvalue(i);
+			return (v > h->max) ? h->max : v;
+		}
+		i++;
+	}
+	return h->max;
+}
+
+static inline double
+ss_histavg(sshist *h)
+{
+	if (h->count == 0)
+		return 0;
+	return (double)h->total / (double)h->count;
+}
+
+static inline void
+ss_histprepare(sshist *h, char *sz, int size)
+{
+	uint32_t min = h->min;
+	if (ssunlikely(min == UINT32_MAX))
+		min = 0;
+	snprintf(sz, size,
+	         "%"PRIu32" %"PRIu32" %.1f %"PRIu32" %"PRIu32" %"PRIu32,
+	         min, h->max, ss_histavg(h),
+	         ss_histpercentile(h, 50.0),
+	         ss_histpercentile(h, 99.0),
+	         ss_histpercentile(h, 99.9));
+}
+
+#endif
@@ -21,7 +21,7 @@ struct ssiterif {
 
 struct ssiter {
 	ssiterif *vif;
-	char priv[150];
+	char priv[256];
 };
 
 #define ss_iterinit(iterator_if, i) \
@@ -35,6 +35,13 @@
 #include <errno.h>
 #ifdef __linux__
 #include <sys/syscall.h>
+/* io_uring */
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define SS_URING_ENABLE 1
+#endif
+#endif
 #endif
 /* crc */
 #if defined (__x86_64__) || defined (__i386__)
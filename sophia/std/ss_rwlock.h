@@ -0,0 +1,43 @@
+#ifndef SS_RWLOCK_H_
+#define SS_RWLOCK_H_
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+typedef struct ssrwlock ssrwlock;
+
+struct ssrwlock {
+	pthread_rwlock_t l;
+};
+
+static inline void
+ss_rwlockinit(ssrwlock *l) {
+	pthread_rwlock_init(&l->l, NULL);
+}
+
+static inline void
+ss_rwlockfree(ssrwlock *l) {
+	pthread_rwlock_destroy(&l->l);
+}
+
+static inline void
+ss_rwlockrd(ssrwlock *l) {
+	pthread_rwlock_rdlock(&l->l);
+}
+
+static inline void
+ss_rwlockwr(ssrwlock *l) {
+	pthread_rwlock_wrlock(&l->l);
+}
+
+static inline void
+ss_rwunlock(ssrwlock *l) {
+	pthread_rwlock_unlock(&l->l);
+}
+
+#endif
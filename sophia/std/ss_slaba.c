@@ -0,0 +1,236 @@
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <libss.h>
+
+/* slab allocator for small objects.
+ *
+ * Objects are rounded up to one of the size classes and
+ * carved from chunks allocated by the parent allocator.
+ * Every object is prefixed by a pointer to its chunk, so
+ * free is O(1) and a chunk is returned to the parent as
+ * soon as it becomes empty and its class has another
+ * chunk with free space. Larger objects go directly to
+ * the parent allocator with a NULL prefix.
+*/
+
+enum {
+	SS_SLABALIGN   = 16,
+	SS_SLABMAX     = 1024,
+	SS_SLABCLASSES = SS_SLABMAX / SS_SLABALIGN,
+	SS_SLABCHUNK   = 64 * 1024
+};
+
+typedef struct ssslabchunk ssslabchunk;
+typedef struct ssslabclass ssslabclass;
+typedef struct ssslab ssslab;
+
+struct ssslabchunk {
+	ssslabclass *c;
+	char        *free;
+	char        *pos;
+	char        *end;
+	uint32_t     used;
+	int          full;
+	sslist       link;
+};
+
+struct ssslabclass {
+	ssspinlock lock;
+	uint32_t   size;
+	uint32_t   partial_count;
+	sslist     partial;
+	sslist     full;
+};
+
+struct ssslab {
+	ssa        *parent;
+	ssslabclass classes[SS_SLABCLASSES];
+};
+
+typedef struct {
+	ssslab *slab;
+} ssslaba;
+
+#define ss_slab_header sizeof(ssslabchunk*)
+
+static inline int
+ss_slabaopen(ssa *a, va_list args)
+{
+	ssslaba *s = (ssslaba*)a->priv;
+	ssa *parent = va_arg(args, ssa*);
+	ssslab *slab = ss_malloc(parent, sizeof(ssslab));
+	if (ssunlikely(slab == NULL))
+		return -1;
+	slab->parent = parent;
+	int i = 0;
+	while (i < SS_SLABCLASSES) {
+		ssslabclass *c = &slab->classes[i];
+		ss_spinlockinit(&c->lock);
+		c->size = (i + 1) * SS_SLABALIGN;
+		c->partial_count = 0;
+		ss_listinit(&c->partial);
+		ss_listinit(&c->full);
+		i++;
+	}
+	s->slab = slab;
+	return 0;
+}
+
+static inline int
+ss_slabaclose(ssa *a)
+{
+	ssslaba *s = (ssslaba*)a->priv;
+	ssslab *slab = s->slab;
+	int i = 0;
+	while (i < SS_SLABCLASSES) {
+		ssslabclass *c = &slab->classes[i];
+		sslist *p, *n;
+		ss_listforeach_safe(&c->partial, p, n)
+			ss_free(slab->parent, sscast(p, ssslabchunk, link));
+		ss_listforeach_safe(&c->full, p, n)
+			ss_free(slab->parent, sscast(p, ssslabchunk, link));
+		ss_spinlockfree(&c->lock);
+		i++;
+	}
+	ss_free(slab->parent, slab);
+	return 0;
+}
+
+static inline ssslabchunk*
+ss_slabachunk(ssslab *slab, ssslabclass *c)
+{
+	ssslabchunk *chunk = ss_malloc(slab->parent, SS_SLABCHUNK);
+	if (ssunlikely(chunk == NULL))
+		return NULL;
+	chunk->c    = c;
+	chunk->free = NULL;
+	chunk->pos  = (char*)chunk + ss_align(SS_SLABALIGN, sizeof(ssslabchunk));
+	chunk->end  = (char*)chunk + SS_SLABCHUNK;
+	chunk->used = 0;
+	chunk->full = 0;
+	ss_listpush(&c->partial, &chunk->link);
+	c->partial_count++;
+	return chunk;
+}
+
+static inline void*
+ss_slabamalloc(ssa *a, int size)
+{
+	ssslab *slab = ((ssslaba*)a->priv)->slab;
+	uint32_t total = size + ss_slab_header;
+	if (ssunlikely(total > SS_SLABMAX)) {
+		ssslabchunk **p = ss_malloc(slab->parent, total);
+		if (ssunlikely(p == NULL))
+			return NULL;
+		*p = NULL;
+		return (char*)p + ss_slab_header;
+	}
+	ssslabclass *c = &slab->classes[(total - 1) / SS_SLABALIGN];
+	ss_spinlock(&c->lock);
+	ssslabchunk *chunk;
+	if (sslikely(! ss_listempty(&c->partial))) {
+		chunk = sscast(c->partial.next, ssslabchunk, link);
+	} else {
+		chunk = ss_slabachunk(slab, c);
+		if (ssunlikely(chunk == NULL)) {
+			ss_spinunlock(&c->lock);
+			return NULL;
+		}
+	}
+	char *ptr;
+	if (chunk->free) {
+		ptr = chunk->free;
+		chunk->free = *(char**)(ptr + ss_slab_header);
+	} else {
+		ptr = chunk->pos;
+		chunk->pos += c->size;
+	}
+	chunk->used++;
+	if (chunk->free == NULL && chunk->pos + c->size > chunk->end) {
+		ss_listunlink(&chunk->link);
+		ss_listappend(&c->full, &chunk->link);
+		c->partial_count--;
+		chunk->full = 1;
+	}
+	ss_spinunlock(&c->lock);
+	*(ssslabchunk**)ptr = chunk;
+	return ptr + ss_slab_header;
+}
+
+static inline void
+ss_slabafree(ssa *a, void *ptr)
+{
+	assert(ptr != NULL);
+	ssslab *slab = ((ssslaba*)a->priv)->slab;
+	char *p = (char*)ptr - ss_slab_header;
+	ssslabchunk *chunk = *(ssslabchunk**)p;
+	if (ssunlikely(chunk == NULL)) {
+		ss_free(slab->parent, p);
+		return;
+	}
+	ssslabclass *c = chunk->c;
+	ss_spinlock(&c->lock);
+	*(char**)ptr = chunk->free;
+	chunk->free = p;
+	chunk->used--;
+	if (chunk->full) {
+		ss_listunlink(&chunk->link);
+		ss_listpush(&c->partial, &chunk->link);
+		c->partial_count++;
+		chunk->full = 0;
+	}
+	/* keep one partial chunk per class to avoid
+	 * allocating chunks back and forth */
+	if (chunk->used == 0 && c->partial_count > 1) {
+		ss_listunlink(&chunk->link);
+		c->partial_count--;
+		ss_spinunlock(&c->lock);
+		ss_free(slab->parent, chunk);
+		return;
+	}
+	ss_spinunlock(&c->lock);
+}
+
+static inline void*
+ss_slabarealloc(ssa *a, void *ptr, int size)
+{
+	if (ptr == NULL)
+		return ss_slabamalloc(a, size);
+	ssslab *slab = ((ssslaba*)a->priv)->slab;
+	char *p = (char*)ptr - ss_slab_header;
+	ssslabchunk *chunk = *(ssslabchunk**)p;
+	if (chunk == NULL &&
+	    size + ss_slab_header > SS_SLABMAX) {
+		p = ss_realloc(slab->parent, p, size + ss_slab_header);
+		if (ssunlikely(p == NULL))
+			return NULL;
+		return p + ss_slab_header;
+	}
+	void *n = ss_slabamalloc(a, size);
+	if (ssunlikely(n == NULL))
+		return NULL;
+	if (chunk) {
+		int copy = chunk->c->size - ss_slab_header;
+		memcpy(n, ptr, copy < size ? copy : size);
+	} else {
+		memcpy(n, ptr, size);
+	}
+	ss_slabafree(a, ptr);
+	return n;
+}
+
+ssaif ss_slaba =
+{
+	.open    = ss_slabaopen,
+	.close   = ss_slabaclose,
+	.malloc  = ss_slabamalloc,
+	.realloc = ss_slabarealloc,
+	.free    = ss_slabafree
+};
@@ -0,0 +1,14 @@
+#ifndef SS_SLABA_H_
+#define SS_SLABA_H_
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+extern ssaif ss_slaba;
+
+#endif
@@ -104,16 +104,18 @@ ss_stdvfs_sync_file_range(ssvfs *f ssunused, int fd, uint64_t off, uint64_t size
 static int
 ss_stdvfs_advise(ssvfs *f ssunused, int fd, int hint, uint64_t off, uint64_t len)
 {
-	(void)hint;
 #if  defined(__APPLE__) || \
      defined(__FreeBSD__) || \
     (defined(__FreeBSD_kernel__) && defined(__GLIBC__)) || \
      defined(__DragonFly__)
+	(void)hint;
 	(void)fd;
 	(void)off;
 	(void)len;
 	return 0;
 #else
+	if (hint == SS_VFSADVISE_WILLNEED)
+		return posix_fadvise(fd, off, len, POSIX_FADV_WILLNEED);
 	return posix_fadvise(fd, off, len, POSIX_FADV_DONTNEED);
 #endif
 }
@@ -141,6 +143,24 @@ ss_stdvfs_pread(ssvfs *f ssunused, int fd, uint64_t off, void *buf, int size)
 	return n;
 }
 
+static int
+ss_stdvfs_pread_batch(ssvfs *f, ssvfsio *io, int count)
+{
+	int rc = ss_uringpread(io, count);
+	if (sslikely(rc != 1))
+		return rc;
+	/* synchronous fallback */
+	int i = 0;
+	while (i < count) {
+		io[i].rc = ss_stdvfs_pread(f, io[i].fd, io[i].offset,
+		                           io[i].buf, io[i].size);
+		if (ssunlikely(io[i].rc == -1))
+			return -1;
+		i++;
+	}
+	return 0;
+}
+
 static int64_t
 ss_stdvfs_write(ssvfs *f ssunused, int fd, void *buf, int size)
 {
@@ -298,6 +318,7 @@ ssvfsif ss_stdvfs =
 	.advise          = ss_stdvfs_advise,
 	.truncate        = ss_stdvfs_truncate,
 	.pread           = ss_stdvfs_pread,
+	.pread_batch     = ss_stdvfs_pread_batch,
 	.write           = ss_stdvfs_write,
 	.writev          = ss_stdvfs_writev,
 	.seek            = ss_stdvfs_seek,
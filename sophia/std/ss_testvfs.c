@@ -147,6 +147,14 @@ ss_testvfs_pread(ssvfs *f, int fd, uint64_t off, void *buf, int size)
 	return ss_stdvfs.pread(f, fd, off, buf, size);
 }
 
+static int
+ss_testvfs_pread_batch(ssvfs *f, ssvfsio *io, int count)
+{
+	if (ss_testvfs_call(f))
+		return -1;
+	return ss_stdvfs.pread_batch(f, io, count);
+}
+
 static int64_t
 ss_testvfs_write(ssvfs *f, int fd, void *buf, int size)
 {
@@ -228,6 +236,7 @@ ssvfsif ss_testvfs =
 	.advise          = ss_testvfs_advise,
 	.truncate        = ss_testvfs_truncate,
 	.pread           = ss_testvfs_pread,
+	.pread_batch     = ss_testvfs_pread_batch,
 	.write           = ss_testvfs_write,
 	.writev          = ss_testvfs_writev,
 	.seek            = ss_testvfs_seek,
@@ -54,6 +54,25 @@ error:
 	return -1;
 }
 
+int ss_threadnew(ssthread *t, ssthreadf f, void *arg)
+{
+	ss_listinit(&t->link);
+	t->f = f;
+	t->arg = arg;
+	int rc = pthread_create(&t->id, NULL, f, t);
+	if (ssunlikely(rc != 0))
+		return -1;
+	return 0;
+}
+
+int ss_threadjoin(ssthread *t)
+{
+	int rc = pthread_join(t->id, NULL);
+	if (ssunlikely(rc != 0))
+		return -1;
+	return 0;
+}
+
 int ss_thread_setname(ssthread *t, char *name)
 {
 	#if defined(__APPLE__)
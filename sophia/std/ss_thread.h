@@ -26,6 +26,8 @@ struct ssthreadpool {
 	int n;
 };
 
+int ss_threadnew(ssthread*, ssthreadf, void*);
+int ss_threadjoin(ssthread*);
 int ss_thread_setname(ssthread*, char*);
 int ss_threadpool_init(ssthreadpool*);
 int ss_threadpool_shutdown(ssthreadpool*, ssa*);
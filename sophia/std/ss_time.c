@@ -30,6 +30,17 @@ uint64_t ss_utime(void)
 #endif
 }
 
+uint64_t ss_ntime(void)
+{
+#if defined(__APPLE__)
+	return ss_utime() * 1000ULL;
+#else
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000000000ULL + t.tv_nsec;
+#endif
+}
+
 uint32_t ss_timestamp(void)
 {
 	return time(NULL);
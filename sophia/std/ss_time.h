@@ -11,6 +11,7 @@
 
 void     ss_sleep(uint64_t);
 uint64_t ss_utime(void);
+uint64_t ss_ntime(void);
 uint32_t ss_timestamp(void);
 
 #endif
@@ -0,0 +1,313 @@
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <libss.h>
+
+#ifdef SS_URING_ENABLE
+
+#define SS_URING_ENTRIES 64
+
+typedef struct ssuring ssuring;
+
+struct ssuring {
+	int                  fd;
+	uint32_t            *sq_head;
+	uint32_t            *sq_tail;
+	uint32_t            *sq_mask;
+	uint32_t            *sq_array;
+	uint32_t             sq_entries;
+	struct io_uring_sqe *sqes;
+	uint32_t            *cq_head;
+	uint32_t            *cq_tail;
+	uint32_t            *cq_mask;
+	struct io_uring_cqe *cqes;
+	void                *sq_ptr;
+	size_t               sq_size;
+	void                *cq_ptr;
+	size_t               cq_size;
+	size_t               sqes_size;
+};
+
+static pthread_once_t ss_uring_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  ss_uring_key;
+static int            ss_uring_unsupported = 0;
+
+static void
+ss_uringfree(ssuring *u)
+{
+	if (u->sqes)
+		munmap(u->sqes, u->sqes_size);
+	if (u->cq_ptr && u->cq_ptr != u->sq_ptr)
+		munmap(u->cq_ptr, u->cq_size);
+	if (u->sq_ptr)
+		munmap(u->sq_ptr, u->sq_size);
+	if (u->fd != -1)
+		close(u->fd);
+	free(u);
+}
+
+static void
+ss_uringdestructor(void *arg)
+{
+	ss_uringfree(arg);
+}
+
+static void
+ss_uringonce(void)
+{
+	int rc = pthread_key_create(&ss_uring_key, ss_uringdestructor);
+	if (ssunlikely(rc != 0))
+		ss_uring_unsupported = 1;
+}
+
+static inline void*
+ss_uringmap(int fd, size_t size, uint64_t offset)
+{
+	void *p = mmap(NULL, size, PROT_READ|PROT_WRITE,
+	               MAP_SHARED|MAP_POPULATE, fd, offset);
+	if (ssunlikely(p == MAP_FAILED))
+		return NULL;
+	return p;
+}
+
+static ssuring*
+ss_uringnew(void)
+{
+	ssuring *u = malloc(sizeof(*u));
+	if (ssunlikely(u == NULL))
+		return NULL;
+	memset(u, 0, sizeof(*u));
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	u->fd = syscall(__NR_io_uring_setup, SS_URING_ENTRIES, &p);
+	if (ssunlikely(u->fd == -1)) {
+		/* disabled by kernel or seccomp */
+		if (errno == ENOSYS || errno == EPERM)
+			ss_uring_unsupported = 1;
+		goto error;
+	}
+	u->sq_size = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+	u->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	int single = (p.features & IORING_FEAT_SINGLE_MMAP) > 0;
+	if (single) {
+		if (u->cq_size > u->sq_size)
+			u->sq_size = u->cq_size;
+		u->cq_size = u->sq_size;
+	}
+	u->sq_ptr = ss_uringmap(u->fd, u->sq_size, IORING_OFF_SQ_RING);
+	if (ssunlikely(u->sq_ptr == NULL))
+		goto error;
+	if (single) {
+		u->cq_ptr = u->sq_ptr;
+	} else {
+		u->cq_ptr = ss_uringmap(u->fd, u->cq_size, IORING_OFF_CQ_RING);
+		if (ssunlikely(u->cq_ptr == NULL))
+			goto error;
+	}
+	u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	u->sqes = ss_uringmap(u->fd, u->sqes_size, IORING_OFF_SQES);
+	if (ssunlikely(u->sqes == NULL))
+		goto error;
+	char *sq = u->sq_ptr;
+	char *cq = u->cq_ptr;
+	u->sq_head    = (uint32_t*)(sq + p.sq_off.head);
+	u->sq_tail    = (uint32_t*)(sq + p.sq_off.tail);
+	u->sq_mask    = (uint32_t*)(sq + p.sq_off.ring_mask);
+	u->sq_array   = (uint32_t*)(sq + p.sq_off.array);
+	u->sq_entries = p.sq_entries;
+	u->cq_head    = (uint32_t*)(cq + p.cq_off.head);
+	u->cq_tail    = (uint32_t*)(cq + p.cq_off.tail);
+	u->cq_mask    = (uint32_t*)(cq + p.cq_off.ring_mask);
+	u->cqes       = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+	return u;
+error:
+	ss_uringfree(u);
+	return NULL;
+}
+
+static inline ssuring*
+ss_uringof(void)
+{
+	pthread_once(&ss_uring_once, ss_uringonce);
+	if (ssunlikely(ss_uring_unsupported))
+		return NULL;
+	ssuring *u = pthread_getspecific(ss_uring_key);
+	if (sslikely(u))
+		return u;
+	u = ss_uringnew();
+	if (ssunlikely(u == NULL))
+		return NULL;
+	pthread_setspecific(ss_uring_key, u);
+	return u;
+}
+
+static inline void
+ss_uringdrop(ssuring *u)
+{
+	pthread_setspecific(ss_uring_key, NULL);
+	ss_uringfree(u);
+}
+
+static inline int
+ss_uringreap(ssuring *u, ssvfsio *io)
+{
+	int completed = 0;
+	uint32_t head = *u->cq_head;
+	__sync_synchronize();
+	uint32_t cq_tail = *u->cq_tail;
+	uint32_t cq_mask = *u->cq_mask;
+	while (head != cq_tail) {
+		struct io_uring_cqe *cqe = &u->cqes[head & cq_mask];
+		io[cqe->user_data].rc = cqe->res;
+		completed++;
+		head++;
+	}
+	__sync_synchronize();
+	*u->cq_head = head;
+	return completed;
+}
+
+static int
+ss_uringdrain(ssuring *u, ssvfsio *io, int inflight)
+{
+	/* submitted reads write into the caller buffers,
+	 * wait for them before the ring is closed */
+	while (inflight > 0) {
+		int rc = syscall(__NR_io_uring_enter, u->fd, 0,
+		                 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (ssunlikely(rc == -1)) {
+			if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+				continue;
+			return -1;
+		}
+		inflight -= ss_uringreap(u, io);
+	}
+	return 0;
+}
+
+static int
+ss_uringsubmit(ssuring *u, ssvfsio *io, int count)
+{
+	/* queue requests */
+	uint32_t mask = *u->sq_mask;
+	uint32_t tail = *u->sq_tail;
+	int i = 0;
+	while (i < count) {
+		uint32_t idx = tail & mask;
+		struct io_uring_sqe *sqe = &u->sqes[idx];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode    = IORING_OP_READ;
+		sqe->fd        = io[i].fd;
+		sqe->off       = io[i].offset;
+		sqe->addr      = (uint64_t)(uintptr_t)io[i].buf;
+		sqe->len       = io[i].size;
+		sqe->user_data = i;
+		u->sq_array[idx] = idx;
+		tail++;
+		i++;
+	}
+	__sync_synchronize();
+	*u->sq_tail = tail;
+	__sync_synchronize();
+
+	/* submit and wait for completions */
+	int submitted = 0;
+	int completed = 0;
+	while (completed < count) {
+		int rc = syscall(__NR_io_uring_enter, u->fd, count - submitted,
+		                 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (ssunlikely(rc == -1)) {
+			if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+				continue;
+			int error = errno;
+			rc = ss_uringdrain(u, io, submitted - completed);
+			errno = error;
+			return (rc == -1) ? -2 : -1;
+		}
+		submitted += rc;
+		completed += ss_uringreap(u, io);
+	}
+	return 0;
+}
+
+static inline int
+ss_uringcomplete(ssvfsio *io)
+{
+	/* finish short reads and requests which are
+	 * not supported by the kernel synchronously */
+	int64_t n = io->rc;
+	if (n < 0) {
+		if (n != -EINVAL && n != -EOPNOTSUPP && n != -EAGAIN && n != -EINTR) {
+			errno = -n;
+			io->rc = -1;
+			return -1;
+		}
+		n = 0;
+	}
+	while (n < io->size) {
+		ssize_t r = pread(io->fd, (char*)io->buf + n, io->size - n,
+		                  io->offset + n);
+		if (r == -1 && errno == EINTR)
+			continue;
+		if (r <= 0) {
+			if (r == 0)
+				errno = EIO;
+			io->rc = -1;
+			return -1;
+		}
+		n += r;
+	}
+	io->rc = n;
+	return 0;
+}
+
+int ss_uringpread(ssvfsio *io, int count)
+{
+	ssuring *u = ss_uringof();
+	if (ssunlikely(u == NULL))
+		return 1;
+	int pos = 0;
+	while (pos < count) {
+		int n = count - pos;
+		if (n > (int)u->sq_entries)
+			n = u->sq_entries;
+		int rc = ss_uringsubmit(u, io + pos, n);
+		if (ssunlikely(rc < 0)) {
+			/* the ring is left open if reads are still
+			 * in flight, closing it does not stop them */
+			int error = errno;
+			if (rc == -2)
+				pthread_setspecific(ss_uring_key, NULL);
+			else
+				ss_uringdrop(u);
+			errno = error;
+			return -1;
+		}
+		pos += n;
+	}
+	int rcret = 0;
+	int i = 0;
+	while (i < count) {
+		if (ssunlikely(io[i].rc != io[i].size)) {
+			if (ss_uringcomplete(&io[i]) == -1)
+				rcret = -1;
+		}
+		i++;
+	}
+	return rcret;
+}
+
+#else
+
+int ss_uringpread(ssvfsio *io ssunused, int count ssunused)
+{
+	return 1;
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SS_URING_H_
+#define SS_URING_H_
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+/* io_uring based batch read.
+ *
+ * Every thread lazily creates its own ring, so concurrent
+ * readers never share a submission queue. Returns 1 if
+ * io_uring is not supported by the system and the caller
+ * should fall back to synchronous reads.
+*/
+
+int ss_uringpread(ssvfsio*, int);
+
+#endif
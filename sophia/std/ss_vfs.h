@@ -9,9 +9,25 @@
  * BSD License
 */
 
+typedef struct ssvfsio ssvfsio;
 typedef struct ssvfsif ssvfsif;
 typedef struct ssvfs ssvfs;
 
+enum {
+	SS_VFSADVISE_DONTNEED = 0,
+	SS_VFSADVISE_WILLNEED = 1
+};
+
+/* single read request of a batch */
+
+struct ssvfsio {
+	int      fd;
+	uint64_t offset;
+	void    *buf;
+	int      size;
+	int64_t  rc;
+};
+
 struct ssvfsif {
 	int     (*init)(ssvfs*, va_list);
 	void    (*free)(ssvfs*);
@@ -28,6 +44,7 @@ struct ssvfsif {
 	int     (*advise)(ssvfs*, int, int, uint64_t, uint64_t);
 	int     (*truncate)(ssvfs*, int, uint64_t);
 	int64_t (*pread)(ssvfs*, int, uint64_t, void*, int);
+	int     (*pread_batch)(ssvfs*, ssvfsio*, int);
 	int64_t (*write)(ssvfs*, int, void*, int);
 	int64_t (*writev)(ssvfs*, int, ssiov*);
 	int64_t (*seek)(ssvfs*, int, uint64_t);
@@ -73,6 +90,7 @@ ss_vfsfree(ssvfs *f)
 #define ss_vfsadvise(fs, fd, hint, off, len)     (fs)->i->advise(fs, fd, hint, off, len)
 #define ss_vfstruncate(fs, fd, size)             (fs)->i->truncate(fs, fd, size)
 #define ss_vfspread(fs, fd, off, buf, size)      (fs)->i->pread(fs, fd, off, buf, size)
+#define ss_vfspread_batch(fs, io, count)         (fs)->i->pread_batch(fs, io, count)
 #define ss_vfspwrite(fs, fd, off, buf, size)     (fs)->i->pwrite(fs, fd, off, buf, size)
 #define ss_vfswrite(fs, fd, buf, size)           (fs)->i->write(fs, fd, buf, size)
 #define ss_vfswritev(fs, fd, iov)                (fs)->i->writev(fs, fd, iov)
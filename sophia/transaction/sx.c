@@ -14,22 +14,42 @@
 #include <libso.h>
 #include <libsx.h>
 
+static __thread int sx_slot_id = -1;
+static int sx_slot_seq = 0;
+
 static inline int
 sx_count(sxmanager *m) {
 	return m->count_rd + m->count_rw;
 }
 
+static inline int
+sx_slot(void)
+{
+	if (ssunlikely(sx_slot_id == -1))
+		sx_slot_id = __sync_fetch_and_add(&sx_slot_seq, 1);
+	return sx_slot_id % SX_SLOTS;
+}
+
 int sx_managerinit(sxmanager *m, srseq *seq, ssa *a)
 {
-	ss_rbinit(&m->i);
+	int i = 0;
+	while (i < SX_SLOTS) {
+		sxslot *s = &m->slots[i];
+		ss_spinlockinit(&s->lock);
+		ss_rbinit(&s->i);
+		ss_rbinit(&s->iv);
+		s->vlsn = UINT64_MAX;
+		i++;
+	}
 	m->count_rd = 0;
 	m->count_rw = 0;
 	m->count_gc = 0;
 	m->csn = 0;
 	m->gc  = NULL;
-	ss_spinlockinit(&m->lock);
+	ss_mutexinit(&m->lock_tx);
+	ss_mutexinit(&m->lock_commit);
 	ss_listinit(&m->indexes);
-	sx_vpool_init(&m->pool, a);
+	m->a   = a;
 	m->seq = seq;
 	return 0;
 }
@@ -37,14 +57,26 @@ int sx_managerinit(sxmanager *m, srseq *seq, ssa *a)
 int sx_managerfree(sxmanager *m)
 {
 	assert(sx_count(m) == 0);
-	sx_vpool_free(&m->pool);
-	ss_spinlockfree(&m->lock);
+	ss_mutexfree(&m->lock_commit);
+	ss_mutexfree(&m->lock_tx);
+	int i = 0;
+	while (i < SX_SLOTS) {
+		ss_spinlockfree(&m->slots[i].lock);
+		i++;
+	}
 	return 0;
 }
 
 int sx_indexinit(sxindex *i, sxmanager *m, sr *r, so *object)
 {
-	ss_rbinit(&i->i);
+	int k = 0;
+	while (k < SX_INDEX_PARTS) {
+		sxindexpart *p = &i->part[k];
+		ss_spinlockinit(&p->lock);
+		ss_rbinit(&p->i);
+		sx_vpool_init(&p->pool, m->a);
+		k++;
+	}
 	ss_listinit(&i->link);
 	i->dsn = 0;
 	i->object = object;
@@ -63,45 +95,89 @@ ss_rbtruncate(sx_truncate, sx_vfreeall( ((void**)arg)[1],
                                         ((void**)arg)[0], sscast(n, sxv, node)))
 
 static inline void
-sx_indextruncate(sxindex *i, sxmanager *m)
+sx_indextruncate(sxindex *i)
 {
-	if (i->i.root == NULL)
-		return;
-	void *args[2] = { i->r, &m->pool };
-	sx_truncate(i->i.root, args);
-	ss_rbinit(&i->i);
+	int k = 0;
+	while (k < SX_INDEX_PARTS) {
+		sxindexpart *p = &i->part[k];
+		if (p->i.root) {
+			void *args[2] = { i->r, &p->pool };
+			sx_truncate(p->i.root, args);
+			ss_rbinit(&p->i);
+		}
+		k++;
+	}
 }
 
 int sx_indexfree(sxindex *i, sxmanager *m)
 {
-	sx_indextruncate(i, m);
+	(void)m;
+	sx_indextruncate(i);
+	int k = 0;
+	while (k < SX_INDEX_PARTS) {
+		sxindexpart *p = &i->part[k];
+		sx_vpool_free(&p->pool);
+		ss_spinlockfree(&p->lock);
+		k++;
+	}
 	ss_listunlink(&i->link);
 	return 0;
 }
 
+static inline sxindexpart*
+sx_indexpart(sxindex *i, char *key) {
+	return &i->part[sf_hash(i->r->scheme, key) % SX_INDEX_PARTS];
+}
+
 uint64_t sx_vlsn(sxmanager *m)
 {
-	ss_spinlock(&m->lock);
-	uint64_t vlsn;
-	if (sx_count(m) > 0) {
-		ssrbnode *node = ss_rbmin(&m->i);
-		sx *min = sscast(node, sx, node);
-		vlsn = min->vlsn;
-	} else {
-		vlsn = sr_seq(m->seq, SR_LSN);
+	/* current vlsn must be read before the slots: a
+	 * transaction which is registered after its slot has
+	 * been checked gets a view which is not older */
+	uint64_t vlsn = sr_seq(m->seq, SR_VLSN);
+	int i = 0;
+	while (i < SX_SLOTS) {
+		uint64_t slot_vlsn =
+			__sync_fetch_and_add(&m->slots[i].vlsn, 0);
+		if (slot_vlsn < vlsn)
+			vlsn = slot_vlsn;
+		i++;
 	}
-	ss_spinunlock(&m->lock);
 	return vlsn;
 }
 
+static inline int
+sx_cmpview(sx *a, sx *b)
+{
+	if (a->vlsn != b->vlsn)
+		return (a->vlsn > b->vlsn) ? 1 : -1;
+	return ss_cmp(a->id, b->id);
+}
+
+ss_rbget(sx_matchview, sx_cmpview(sscast(n, sx, node_view), (sx*)key))
+
+static inline void
+sx_slotvlsn(sxslot *s)
+{
+	uint64_t vlsn = UINT64_MAX;
+	ssrbnode *p = ss_rbmin(&s->iv);
+	if (p)
+		vlsn = sscast(p, sx, node_view)->vlsn;
+	s->vlsn = vlsn;
+	__sync_synchronize();
+}
+
 ss_rbget(sx_matchtx, ss_cmp((sscast(n, sx, node))->id, sscastu64(key)))
 
 sx *sx_find(sxmanager *m, uint64_t id)
 {
+	sxslot *s = &m->slots[id % SX_SLOTS];
 	ssrbnode *n = NULL;
-	int rc = sx_matchtx(&m->i, NULL, (char*)&id, sizeof(id), &n);
+	ss_spinlock(&s->lock);
+	int rc = sx_matchtx(&s->i, NULL, (char*)&id, sizeof(id), &n);
+	ss_spinunlock(&s->lock);
 	if (rc == 0 && n)
-		return  sscast(n, sx, node);
+		return sscast(n, sx, node);
 	return NULL;
 }
 
@@ -126,27 +202,41 @@ sxstate sx_begin(sxmanager *m, sx *x, sxtype type, svlog *log, uint64_t vlsn)
 	sx_promote(x, SX_READY);
 	x->type = type;
 	x->log_read = -1;
-	sr_seqlock(m->seq);
-	x->csn = m->csn;
-	x->id = sr_seqdo(m->seq, SR_TSNNEXT);
-	if (sslikely(vlsn == UINT64_MAX))
-		x->vlsn = sr_seqdo(m->seq, SR_LSN);
-	else
+	int slot = sx_slot();
+	sxslot *s = &m->slots[slot];
+	x->slot = s;
+	ss_spinlock(&s->lock);
+	uint64_t slot_vlsn = s->vlsn;
+	x->csn = __sync_fetch_and_add(&m->csn, 0);
+	x->id = sr_seq(m->seq, SR_TSNNEXT) * SX_SLOTS + slot;
+	if (sslikely(vlsn == UINT64_MAX)) {
+		/* hold the horizon back while the view is
+		 * being taken */
+		s->vlsn = 0;
+		__sync_synchronize();
+		x->vlsn = sr_seq(m->seq, SR_VLSN);
+	} else {
 		x->vlsn = vlsn;
-	sr_sequnlock(m->seq);
-	ss_spinlock(&m->lock);
+	}
+	if (x->vlsn < slot_vlsn)
+		slot_vlsn = x->vlsn;
+	s->vlsn = slot_vlsn;
+	__sync_synchronize();
 	ssrbnode *n = NULL;
-	int rc = sx_matchtx(&m->i, NULL, (char*)&x->id, sizeof(x->id), &n);
+	int rc = sx_matchtx(&s->i, NULL, (char*)&x->id, sizeof(x->id), &n);
 	if (rc == 0 && n) {
 		assert(0);
 	} else {
-		ss_rbset(&m->i, n, rc, &x->node);
+		ss_rbset(&s->i, n, rc, &x->node);
 	}
+	n = NULL;
+	rc = sx_matchview(&s->iv, NULL, (char*)x, 0, &n);
+	ss_rbset(&s->iv, n, rc, &x->node_view);
+	ss_spinunlock(&s->lock);
 	if (type == SX_RO)
-		m->count_rd++;
+		__sync_fetch_and_add(&m->count_rd, 1);
 	else
-		m->count_rw++;
-	ss_spinunlock(&m->lock);
+		__sync_fetch_and_add(&m->count_rw, 1);
 	return SX_READY;
 }
 
@@ -154,11 +244,11 @@ static inline void
 sx_untrack(sxv *v)
 {
 	if (v->prev == NULL) {
-		sxindex *i = v->index;
+		sxindexpart *p = v->part;
 		if (v->next == NULL)
-			ss_rbremove(&i->i, &v->node);
+			ss_rbremove(&p->i, &v->node);
 		else
-			ss_rbreplace(&i->i, &v->node, &v->next->node);
+			ss_rbreplace(&p->i, &v->node, &v->next->node);
 	}
 	sx_vunlink(v);
 }
@@ -169,18 +259,24 @@ sx_csn(sxmanager *m)
 	uint64_t csn = UINT64_MAX;
 	if (m->count_rw == 0)
 		return csn;
-	ssrbnode *p = ss_rbmin(&m->i);
-	sx *min = NULL;
-	while (p) {
-		min = sscast(p, sx, node);
-		if (min->type == SX_RO) {
-			p = ss_rbnext(&m->i, p);
-			continue;
+	int i = 0;
+	while (i < SX_SLOTS) {
+		sxslot *s = &m->slots[i];
+		ss_spinlock(&s->lock);
+		ssrbnode *p = ss_rbmin(&s->i);
+		while (p) {
+			sx *x = sscast(p, sx, node);
+			if (x->type == SX_RW) {
+				if (x->csn < csn)
+					csn = x->csn;
+				break;
+			}
+			p = ss_rbnext(&s->i, p);
 		}
-		break;
+		ss_spinunlock(&s->lock);
+		i++;
 	}
-	assert(min != NULL);
-	return min->csn;
+	return csn;
 }
 
 static inline void
@@ -203,8 +299,11 @@ sx_garbage_collect(sxmanager *m)
 			count++;
 			continue;
 		}
+		sxindexpart *p = v->part;
+		ss_spinlock(&p->lock);
 		sx_untrack(v);
-		sx_vfree(&m->pool, i->r, v);
+		sx_vfree(&p->pool, i->r, v);
+		ss_spinunlock(&p->lock);
 	}
 	m->count_gc = count;
 	m->gc = gc;
@@ -224,33 +323,40 @@ static inline void
 sx_end(sx *x)
 {
 	sxmanager *m = x->manager;
-	ss_spinlock(&m->lock);
-	ss_rbremove(&m->i, &x->node);
+	sxslot *s = x->slot;
+	ss_spinlock(&s->lock);
+	ss_rbremove(&s->i, &x->node);
+	ss_rbremove(&s->iv, &x->node_view);
+	if (x->vlsn == s->vlsn)
+		sx_slotvlsn(s);
+	ss_spinunlock(&s->lock);
 	if (x->type == SX_RO)
-		m->count_rd--;
+		__sync_fetch_and_sub(&m->count_rd, 1);
 	else
-		m->count_rw--;
-	ss_spinunlock(&m->lock);
+		__sync_fetch_and_sub(&m->count_rw, 1);
 }
 
 static inline void
 sx_rollback_svp(sx *x, ssiter *i, int free)
 {
-	sxmanager *m = x->manager;
 	for (; ss_iterhas(ss_bufiter, i); ss_iternext(ss_bufiter, i))
 	{
 		svlogv *lv = ss_iterof(ss_bufiter, i);
 		sxv *v = lv->ptr;
+		sxindexpart *p = v->part;
 		/* remove from index and replace head with
 		 * a first waiter */
+		ss_spinlock(&p->lock);
 		sx_untrack(v);
 		lv->ptr = NULL;
 		if (free) {
 			sxindex *i = v->index;
 			sv_vunref(i->r, v->v);
 		}
-		sx_vpool_push(&m->pool, v);
+		sx_vpool_push(&p->pool, v);
+		ss_spinunlock(&p->lock);
 	}
+	(void)x;
 }
 
 sxstate sx_rollback(sx *x)
@@ -280,6 +386,8 @@ sx_preparecb(sx *x, svlogv *v, uint64_t lsn, sxpreparef prepare, void *arg)
 
 sxstate sx_prepare(sx *x, sxpreparef prepare, void *arg)
 {
+	/* commits which are not visible yet are
+	 * checked too */
 	uint64_t lsn = sr_seq(x->manager->seq, SR_LSN);
 	/* proceed read-only transactions */
 	if (x->type == SX_RO || sv_logcount_write(x->log) == 0)
@@ -294,28 +402,35 @@ sxstate sx_prepare(sx *x, sxpreparef prepare, void *arg)
 		sxv *v = lv->ptr;
 		if ((int)v->lo == x->log_read)
 			break;
+		/* decide under the partition lock, the prepare
+		 * callback is called without it */
+		sxindexpart *p = v->part;
+		ss_spinlock(&p->lock);
 		if (sx_vaborted(v))
-			return sx_promote(x, SX_ROLLBACK);
-		if (sslikely(v->prev == NULL)) {
-			rc = sx_preparecb(x, lv, lsn, prepare, arg);
-			if (ssunlikely(rc != 0))
-				return sx_promote(x, SX_ROLLBACK);
-			continue;
-		}
-		if (sx_vcommitted(v->prev)) {
-			if (v->prev->csn > x->csn)
-				return sx_promote(x, SX_ROLLBACK);
-			continue;
-		}
+			rc = SX_ROLLBACK;
+		else
+		if (sslikely(v->prev == NULL))
+			rc = SX_PREPARE;
+		else
+		if (sx_vcommitted(v->prev))
+			rc = (v->prev->csn > x->csn) ? SX_ROLLBACK : SX_COMMIT;
+		else
 		/* force commit for read-only conflicts */
-		sxindex *i = v->prev->index;
-		if (sv_vflags(v->prev->v, i->r) & SVGET) {
-			rc = sx_preparecb(x, lv, lsn, prepare, arg);
-			if (ssunlikely(rc != 0))
+		if (sv_vflags(v->prev->v, ((sxindex*)v->prev->index)->r) & SVGET)
+			rc = SX_PREPARE;
+		else
+			rc = SX_LOCK;
+		ss_spinunlock(&p->lock);
+		switch (rc) {
+		case SX_PREPARE:
+			if (ssunlikely(sx_preparecb(x, lv, lsn, prepare, arg) != 0))
 				return sx_promote(x, SX_ROLLBACK);
-			continue;
+			break;
+		case SX_COMMIT:
+			break;
+		default:
+			return sx_promote(x, rc);
 		}
-		return sx_promote(x, SX_LOCK);
 	}
 	return sx_promote(x, SX_PREPARE);
 }
@@ -336,6 +451,8 @@ sxstate sx_commit(sx *x)
 		sxv *v = lv->ptr;
 		if ((int)v->lo == x->log_read)
 			break;
+		sxindexpart *p = v->part;
+		ss_spinlock(&p->lock);
 		/* abort conflict reader */
 		if (v->prev && !sx_vcommitted(v->prev)) {
 			sxindex *i = v->prev->index;
@@ -356,8 +473,9 @@ sxstate sx_commit(sx *x)
 			m->count_gc++;
 		} else {
 			sx_untrack(v);
-			sx_vpool_push(&m->pool, v);
+			sx_vpool_push(&p->pool, v);
 		}
+		ss_spinunlock(&p->lock);
 	}
 
 	/* rollback latest reads */
@@ -371,9 +489,9 @@ sxstate sx_commit(sx *x)
 ss_rbget(sx_match,
          sf_compare(scheme, sv_vpointer((sscast(n, sxv, node))->v), key))
 
-int sx_set(sx *x, sxindex *index, svv *version)
+static inline int
+sx_setof(sx *x, sxindex *index, sxindexpart *p, svv *version)
 {
-	sxmanager *m = x->manager;
 	sr *r = index->r;
 
 	svlogv lv;
@@ -383,13 +501,14 @@ int sx_set(sx *x, sxindex *index, svv *version)
 	lv.ptr      = NULL;
 
 	/* allocate mvcc container */
-	sxv *v = sx_valloc(&m->pool, version);
+	sxv *v = sx_valloc(&p->pool, version);
 	if (ssunlikely(v == NULL)) {
 		sv_vunref(r, version);
 		return -1;
 	}
 	v->id    = x->id;
 	v->index = index;
+	v->part  = p;
 	lv.ptr   = v;
 
 	if (! (sv_vflags(version, index->r) & SVGET))
@@ -398,7 +517,7 @@ int sx_set(sx *x, sxindex *index, svv *version)
 	/* update concurrent index */
 	ssrbnode *n = NULL;
 	int rc;
-	rc = sx_match(&index->i, index->r->scheme,
+	rc = sx_match(&p->i, index->r->scheme,
 	              sv_vpointer(version), 0, &n);
 	if (ssunlikely(rc == 0 && n)) {
 		/* exists */
@@ -411,7 +530,7 @@ int sx_set(sx *x, sxindex *index, svv *version)
 			sr_oom(r->e);
 			goto error;
 		}
-		ss_rbset(&index->i, n, pos, &v->node);
+		ss_rbset(&p->i, n, pos, &v->node);
 		return 0;
 	}
 	sxv *head = sscast(n, sxv, node);
@@ -432,11 +551,11 @@ int sx_set(sx *x, sxindex *index, svv *version)
 			sx_vabort(v);
 		sx_vreplace(own, v);
 		if (sslikely(head == own))
-			ss_rbreplace(&index->i, &own->node, &v->node);
+			ss_rbreplace(&p->i, &own->node, &v->node);
 		/* update log */
 		sv_logreplace(x->log, r, v->lo, &lv);
 
-		sx_vfree(&m->pool, r, own);
+		sx_vfree(&p->pool, r, own);
 		return 0;
 	}
 	/* update log */
@@ -450,15 +569,26 @@ int sx_set(sx *x, sxindex *index, svv *version)
 	sx_vlink(head, v);
 	return 0;
 error:
-	sx_vfree(&m->pool, r, v);
+	sx_vfree(&p->pool, r, v);
 	return -1;
 }
 
+int sx_set(sx *x, sxindex *index, svv *version)
+{
+	sxindexpart *p = sx_indexpart(index, sv_vpointer(version));
+	ss_spinlock(&p->lock);
+	int rc = sx_setof(x, index, p, version);
+	ss_spinunlock(&p->lock);
+	return rc;
+}
+
 int sx_get(sx *x, sxindex *index, svv *key, svv **result)
 {
+	sxindexpart *p = sx_indexpart(index, sv_vpointer(key));
+	ss_spinlock(&p->lock);
 	ssrbnode *n = NULL;
 	int rc;
-	rc = sx_match(&index->i, index->r->scheme,
+	rc = sx_match(&p->i, index->r->scheme,
 	              sv_vpointer(key), 0, &n);
 	if (! (rc == 0 && n))
 		goto add;
@@ -466,10 +596,14 @@ int sx_get(sx *x, sxindex *index, svv *key, svv **result)
 	sxv *v = sx_vmatch(head, x->id);
 	if (v == NULL)
 		goto add;
-	if (ssunlikely(sv_vflags(v->v, index->r) & SVGET))
-		return 0;
-	if (ssunlikely(sv_vflags(v->v, index->r) & SVDELETE))
-		return 2;
+	if (ssunlikely(sv_vflags(v->v, index->r) & SVGET)) {
+		rc = 0;
+		goto done;
+	}
+	if (ssunlikely(sv_vflags(v->v, index->r) & SVDELETE)) {
+		rc = 2;
+		goto done;
+	}
 	*result = sv_vbuildraw(index->r, sv_vpointer(v->v));
 	if (ssunlikely(*result == NULL)) {
 		sr_oom(index->r->e);
@@ -477,18 +611,19 @@ int sx_get(sx *x, sxindex *index, svv *key, svv **result)
 	} else {
 		rc = 1;
 	}
-	return rc;
+	goto done;
 
 add:
 	/* track a start of the latest read sequence in the
 	 * transactional log */
 	if (x->log_read == -1)
 		x->log_read = sv_logcount(x->log);
-	rc = sx_set(x, index, key);
-	if (ssunlikely(rc == -1))
-		return -1;
-	sv_vref(key);
-	return 0;
+	rc = sx_setof(x, index, p, key);
+	if (sslikely(rc == 0))
+		sv_vref(key);
+done:
+	ss_spinunlock(&p->lock);
+	return rc;
 }
 
 sxstate sx_set_autocommit(sxmanager *m, sxindex *index, sx *x, svlog *log, svv *v)
@@ -529,7 +664,9 @@ sxstate sx_set_autocommit(sxmanager *m, sxindex *index, sx *x, svlog *log, svv *
 
 sxstate sx_get_autocommit(sxmanager *m, sxindex *index)
 {
+	/* autocommit reads are not tracked and do not
+	 * need a transaction id */
 	(void)m;
-	sr_seq(index->r->seq, SR_TSNNEXT);
+	(void)index;
 	return SX_COMMIT;
 }
@@ -11,6 +11,7 @@
 
 typedef struct sxmanager sxmanager;
 typedef struct sxindex sxindex;
+typedef struct sxslot sxslot;
 typedef struct sx sx;
 
 typedef enum {
@@ -27,8 +28,19 @@ typedef enum {
 	SX_RW
 } sxtype;
 
+/* concurrent index is partitioned by key hash, each
+ * partition is protected by its own lock */
+
+#define SX_INDEX_PARTS 16
+
+typedef struct {
+	ssspinlock lock;
+	ssrb       i;
+	sxvpool    pool;
+} sxindexpart;
+
 struct sxindex {
-	ssrb      i;
+	sxindexpart part[SX_INDEX_PARTS];
 	uint32_t  dsn;
 	so       *object;
 	sr       *r;
@@ -47,22 +59,72 @@ struct sx {
 	svlog     *log;
 	sslist     deadlock;
 	ssrbnode   node;
+	ssrbnode   node_view;
+	sxslot    *slot;
 	sxmanager *manager;
 };
 
+/* active transactions are registered in a slot of
+ * the calling thread. Each slot publishes the oldest
+ * view of its transactions, so the visibility horizon
+ * can be read without locking.
+ *
+ * Slot number is encoded in the low bits of a
+ * transaction id, views are kept ordered by
+ * (vlsn, id). */
+
+#define SX_SLOTS 16
+
+struct sxslot {
+	ssspinlock lock;
+	ssrb       i;
+	ssrb       iv;
+	uint64_t   vlsn;
+	char       pad[32];
+};
+
 struct sxmanager {
-	ssspinlock  lock;
+	ssmutex     lock_tx;
+	ssmutex     lock_commit;
 	sslist      indexes;
-	ssrb        i;
+	sxslot      slots[SX_SLOTS];
 	uint32_t    count_rd;
 	uint32_t    count_rw;
 	uint32_t    count_gc;
 	uint64_t    csn;
 	sxv        *gc;
-	sxvpool     pool;
+	ssa        *a;
 	srseq      *seq;
 };
 
+/* lock_tx serializes transaction completion and
+ * protects the gc list. Statements are added to the
+ * concurrent index under a partition lock only, which is
+ * also taken by lock_tx holders for every statement they
+ * touch. lock_commit orders transaction commits: it is
+ * taken before lock_tx and held until the commit gets
+ * its lsn, wal and index writes run without it. */
+
+static inline void
+sx_lock(sxmanager *m) {
+	ss_mutexlock(&m->lock_tx);
+}
+
+static inline void
+sx_unlock(sxmanager *m) {
+	ss_mutexunlock(&m->lock_tx);
+}
+
+static inline void
+sx_commitlock(sxmanager *m) {
+	ss_mutexlock(&m->lock_commit);
+}
+
+static inline void
+sx_commitunlock(sxmanager *m) {
+	ss_mutexunlock(&m->lock_commit);
+}
+
 int       sx_managerinit(sxmanager*, srseq*, ssa*);
 int       sx_managerfree(sxmanager*);
 int       sx_indexinit(sxindex*, sxmanager*, sr*, so*);
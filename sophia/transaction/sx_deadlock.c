@@ -14,6 +14,34 @@
 #include <libso.h>
 #include <libsx.h>
 
+static inline void
+sx_indexlock(sxmanager *m)
+{
+	sslist *i;
+	ss_listforeach(&m->indexes, i) {
+		sxindex *index = sscast(i, sxindex, link);
+		int k = 0;
+		while (k < SX_INDEX_PARTS) {
+			ss_spinlock(&index->part[k].lock);
+			k++;
+		}
+	}
+}
+
+static inline void
+sx_indexunlock(sxmanager *m)
+{
+	sslist *i;
+	ss_listforeach(&m->indexes, i) {
+		sxindex *index = sscast(i, sxindex, link);
+		int k = 0;
+		while (k < SX_INDEX_PARTS) {
+			ss_spinunlock(&index->part[k].lock);
+			k++;
+		}
+	}
+}
+
 static inline int
 sx_deadlock_in(sxmanager *m, sslist *mark, sx *t, sx *p)
 {
@@ -58,6 +86,9 @@ int sx_deadlock(sx *t)
 	sxmanager *m = t->manager;
 	sslist mark;
 	ss_listinit(&mark);
+	/* stop concurrent statements while the wait-for
+	 * graph is being traversed */
+	sx_indexlock(m);
 	ssiter i;
 	ss_iterinit(ss_bufiter, &i);
 	ss_iteropen(ss_bufiter, &i, &t->log->buf, sizeof(svlogv));
@@ -74,10 +105,12 @@ int sx_deadlock(sx *t)
 		int rc = sx_deadlock_in(m, &mark, t, p);
 		if (ssunlikely(rc)) {
 			sx_deadlock_unmark(&mark);
+			sx_indexunlock(m);
 			return 1;
 		}
 		ss_iternext(ss_bufiter, &i);
 	}
 	sx_deadlock_unmark(&mark);
+	sx_indexunlock(m);
 	return 0;
 }
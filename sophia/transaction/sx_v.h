@@ -18,6 +18,7 @@ struct sxv {
 	uint64_t  csn;
 	uint8_t   conflict;
 	void     *index;
+	void     *part;
 	svv      *v;
 	sxv      *next;
 	sxv      *prev;
@@ -82,6 +83,7 @@ sx_valloc(sxvpool *p, svv *ref)
 			return NULL;
 	}
 	v->index    = NULL;
+	v->part     = NULL;
 	v->id       = 0;
 	v->lo       = 0;
 	v->csn      = 0;
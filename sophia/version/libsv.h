@@ -16,6 +16,7 @@
 #include <sv_mergeiter.h>
 #include <sv_readiter.h>
 #include <sv_writeiter.h>
+#include <sv_btree.h>
 #include <sv_index.h>
 #include <sv_indexiter.h>
 
@@ -0,0 +1,302 @@
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <libss.h>
+#include <libsf.h>
+#include <libsr.h>
+#include <libsv.h>
+
+static inline svbtreenode*
+sv_btreenode(sr *r, svbtreepool *p, int leaf)
+{
+	/* take a reserved node first */
+	svbtreenode *n = NULL;
+	if (p) {
+		ss_spinlock(&p->lock);
+		n = p->free;
+		if (n) {
+			p->free = n->next;
+			p->count--;
+		}
+		ss_spinunlock(&p->lock);
+	}
+	if (n == NULL) {
+		n = ss_malloc(r->a, sizeof(svbtreenode));
+		if (ssunlikely(n == NULL))
+			return NULL;
+	}
+	n->parent = NULL;
+	n->prev   = NULL;
+	n->next   = NULL;
+	n->count  = 0;
+	n->leaf   = leaf;
+	return n;
+}
+
+static inline void
+sv_btreeheight(svbtree *t, svbtreepool *p)
+{
+	if (p == NULL)
+		return;
+	ss_spinlock(&p->lock);
+	if (t->height > p->height)
+		p->height = t->height;
+	ss_spinunlock(&p->lock);
+}
+
+static inline void
+sv_btreeput(svbtreenode *n, int pos, uint64_t key, svv *v,
+            svbtreenode *child)
+{
+	int move = n->count - pos;
+	if (move > 0) {
+		memmove(&n->key[pos + 1], &n->key[pos], move * sizeof(uint64_t));
+		memmove(&n->v[pos + 1], &n->v[pos], move * sizeof(svv*));
+		if (! n->leaf)
+			memmove(&n->child[pos + 1], &n->child[pos],
+			        move * sizeof(svbtreenode*));
+	}
+	n->key[pos] = key;
+	n->v[pos]   = v;
+	if (! n->leaf) {
+		n->child[pos] = child;
+		child->parent = n;
+	}
+	n->count++;
+}
+
+static inline void
+sv_btreesplit(svbtree *t, svbtreenode *n, svbtreenode *right)
+{
+	/* move upper half of the node to the right sibling,
+	 * separators are kept in both halves */
+	int half = n->count / 2;
+	int move = n->count - half;
+	right->leaf   = n->leaf;
+	right->parent = n->parent;
+	memcpy(right->key, &n->key[half], move * sizeof(uint64_t));
+	memcpy(right->v, &n->v[half], move * sizeof(svv*));
+	if (! n->leaf) {
+		memcpy(right->child, &n->child[half], move * sizeof(svbtreenode*));
+		int i = 0;
+		while (i < move) {
+			right->child[i]->parent = right;
+			i++;
+		}
+	}
+	right->count = move;
+	n->count = half;
+	if (n->leaf) {
+		right->prev = n;
+		right->next = n->next;
+		if (n->next)
+			n->next->prev = right;
+		else
+			t->max = right;
+		n->next = right;
+	}
+}
+
+static inline int
+sv_btreechild(svbtreenode *parent, svbtreenode *n)
+{
+	int pos = 0;
+	while (parent->child[pos] != n)
+		pos++;
+	return pos;
+}
+
+int sv_btreeinsert(svbtree *t, sr *r, svbtreepool *pool,
+                   svbtreepos *p, svv *v)
+{
+	sfsearch s;
+	sf_searchinit(&s, r->scheme, sv_vpointer(v));
+	uint64_t key = s.value;
+
+	/* first element */
+	if (ssunlikely(t->root == NULL)) {
+		svbtreenode *n = sv_btreenode(r, pool, 1);
+		if (ssunlikely(n == NULL))
+			return -1;
+		sv_btreeput(n, 0, key, v, NULL);
+		t->root   = n;
+		t->min    = n;
+		t->max    = n;
+		t->height = 1;
+		sv_btreeheight(t, pool);
+		return 0;
+	}
+
+	/* preallocate every node required for the split,
+	 * so the tree is never left half-updated on oom */
+	svbtreenode *split[SV_BTREE_DEPTH + 1];
+	int needed = 0;
+	svbtreenode *n = p->node;
+	while (n && n->count == SV_BTREE_FANOUT) {
+		needed++;
+		n = n->parent;
+	}
+	if (n == NULL)
+		needed++;
+	assert(needed <= SV_BTREE_DEPTH);
+	int i = 0;
+	while (i < needed) {
+		split[i] = sv_btreenode(r, pool, 0);
+		if (ssunlikely(split[i] == NULL)) {
+			while (i-- > 0)
+				ss_free(r->a, split[i]);
+			return -1;
+		}
+		i++;
+	}
+
+	/* insert, splitting full nodes bottom-up */
+	int used = 0;
+	int pos = p->pos;
+	svbtreenode *child = NULL;
+	n = p->node;
+	for (;;) {
+		if (n->count < SV_BTREE_FANOUT) {
+			sv_btreeput(n, pos, key, v, child);
+			break;
+		}
+		svbtreenode *right = split[used++];
+		sv_btreesplit(t, n, right);
+		if (pos <= (int)n->count)
+			sv_btreeput(n, pos, key, v, child);
+		else
+			sv_btreeput(right, pos - n->count, key, v, child);
+		/* push the right separator up */
+		key   = right->key[0];
+		v     = right->v[0];
+		child = right;
+		svbtreenode *parent = n->parent;
+		if (parent == NULL) {
+			parent = split[used++];
+			sv_btreeput(parent, 0, n->key[0], n->v[0], n);
+			t->root = parent;
+			t->height++;
+			sv_btreeheight(t, pool);
+		}
+		pos = sv_btreechild(parent, n) + 1;
+		n = parent;
+	}
+	assert(used == needed);
+	return 0;
+}
+
+static void
+sv_btreefree_node(svbtreenode *n, sr *r, svbtreegcf gc)
+{
+	uint32_t i = 0;
+	while (i < n->count) {
+		if (! n->leaf)
+			sv_btreefree_node(n->child[i], r, gc);
+		else
+		if (gc)
+			gc(r, n->v[i]);
+		i++;
+	}
+	ss_free(r->a, n);
+}
+
+void sv_btreefree(svbtree *t, sr *r, svbtreegcf gc)
+{
+	if (t->root)
+		sv_btreefree_node(t->root, r, gc);
+	sv_btreeinit(t);
+}
+
+void sv_btreepool_init(svbtreepool *p)
+{
+	ss_spinlockinit(&p->lock);
+	p->free     = NULL;
+	p->count    = 0;
+	p->reserved = 0;
+	p->height   = 0;
+}
+
+static inline void
+sv_btreepool_freelist(svbtreenode *n, sr *r)
+{
+	while (n) {
+		svbtreenode *next = n->next;
+		ss_free(r->a, n);
+		n = next;
+	}
+}
+
+void sv_btreepool_free(svbtreepool *p, sr *r)
+{
+	assert(p->reserved == 0);
+	sv_btreepool_freelist(p->free, r);
+	p->free  = NULL;
+	p->count = 0;
+	ss_spinlockfree(&p->lock);
+}
+
+int sv_btreereserve(svbtreepool *p, sr *r, uint32_t count,
+                    uint32_t *reserved)
+{
+	/* an insert splits at most every node on its path
+	 * and adds a root, one more level covers concurrent
+	 * growth of the tree */
+	ss_spinlock(&p->lock);
+	uint32_t n = count * (p->height + 2);
+	p->reserved += n;
+	while (p->count < p->reserved) {
+		uint32_t need = p->reserved - p->count;
+		ss_spinunlock(&p->lock);
+		svbtreenode *list = NULL;
+		uint32_t allocated = 0;
+		while (allocated < need) {
+			svbtreenode *node = ss_malloc(r->a, sizeof(svbtreenode));
+			if (ssunlikely(node == NULL)) {
+				sv_btreepool_freelist(list, r);
+				ss_spinlock(&p->lock);
+				p->reserved -= n;
+				ss_spinunlock(&p->lock);
+				*reserved = 0;
+				return -1;
+			}
+			node->next = list;
+			list = node;
+			allocated++;
+		}
+		ss_spinlock(&p->lock);
+		while (list) {
+			svbtreenode *next = list->next;
+			list->next = p->free;
+			p->free = list;
+			p->count++;
+			list = next;
+		}
+	}
+	ss_spinunlock(&p->lock);
+	*reserved = n;
+	return 0;
+}
+
+void sv_btreerelease(svbtreepool *p, sr *r, uint32_t reserved)
+{
+	/* keep nodes of other writers and a few spare,
+	 * free the rest */
+	svbtreenode *list = NULL;
+	ss_spinlock(&p->lock);
+	p->reserved -= reserved;
+	while (p->count > p->reserved + SV_BTREE_SPARE) {
+		svbtreenode *n = p->free;
+		p->free = n->next;
+		p->count--;
+		n->next = list;
+		list = n;
+	}
+	ss_spinunlock(&p->lock);
+	sv_btreepool_freelist(list, r);
+}
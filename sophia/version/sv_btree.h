@@ -0,0 +1,198 @@
+#ifndef SV_BTREE_H_
+#define SV_BTREE_H_
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+/* in-memory b+tree of version chains.
+ *
+ * Nodes are wide and keep the normalized first key part
+ * of every element inline (see sf_search.h), a descent
+ * is mostly integer compares inside a few cache lines and
+ * sf_compare() is used only to resolve ties. Leaves are
+ * linked for ordered iteration. Elements are never removed.
+*/
+
+#define SV_BTREE_FANOUT 32
+#define SV_BTREE_DEPTH  16
+#define SV_BTREE_SPARE  64
+
+typedef struct svbtreenode svbtreenode;
+typedef struct svbtreepos svbtreepos;
+typedef struct svbtree svbtree;
+typedef struct svbtreepool svbtreepool;
+
+typedef void (*svbtreegcf)(sr*, svv*);
+
+struct svbtreenode {
+	uint64_t     key[SV_BTREE_FANOUT];
+	svv         *v[SV_BTREE_FANOUT];
+	svbtreenode *child[SV_BTREE_FANOUT];
+	svbtreenode *parent;
+	svbtreenode *prev, *next;
+	uint32_t     count;
+	uint32_t     leaf;
+};
+
+struct svbtreepos {
+	svbtreenode *node;
+	int          pos;
+};
+
+struct svbtree {
+	svbtreenode *root;
+	svbtreenode *min;
+	svbtreenode *max;
+	uint32_t     height;
+} sspacked;
+
+/* free nodes reserved by writers before they may
+ * insert, shared by the trees of one index */
+
+struct svbtreepool {
+	ssspinlock   lock;
+	svbtreenode *free;
+	uint32_t     count;
+	uint32_t     reserved;
+	uint32_t     height;
+};
+
+static inline void
+sv_btreeinit(svbtree *t)
+{
+	t->root   = NULL;
+	t->min    = NULL;
+	t->max    = NULL;
+	t->height = 0;
+}
+
+static inline int
+sv_btreelower(svbtreenode *n, sfsearch *s, int from, int *found)
+{
+	/* first position >= key, normalized keys narrow the
+	 * range of positions which need a full compare */
+	int lo = from;
+	int hi = n->count;
+	*found = 0;
+	if (sslikely(s->normalized)) {
+		int less = 0;
+		int lessequal = 0;
+		int j = from;
+		while (j < (int)n->count) {
+			less += n->key[j] < s->value;
+			lessequal += n->key[j] <= s->value;
+			j++;
+		}
+		lo = from + less;
+		hi = from + lessequal;
+		if (s->exact) {
+			*found = lo < hi;
+			return lo;
+		}
+	}
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		int rc = sf_compare(s->scheme, sv_vpointer(n->v[mid]), s->key);
+		if (rc < 0) {
+			lo = mid + 1;
+		} else {
+			if (rc == 0)
+				*found = 1;
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static inline int
+sv_btreesearch(svbtree *t, sfsearch *s, svbtreepos *p)
+{
+	/* position leaf to the first element >= key,
+	 * returns 0 on match */
+	p->node = NULL;
+	p->pos  = 0;
+	svbtreenode *n = t->root;
+	if (ssunlikely(n == NULL))
+		return 1;
+	int found;
+	int pos;
+	while (! n->leaf) {
+		/* last child with separator <= key, the first
+		 * separator is never compared */
+		pos = sv_btreelower(n, s, 1, &found);
+		if (! found)
+			pos--;
+		n = n->child[pos];
+	}
+	pos = sv_btreelower(n, s, 0, &found);
+	p->node = n;
+	p->pos  = pos;
+	return (found) ? 0 : 1;
+}
+
+static inline svv*
+sv_btreeof(svbtreepos *p)
+{
+	if (ssunlikely(p->node == NULL))
+		return NULL;
+	return p->node->v[p->pos];
+}
+
+static inline void
+sv_btreeforward(svbtreepos *p)
+{
+	/* skip end of leaf */
+	while (p->node && p->pos >= (int)p->node->count) {
+		p->node = p->node->next;
+		p->pos  = 0;
+	}
+}
+
+static inline void
+sv_btreemin(svbtree *t, svbtreepos *p)
+{
+	p->node = t->min;
+	p->pos  = 0;
+	sv_btreeforward(p);
+}
+
+static inline void
+sv_btreemax(svbtree *t, svbtreepos *p)
+{
+	p->node = t->max;
+	p->pos  = 0;
+	if (p->node)
+		p->pos = p->node->count - 1;
+}
+
+static inline void
+sv_btreenext(svbtreepos *p)
+{
+	p->pos++;
+	sv_btreeforward(p);
+}
+
+static inline void
+sv_btreeprev(svbtreepos *p)
+{
+	p->pos--;
+	while (p->node && p->pos < 0) {
+		p->node = p->node->prev;
+		if (p->node)
+			p->pos = p->node->count - 1;
+	}
+}
+
+int  sv_btreeinsert(svbtree*, sr*, svbtreepool*, svbtreepos*, svv*);
+void sv_btreefree(svbtree*, sr*, svbtreegcf);
+void sv_btreepool_init(svbtreepool*);
+void sv_btreepool_free(svbtreepool*, sr*);
+int  sv_btreereserve(svbtreepool*, sr*, uint32_t, uint32_t*);
+void sv_btreerelease(svbtreepool*, sr*, uint32_t);
+
+#endif
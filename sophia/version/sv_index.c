@@ -16,23 +16,37 @@
 ss_rbtruncate(sv_indextruncate,
               sv_vfree((sr*)arg, sscast(n, svv, node)))
 
-int sv_indexinit(svindex *i)
+int sv_indexinit(svindex *i, int type)
 {
+	i->type   = type;
 	i->lsnmin = UINT64_MAX;
 	i->count  = 0;
 	i->used   = 0;
 	ss_rbinit(&i->i);
+	sv_btreeinit(&i->bt);
 	return 0;
 }
 
 int sv_indexfree(svindex *i, sr *r)
 {
+	if (i->type == SV_INDEXBTREE) {
+		sv_btreefree(&i->bt, r, sv_vfree);
+		return 0;
+	}
 	if (i->i.root)
 		sv_indextruncate(i->i.root, r);
 	ss_rbinit(&i->i);
 	return 0;
 }
 
+int sv_indexreset(svindex *i, sr *r)
+{
+	/* release index structure, versions are kept */
+	if (i->type == SV_INDEXBTREE)
+		sv_btreefree(&i->bt, r, NULL);
+	return sv_indexinit(i, i->type);
+}
+
 static inline svv*
 sv_vset(svv *head, svv *v, sr *r)
 {
@@ -64,6 +78,14 @@ sv_vset(svv *head, svv *v, sr *r)
 svv*
 sv_indexget(svindex *i, sr *r, svindexpos *p, svv *v)
 {
+	if (i->type == SV_INDEXBTREE) {
+		sfsearch s;
+		sf_searchinit(&s, r->scheme, sv_vpointer(v));
+		p->rc = sv_btreesearch(&i->bt, &s, &p->bt);
+		if (p->rc == 0)
+			return sv_btreeof(&p->bt);
+		return NULL;
+	}
 	p->rc = sv_indexmatch(&i->i, r->scheme, sv_vpointer(v), 0,
 	                      &p->node);
 	if (p->rc == 0 && p->node)
@@ -71,8 +93,31 @@ sv_indexget(svindex *i, sr *r, svindexpos *p, svv *v)
 	return NULL;
 }
 
-int sv_indexupdate(svindex *i, sr *r, svindexpos *p, svv *v)
+static inline int
+sv_indexupdate_btree(svindex *i, sr *r, svbtreepool *pool,
+                     svindexpos *p, svv *v)
+{
+	if (p->rc == 0) {
+		svv *head = sv_btreeof(&p->bt);
+		svv *update = sv_vset(head, v, r);
+		if (head != update)
+			p->bt.node->v[p->bt.pos] = update;
+		return 0;
+	}
+	int rc = sv_btreeinsert(&i->bt, r, pool, &p->bt, v);
+	if (ssunlikely(rc == -1))
+		return sr_oom_malfunction(r->e);
+	return 0;
+}
+
+int sv_indexupdate(svindex *i, sr *r, svbtreepool *pool,
+                   svindexpos *p, svv *v)
 {
+	if (i->type == SV_INDEXBTREE) {
+		int rc = sv_indexupdate_btree(i, r, pool, p, v);
+		if (ssunlikely(rc == -1))
+			return -1;
+	} else
 	if (p->rc == 0 && p->node) {
 		svv *head = sscast(p->node, svv, node);
 		svv *update = sv_vset(head, v, r);
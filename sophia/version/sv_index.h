@@ -12,13 +12,19 @@
 typedef struct svindexpos svindexpos;
 typedef struct svindex svindex;
 
+#define SV_INDEXRB    0
+#define SV_INDEXBTREE 1
+
 struct svindexpos {
 	ssrbnode *node;
+	svbtreepos bt;
 	int rc;
 };
 
 struct svindex {
 	ssrb i;
+	svbtree bt;
+	uint32_t type;
 	uint32_t count;
 	uint32_t used;
 	uint64_t lsnmin;
@@ -27,17 +33,28 @@ struct svindex {
 ss_rbget(sv_indexmatch,
          sf_compare(scheme, sv_vpointer(sscast(n, svv, node)), key))
 
-int  sv_indexinit(svindex*);
+int  sv_indexinit(svindex*, int);
 int  sv_indexfree(svindex*, sr*);
-int  sv_indexupdate(svindex*, sr*, svindexpos*, svv*);
+int  sv_indexreset(svindex*, sr*);
+int  sv_indexupdate(svindex*, sr*, svbtreepool*, svindexpos*, svv*);
 svv *sv_indexget(svindex*, sr*, svindexpos*, svv*);
 
+static inline int
+sv_indextype(char *name)
+{
+	if (strcmp(name, "rbtree") == 0)
+		return SV_INDEXRB;
+	if (strcmp(name, "btree") == 0)
+		return SV_INDEXBTREE;
+	return -1;
+}
+
 static inline int
 sv_indexset(svindex *i, sr *r, svv *v)
 {
 	svindexpos pos;
 	sv_indexget(i, r, &pos, v);
-	sv_indexupdate(i, r, &pos, v);
+	sv_indexupdate(i, r, NULL, &pos, v);
 	return 0;
 }
 
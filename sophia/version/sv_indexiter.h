@@ -11,12 +11,61 @@
 
 typedef struct svindexiter svindexiter;
 
+/* not packed, btree position is
+ * updated by reference */
 struct svindexiter {
-	svindex  *index;
-	ssrbnode *v;
-	svv      *vcur;
-	ssorder   order;
-} sspacked;
+	svindex   *index;
+	ssrbnode  *v;
+	svbtreepos bt;
+	svv       *vcur;
+	ssorder    order;
+};
+
+static inline int
+sv_indexiter_openbtree(svindexiter *ii, sr *r, char *key)
+{
+	svbtree *t = &ii->index->bt;
+	sfsearch s;
+	int rc;
+	int eq = 0;
+	switch (ii->order) {
+	case SS_LT:
+	case SS_LTE:
+		if (ssunlikely(key == NULL)) {
+			sv_btreemax(t, &ii->bt);
+			break;
+		}
+		sf_searchinit(&s, r->scheme, key);
+		rc = sv_btreesearch(t, &s, &ii->bt);
+		if (rc == 0) {
+			eq = 1;
+			if (ii->order == SS_LT)
+				sv_btreeprev(&ii->bt);
+			break;
+		}
+		sv_btreeprev(&ii->bt);
+		break;
+	case SS_GT:
+	case SS_GTE:
+		if (ssunlikely(key == NULL)) {
+			sv_btreemin(t, &ii->bt);
+			break;
+		}
+		sf_searchinit(&s, r->scheme, key);
+		rc = sv_btreesearch(t, &s, &ii->bt);
+		if (rc == 0) {
+			eq = 1;
+			if (ii->order == SS_GT)
+				sv_btreenext(&ii->bt);
+			break;
+		}
+		sv_btreeforward(&ii->bt);
+		break;
+	default: assert(0);
+	}
+	ii->vcur = sv_btreeof(&ii->bt);
+	return eq;
+}
 
 static inline int
 sv_indexiter_open(ssiter *i, sr *r, svindex *index, ssorder o, char *key)
@@ -26,6 +75,8 @@ sv_indexiter_open(ssiter *i, sr *r, svindex *index, ssorder o, char *key)
 	ii->order = o;
 	ii->v     = NULL;
 	ii->vcur  = NULL;
+	if (index->type == SV_INDEXBTREE)
+		return sv_indexiter_openbtree(ii, r, key);
 	int rc;
 	int eq = 0;
 	switch (ii->order) {
@@ -86,14 +137,14 @@ static inline int
 sv_indexiter_has(ssiter *i)
 {
 	svindexiter *ii = (svindexiter*)i->priv;
-	return ii->v != NULL;
+	return ii->vcur != NULL;
 }
 
 static inline void*
 sv_indexiter_of(ssiter *i)
 {
 	svindexiter *ii = (svindexiter*)i->priv;
-	if (ssunlikely(ii->v == NULL))
+	if (ssunlikely(ii->vcur == NULL))
 		return NULL;
 	return sv_vpointer(ii->vcur);
 }
@@ -102,14 +153,21 @@ static inline void
 sv_indexiter_next(ssiter *i)
 {
 	svindexiter *ii = (svindexiter*)i->priv;
-	if (ssunlikely(ii->v == NULL))
+	if (ssunlikely(ii->vcur == NULL))
 		return;
-	assert(ii->vcur != NULL);
 	svv *v = ii->vcur->next;
 	if (v) {
 		ii->vcur = v;
 		return;
 	}
+	if (ii->index->type == SV_INDEXBTREE) {
+		if (ii->order == SS_LT || ii->order == SS_LTE)
+			sv_btreeprev(&ii->bt);
+		else
+			sv_btreenext(&ii->bt);
+		ii->vcur = sv_btreeof(&ii->bt);
+		return;
+	}
 	switch (ii->order) {
 	case SS_LT:
 	case SS_LTE:
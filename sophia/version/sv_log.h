@@ -16,6 +16,7 @@ typedef struct svlog svlog;
 struct svlogindex {
 	uint32_t head, tail;
 	uint32_t count;
+	uint32_t reserve;
 	sr *r;
 } sspacked;
 
@@ -63,6 +64,7 @@ sv_loginit(svlog *l, sr *r, int index_max)
 		index->head = UINT32_MAX;
 		index->tail = 0;
 		index->count = 0;
+		index->reserve = 0;
 		index->r = NULL;
 		i++;
 	}
@@ -92,9 +94,10 @@ sv_logreset(svlog *l, int index_max)
 	while (i < index_max) {
 		svlogindex *index =
 			ss_bufat(&l->index, sizeof(svlogindex), i);
-		index->head  = UINT32_MAX;
-		index->tail  = 0;
-		index->count = 0;
+		index->head    = UINT32_MAX;
+		index->tail    = 0;
+		index->count   = 0;
+		index->reserve = 0;
 		i++;
 	}
 	ss_bufreset(&l->buf);
@@ -25,6 +25,7 @@ struct svmergeiter {
 	svmerge *merge;
 	svmergesrc *src, *end;
 	svmergesrc *v;
+	char *limit;
 	sr *r;
 } sspacked;
 
@@ -79,6 +80,9 @@ sv_mergeiter_gt(svmergeiter *i)
 	}
 	if (ssunlikely(min == NULL))
 		return;
+	/* stop at the upper bound of a key range */
+	if (ssunlikely(i->limit && sf_compare(i->r->scheme, minv, i->limit) >= 0))
+		return;
 	i->v = min;
 }
 
@@ -153,10 +157,34 @@ sv_mergeiter_open(ssiter *i, sr *r, svmerge *m, ssorder o)
 	im->src   = (svmergesrc*)(im->merge->buf.s);
 	im->end   = (svmergesrc*)(im->merge->buf.p);
 	im->v     = NULL;
+	im->limit = NULL;
 	sv_mergeiter_next(i);
 	return 0;
 }
 
+static inline void
+sv_mergeiter_setlimit(ssiter *i, char *key)
+{
+	svmergeiter *im = (svmergeiter*)i->priv;
+	assert(im->order == SS_GT || im->order == SS_GTE);
+	im->limit = key;
+	if (im->v == NULL)
+		return;
+	char *v = ss_iteratorof(im->v->i);
+	if (sf_compare(im->r->scheme, v, key) >= 0)
+		im->v = NULL;
+}
+
+static inline void
+sv_mergeiter_update(ssiter *i)
+{
+	/* sources were repositioned outside of the merge,
+	 * choose the current one again */
+	svmergeiter *im = (svmergeiter*)i->priv;
+	im->v = NULL;
+	sv_mergeiter_next(i);
+}
+
 static inline void
 sv_mergeiter_close(ssiter *i ssunused)
 { }
@@ -82,9 +82,11 @@ sv_readiter_next(ssiter *i)
 		if (ssunlikely(!im->save_delete && sf_is(im->r->scheme, v, SVDELETE)))
 			continue;
 		if (ssunlikely(sf_is(im->r->scheme, v, SVUPSERT))) {
+			uint64_t trace = sr_stattrace_begin(im->r->stat);
 			int rc = sv_readiter_upsert(im);
 			if (ssunlikely(rc == -1))
 				return;
+			sr_stattrace(im->r->stat, SR_PHASE_UPSERT, trace);
 			im->v = im->u->result;
 			im->next = 0;
 		} else {
@@ -12,7 +12,7 @@
 typedef struct svv svv;
 
 struct svv {
-	uint16_t refs;
+	uint32_t refs;
 	void    *log;
 	svv     *next;
 	ssrbnode node;
@@ -45,6 +45,11 @@ sv_vlsn(svv *v, sr *r) {
 	return sf_lsn(r->scheme, sv_vpointer(v));
 }
 
+static inline void
+sv_vstat(sr *r, int count, int64_t size) {
+	sr_statmemory(r->stat, count, size);
+}
+
 static inline svv*
 sv_vbuild(sr *r, sfv *fields)
 {
@@ -58,11 +63,7 @@ sv_vbuild(sr *r, sfv *fields)
 	memset(&v->node, 0, sizeof(v->node));
 	char *ptr = sv_vpointer(v);
 	sf_write(r->scheme, fields, ptr);
-	/* update runtime statistics */
-	ss_spinlock(&r->stat->lock);
-	r->stat->v_count++;
-	r->stat->v_allocated += sizeof(svv) + size;
-	ss_spinunlock(&r->stat->lock);
+	sv_vstat(r, 1, sizeof(svv) + size);
 	return v;
 }
 
@@ -78,31 +79,20 @@ sv_vbuildraw(sr *r, char *src)
 	v->next  = NULL;
 	memset(&v->node, 0, sizeof(v->node));
 	memcpy(sv_vpointer(v), src, size);
-	/* update runtime statistics */
-	ss_spinlock(&r->stat->lock);
-	r->stat->v_count++;
-	r->stat->v_allocated += sizeof(svv) + size;
-	ss_spinunlock(&r->stat->lock);
+	sv_vstat(r, 1, sizeof(svv) + size);
 	return v;
 }
 
 static inline void
 sv_vref(svv *v) {
-	v->refs++;
+	__sync_add_and_fetch(&v->refs, 1);
 }
 
 static inline int
 sv_vunref(sr *r, svv *v)
 {
-	if (sslikely(--v->refs == 0)) {
-		uint32_t size = sv_vsize(v, r);
-		/* update runtime statistics */
-		ss_spinlock(&r->stat->lock);
-		assert(r->stat->v_count > 0);
-		assert(r->stat->v_allocated >= size);
-		r->stat->v_count--;
-		r->stat->v_allocated -= size;
-		ss_spinunlock(&r->stat->lock);
+	if (sslikely(__sync_sub_and_fetch(&v->refs, 1) == 0)) {
+		sv_vstat(r, -1, -(int64_t)sv_vsize(v, r));
 		ss_free(r->av, v);
 		return 1;
 	}
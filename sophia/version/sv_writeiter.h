@@ -208,6 +208,18 @@ sv_writeiter_resume(ssiter *i)
 	return 1;
 }
 
+static inline void
+sv_writeiter_restart(ssiter *i)
+{
+	/* merge stream is positioned to a new key */
+	svwriteiter *im = (svwriteiter*)i->priv;
+	im->next    = 0;
+	im->upsert  = 0;
+	im->prevlsn = 0;
+	im->size    = 0;
+	sv_writeiter_next(i);
+}
+
 static inline int
 sv_writeiter_is_duplicate(ssiter *i)
 {
@@ -99,8 +99,14 @@ error:
 int sw_managerinit(swmanager *p, sr *r)
 {
 	ss_spinlockinit(&p->lock);
+	ss_mutexinit(&p->group_lock);
+	ss_condinit(&p->group_cond);
+	ss_listinit(&p->group);
 	ss_listinit(&p->list);
 	sw_confinit(&p->conf);
+	p->group_leader = 0;
+	p->writes  = 0;
+	p->commits = 0;
 	p->n    = 0;
 	p->r    = r;
 	p->gc   = 1;
@@ -249,6 +255,8 @@ int sw_managershutdown(swmanager *p)
 	if (p->iov.v)
 		ss_free(p->r->a, p->iov.v);
 	sw_conffree(&p->conf, p->r->a);
+	ss_condfree(&p->group_cond);
+	ss_mutexfree(&p->group_lock);
 	ss_spinlockfree(&p->lock);
 	return rcret;
 }
@@ -383,58 +391,41 @@ int sw_managercopy(swmanager *p, char *dest, ssbuf *buf)
 	return 0;
 }
 
-int sw_begin(swmanager *p, swtx *t, uint64_t lsn, int recover)
+int sw_begin(swmanager *p, swtx *t, svlog *vlog, uint64_t lsn, int recover)
 {
-	ss_spinlock(&p->lock);
+	int count = sv_logcount_write(vlog);
+	t->p       = p;
+	t->l       = NULL;
+	t->recover = recover;
+	t->queued  = p->conf.enable && count > 0 && !recover;
+	t->svp     = 0;
+	t->log     = vlog;
+	t->lv      = &t->lvstmt;
+	t->done    = 0;
+	t->rc      = 0;
+	if (t->queued && count > 1) {
+		t->lv = ss_malloc(p->r->a, sizeof(swv) * (count + 1));
+		if (ssunlikely(t->lv == NULL))
+			return sr_oom_malfunction(p->r->e);
+	}
+	/* commits are serialized by the caller, so the write
+	 * queue is kept in the lsn order */
 	if (sslikely(lsn == 0)) {
 		lsn = sr_seq(p->r->seq, SR_LSNNEXT);
 	} else {
-		sr_seqlock(p->r->seq);
-		if (lsn > p->r->seq->lsn)
-			p->r->seq->lsn = lsn;
-		sr_sequnlock(p->r->seq);
+		sr_seqfollow(&p->r->seq->lsn, lsn);
 	}
 	t->lsn = lsn;
-	t->recover = recover;
-	t->svp = 0;
-	t->p = p;
-	t->l = NULL;
-	if (! p->conf.enable)
-		return 0;
-	assert(p->n > 0);
-	sw *l = sscast(p->list.prev, sw, link);
-	ss_mutexlock(&l->filelock);
-	t->svp = ss_filesvp(&l->file);
-	t->l = l;
-	t->p = p;
-	return 0;
-}
-
-int sw_commit(swtx *t)
-{
-	if (t->p->conf.enable)
-		ss_mutexunlock(&t->l->filelock);
-	ss_spinunlock(&t->p->lock);
-	return 0;
-}
-
-int sw_rollback(swtx *t)
-{
-	int rc = 0;
-	if (t->p->conf.enable) {
-		rc = ss_filerlb(&t->l->file, t->svp);
-		if (ssunlikely(rc == -1))
-			sr_malfunction(t->p->r->e, "log file '%s' truncate error: %s",
-			               ss_pathof(&t->l->file.path),
-			               strerror(errno));
-		ss_mutexunlock(&t->l->filelock);
+	if (t->queued) {
+		ss_mutexlock(&p->group_lock);
+		ss_listappend(&p->group, &t->link);
+		ss_mutexunlock(&p->group_lock);
 	}
-	ss_spinunlock(&t->p->lock);
-	return rc;
+	return 0;
 }
 
 static inline void
-sw_writeadd(swmanager *p, swtx *t, svlog *vlog, swv *lv, svlogv *logv)
+sw_writeadd(swmanager *p, sw *l, svlog *vlog, swv *lv, svlogv *logv)
 {
 	sr *r = sv_logindex(vlog, logv->index_id)->r;
 	char *data = sv_vpointer(logv->v);
@@ -445,108 +436,174 @@ sw_writeadd(swmanager *p, swtx *t, svlog *vlog, swv *lv, svlogv *logv)
 	lv->crc   = ss_crcs(p->r->crc, lv, sizeof(swv), lv->crc);
 	ss_iovadd(&p->iov, lv, sizeof(swv));
 	ss_iovadd(&p->iov, data, lv->size);
-	logv->v->log = t->l;
+	logv->v->log = l;
 }
 
 static inline int
-sw_writestmt(swtx *t, svlog *vlog)
+sw_writeiov(swmanager *p, sw *l)
 {
-	swmanager *p = t->p;
-	svlogv *stmt = NULL;
-	ssiter i;
-	ss_iterinit(ss_bufiter, &i);
-	ss_iteropen(ss_bufiter, &i, &vlog->buf, sizeof(svlogv));
-	for (; ss_iterhas(ss_bufiter, &i); ss_iternext(ss_bufiter, &i)) {
-		svlogv *logv = ss_iterof(ss_bufiter, &i);
-		svv *v = logv->v;
-		sr *r = sv_logindex(vlog, logv->index_id)->r;
-		sf_lsnset(r->scheme, sv_vpointer(v), t->lsn);
-		if (sslikely(! (sf_is(r->scheme, sv_vpointer(v), SVGET)))) {
-			assert(stmt == NULL);
-			stmt = logv;
-		}
-	}
-	assert(stmt != NULL);
-	swv lv;
-	sw_writeadd(t->p, t, vlog, &lv, stmt);
-	int rc = ss_filewritev(&t->l->file, &p->iov);
+	uint64_t trace = sr_stattrace_begin(p->r->stat);
+	int rc = ss_filewritev(&l->file, &p->iov);
 	if (ssunlikely(rc == -1)) {
 		sr_malfunction(p->r->e, "log file '%s' write error: %s",
-		               ss_pathof(&t->l->file.path),
+		               ss_pathof(&l->file.path),
 		               strerror(errno));
 		return -1;
 	}
-	ss_gcmark(&t->l->gc, 1);
+	sr_stattrace(p->r->stat, SR_PHASE_LOGWRITE, trace);
 	ss_iovreset(&p->iov);
 	return 0;
 }
 
-static int
-sw_writestmt_multi(swtx *t, svlog *vlog)
+static inline int
+sw_groupadd(swmanager *p, sw *l, swtx *t)
 {
-	swmanager *p = t->p;
-	sw *l = t->l;
-	swv lvbuf[510]; /* 1 + 510 per syscall */
-	int lvp;
+	svlog *vlog = t->log;
+	swv *lv = t->lv;
+	int count = sv_logcount_write(vlog);
 	int rc;
-	lvp = 0;
-	/* transaction header */
-	swv *lv = &lvbuf[0];
-	lv->dsn   = 0;
-	lv->flags = SVBEGIN;
-	lv->size  = sv_logcount_write(vlog);
-	lv->crc   = ss_crcs(p->r->crc, lv, sizeof(swv), 0);
-	ss_iovadd(&p->iov, lv, sizeof(swv));
-	lvp++;
-	/* body */
+	if (count > 1) {
+		if (ssunlikely(! ss_iovensure(&p->iov, 1))) {
+			rc = sw_writeiov(p, l);
+			if (ssunlikely(rc == -1))
+				return -1;
+		}
+		lv->dsn   = 0;
+		lv->flags = SVBEGIN;
+		lv->size  = count;
+		lv->crc   = ss_crcs(p->r->crc, lv, sizeof(swv), 0);
+		ss_iovadd(&p->iov, lv, sizeof(swv));
+		lv++;
+	}
 	ssiter i;
 	ss_iterinit(ss_bufiter, &i);
 	ss_iteropen(ss_bufiter, &i, &vlog->buf, sizeof(svlogv));
 	for (; ss_iterhas(ss_bufiter, &i); ss_iternext(ss_bufiter, &i))
 	{
-		if (ssunlikely(! ss_iovensure(&p->iov, 2))) {
-			rc = ss_filewritev(&l->file, &p->iov);
-			if (ssunlikely(rc == -1)) {
-				sr_malfunction(p->r->e, "log file '%s' write error: %s",
-				               ss_pathof(&l->file.path),
-				               strerror(errno));
-				return -1;
-			}
-			ss_iovreset(&p->iov);
-			lvp = 0;
-		}
 		svlogv *logv = ss_iterof(ss_bufiter, &i);
 		svv *v = logv->v;
 		sr *r = sv_logindex(vlog, logv->index_id)->r;
 		sf_lsnset(r->scheme, sv_vpointer(v), t->lsn);
 		if (sf_is(r->scheme, sv_vpointer(v), SVGET))
 			continue;
-		lv = &lvbuf[lvp];
-		sw_writeadd(p, t, vlog, lv, logv);
-		lvp++;
+		if (ssunlikely(! ss_iovensure(&p->iov, 2))) {
+			rc = sw_writeiov(p, l);
+			if (ssunlikely(rc == -1))
+				return -1;
+		}
+		sw_writeadd(p, l, vlog, lv, logv);
+		lv++;
+	}
+	return count;
+}
+
+static int
+sw_groupwrite(swmanager *p, sslist *batch)
+{
+	ss_spinlock(&p->lock);
+	assert(p->n > 0);
+	sw *l = sscast(p->list.prev, sw, link);
+	ss_mutexlock(&l->filelock);
+	uint64_t svp = ss_filesvp(&l->file);
+	int count = 0;
+	int rc;
+	sslist *i;
+	ss_listforeach(batch, i) {
+		swtx *t = sscast(i, swtx, link);
+		t->svp = svp;
+		t->l = l;
+		rc = sw_groupadd(p, l, t);
+		if (ssunlikely(rc == -1))
+			goto error;
+		count += rc;
 	}
 	if (sslikely(ss_iovhas(&p->iov))) {
-		rc = ss_filewritev(&l->file, &p->iov);
+		rc = sw_writeiov(p, l);
+		if (ssunlikely(rc == -1))
+			goto error;
+	}
+	ss_gcmark(&l->gc, count);
+	ss_spinunlock(&p->lock);
+
+	/* single sync for the whole batch */
+	if (p->conf.sync_on_write) {
+		uint64_t trace = sr_stattrace_begin(p->r->stat);
+		rc = ss_filesync(&l->file);
+		sr_stattrace(p->r->stat, SR_PHASE_LOGSYNC, trace);
 		if (ssunlikely(rc == -1)) {
-			sr_malfunction(p->r->e, "log file '%s' write error: %s",
+			sr_malfunction(p->r->e, "log file '%s' sync error: %s",
 			               ss_pathof(&l->file.path),
 			               strerror(errno));
+			ss_filerlb(&l->file, svp);
+			ss_mutexunlock(&l->filelock);
 			return -1;
 		}
-		ss_iovreset(&p->iov);
 	}
-	ss_gcmark(&l->gc, sv_logcount_write(vlog));
+	ss_mutexunlock(&l->filelock);
 	return 0;
+error:
+	ss_iovreset(&p->iov);
+	rc = ss_filerlb(&l->file, svp);
+	if (ssunlikely(rc == -1))
+		sr_malfunction(p->r->e, "log file '%s' truncate error: %s",
+		               ss_pathof(&l->file.path),
+		               strerror(errno));
+	ss_mutexunlock(&l->filelock);
+	ss_spinunlock(&p->lock);
+	return -1;
 }
 
-int sw_write(swtx *t, svlog *vlog)
+static int
+sw_writegroup(swtx *t)
+{
+	swmanager *p = t->p;
+	ss_mutexlock(&p->group_lock);
+	while (! t->done) {
+		if (p->group_leader) {
+			ss_condwait(&p->group_cond, &p->group_lock);
+			continue;
+		}
+		/* become a leader, take current batch or only the
+		 * oldest transaction without group commit */
+		p->group_leader = 1;
+		sslist batch;
+		ss_listinit(&batch);
+		if (p->conf.group_commit) {
+			ss_listmerge(&batch, &p->group);
+			ss_listinit(&p->group);
+		} else {
+			ss_listappend(&batch, ss_listpop(&p->group));
+		}
+		ss_mutexunlock(&p->group_lock);
+
+		int rc = sw_groupwrite(p, &batch);
+
+		ss_mutexlock(&p->group_lock);
+		sslist *i;
+		ss_listforeach(&batch, i) {
+			swtx *f = sscast(i, swtx, link);
+			f->rc = rc;
+			f->done = 1;
+			p->commits++;
+		}
+		p->writes++;
+		p->group_leader = 0;
+		ss_condbroadcast(&p->group_cond);
+	}
+	ss_mutexunlock(&p->group_lock);
+	if (t->lv != &t->lvstmt)
+		ss_free(p->r->a, t->lv);
+	t->lv = NULL;
+	return t->rc;
+}
+
+int sw_write(swtx *t)
 {
-	int count = sv_logcount_write(vlog);
 	/* fast path for log-disabled, recover or
 	 * ro-transactions
 	 */
-	if (t->recover || !t->p->conf.enable || count == 0)
-	{
+	if (! t->queued) {
+		svlog *vlog = t->log;
 		ssiter i;
 		ss_iterinit(ss_bufiter, &i);
 		ss_iteropen(ss_bufiter, &i, &vlog->buf, sizeof(svlogv));
@@ -558,26 +615,7 @@ int sw_write(swtx *t, svlog *vlog)
 		}
 		return 0;
 	}
-
-	/* write single or multi-stmt transaction */
-	int rc;
-	if (sslikely(count == 1)) {
-		rc = sw_writestmt(t, vlog);
-	} else {
-		rc = sw_writestmt_multi(t, vlog);
-	}
-	if (ssunlikely(rc == -1))
-		return -1;
-
-	/* sync */
-	if (t->p->conf.sync_on_write) {
-		rc = ss_filesync(&t->l->file);
-		if (ssunlikely(rc == -1)) {
-			sr_malfunction(t->p->r->e, "log file '%s' sync error: %s",
-			               ss_pathof(&t->l->file.path),
-			               strerror(errno));
-			return -1;
-		}
-	}
-	return 0;
+	/* wait for a leader to write the transaction
+	 * along with concurrent committers */
+	return sw_writegroup(t);
 }
@@ -25,6 +25,12 @@ struct sw {
 
 struct swmanager {
 	ssspinlock lock;
+	ssmutex    group_lock;
+	sscond     group_cond;
+	sslist     group;
+	int        group_leader;
+	uint64_t   writes;
+	uint64_t   commits;
 	swconf     conf;
 	sslist     list;
 	int        gc;
@@ -37,8 +43,15 @@ struct swtx {
 	swmanager *p;
 	sw        *l;
 	int        recover;
+	int        queued;
 	uint64_t   lsn;
 	uint64_t   svp;
+	svlog     *log;
+	swv       *lv;
+	swv        lvstmt;
+	int        done;
+	int        rc;
+	sslist     link;
 };
 
 static inline swconf*
@@ -56,9 +69,7 @@ int sw_managergc(swmanager*);
 int sw_managerfiles(swmanager*);
 int sw_managercopy(swmanager*, char*, ssbuf*);
 
-int sw_begin(swmanager*, swtx*, uint64_t, int);
-int sw_commit(swtx*);
-int sw_rollback(swtx*);
-int sw_write(swtx*, svlog*);
+int sw_begin(swmanager*, swtx*, svlog*, uint64_t, int);
+int sw_write(swtx*);
 
 #endif
@@ -19,6 +19,7 @@ void sw_confinit(swconf *c)
 	c->path           = NULL;
 	c->rotatewm       = 500000;
 	c->sync_on_write  = 0;
+	c->group_commit   = 0;
 	c->sync_on_rotate = 1;
 }
 
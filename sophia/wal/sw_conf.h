@@ -16,6 +16,7 @@ struct swconf {
 	char     *path;
 	uint32_t  sync_on_rotate;
 	uint32_t  sync_on_write;
+	uint32_t  group_commit;
 	uint32_t  rotatewm;
 };
 
@@ -59,6 +59,61 @@ compact_test(void)
 	t( sp_destroy(env) == 0 );
 }
 
+static void
+compact_test_read_ahead(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.cache", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.page_size", 1024) == 0 );
+	t( sp_setint(env, "db.test.mmap", 0) == 0 );
+	t( sp_setint(env, "db.test.read_ahead", 4) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	/* node pages are read by the read-ahead batch
+	 * during the second compaction */
+	int pass = 0;
+	while (pass < 2) {
+		int key = pass;
+		while (key < 5000) {
+			void *o = sp_document(db);
+			t( o != NULL );
+			int value = key + pass;
+			t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+			t( sp_setstring(o, "value", &value, sizeof(value)) == 0 );
+			t( sp_set(db, o) == 0 );
+			key += pass + 1;
+		}
+		t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+		pass++;
+	}
+
+	int key = 0;
+	while (key < 5000) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		o = sp_get(db, o);
+		t( o != NULL );
+		int expect = (key % 2) ? key + 1 : key;
+		t( *(int*)sp_getstring(o, "value", NULL) == expect );
+		sp_destroy(o);
+		key++;
+	}
+	t( sp_destroy(env) == 0 );
+}
+
 static void
 compact_test_directio(void)
 {
@@ -112,10 +167,286 @@ compact_test_directio(void)
 	t( sp_destroy(env) == 0 );
 }
 
+static void
+compact_test_parallel(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.cache", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.node_size", 65536) == 0 );
+	t( sp_setint(env, "db.test.compaction.page_size", 1024) == 0 );
+	t( sp_setint(env, "db.test.compaction.parallel", 4) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	char value[100];
+	memset(value, 0, sizeof(value));
+
+	/* even keys first, then odd keys into the existing nodes */
+	int key = 0;
+	while (key < 20000) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_setstring(o, "value", value, sizeof(value)) == 0 );
+		t( sp_set(db, o) == 0 );
+		key += 2;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	key = 1;
+	while (key < 20000) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_setstring(o, "value", value, sizeof(value)) == 0 );
+		t( sp_set(db, o) == 0 );
+		key += 2;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( sp_getint(env, "db.test.index.node_count") > 1 );
+
+	void *o = sp_document(db);
+	t( o != NULL );
+	void *c = sp_cursor(env);
+	t( c != NULL );
+	key = 0;
+	while ((o = sp_get(c, o))) {
+		t( *(int*)sp_getstring(o, "key", NULL) == key );
+		key++;
+	}
+	t( key == 20000 );
+	t( sp_destroy(c) == 0 );
+	t( sp_destroy(env) == 0 );
+}
+
+static void
+compact_passthrough(char *compression)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.cache", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.page_size", 1024) == 0 );
+	t( sp_setstring(env, "db.test.compression", compression, 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	char value[100];
+	memset(value, 0, sizeof(value));
+
+	int key = 0;
+	while (key < 2000) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		memcpy(value, &key, sizeof(key));
+		t( sp_setstring(o, "value", value, sizeof(value)) == 0 );
+		t( sp_set(db, o) == 0 );
+		key++;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( sp_getint(env, "db.test.stat.page_passthrough") == 0 );
+
+	/* only pages which overlap updates are rewritten */
+	key = 1000;
+	while (key < 1010) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		int v = key + 1;
+		memcpy(value, &v, sizeof(v));
+		t( sp_setstring(o, "value", value, sizeof(value)) == 0 );
+		t( sp_set(db, o) == 0 );
+		key++;
+	}
+	key = 500;
+	void *o = sp_document(db);
+	t( o != NULL );
+	t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+	t( sp_delete(db, o) == 0 );
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	int pages = sp_getint(env, "db.test.index.page_count");
+	int passthrough = sp_getint(env, "db.test.stat.page_passthrough");
+	t( passthrough > 0 );
+	t( passthrough < pages );
+	t( passthrough >= pages - 6 );
+
+	key = 0;
+	while (key < 2000) {
+		o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		o = sp_get(db, o);
+		if (key == 500) {
+			t( o == NULL );
+		} else {
+			t( o != NULL );
+			int v = *(int*)sp_getstring(o, "value", NULL);
+			if (key >= 1000 && key < 1010)
+				t( v == key + 1 );
+			else
+				t( v == key );
+			sp_destroy(o);
+		}
+		key++;
+	}
+	o = sp_document(db);
+	t( o != NULL );
+	void *c = sp_cursor(env);
+	t( c != NULL );
+	key = 0;
+	while ((o = sp_get(c, o))) {
+		if (key == 500)
+			key++;
+		t( *(int*)sp_getstring(o, "key", NULL) == key );
+		key++;
+	}
+	t( key == 2000 );
+	t( sp_destroy(c) == 0 );
+	t( sp_destroy(env) == 0 );
+}
+
+static void
+compact_test_passthrough(void)
+{
+	compact_passthrough("none");
+}
+
+static void
+compact_test_passthrough_compression(void)
+{
+	compact_passthrough("zstd");
+}
+
+static void*
+compact_threads_env(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.cache", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.node_size", 65536) == 0 );
+	t( sp_setint(env, "db.test.compaction.page_size", 1024) == 0 );
+	t( sp_setint(env, "db.test.compaction.compression_threads", 3) == 0 );
+	t( sp_setstring(env, "db.test.compression", "zstd", 0) == 0 );
+	t( sp_open(env) == 0 );
+	return env;
+}
+
+static void
+compact_threads_verify(void *env, void *db)
+{
+	void *o = sp_document(db);
+	t( o != NULL );
+	void *c = sp_cursor(env);
+	t( c != NULL );
+	int key = 0;
+	while ((o = sp_get(c, o))) {
+		if (key % 100 == 50)
+			key++;
+		t( *(int*)sp_getstring(o, "key", NULL) == key );
+		int v = *(int*)sp_getstring(o, "value", NULL);
+		if (key >= 5000 && key < 5500)
+			t( v == key + 1 );
+		else
+			t( v == key );
+		key++;
+	}
+	t( key == 20000 );
+	t( sp_destroy(c) == 0 );
+}
+
+static void
+compact_test_compression_threads(void)
+{
+	void *env = compact_threads_env();
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+
+	char value[100];
+	memset(value, 0, sizeof(value));
+
+	int key = 0;
+	while (key < 20000) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		memcpy(value, &key, sizeof(key));
+		t( sp_setstring(o, "value", value, sizeof(value)) == 0 );
+		t( sp_set(db, o) == 0 );
+		key++;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( sp_getint(env, "db.test.index.node_count") > 1 );
+
+	/* compressed and copied pages are written in order */
+	key = 5000;
+	while (key < 5500) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		int v = key + 1;
+		memcpy(value, &v, sizeof(v));
+		t( sp_setstring(o, "value", value, sizeof(value)) == 0 );
+		t( sp_set(db, o) == 0 );
+		key++;
+	}
+	key = 50;
+	while (key < 20000) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_delete(db, o) == 0 );
+		key += 100;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( sp_getint(env, "db.test.stat.page_passthrough") > 0 );
+	compact_threads_verify(env, db);
+	t( sp_destroy(env) == 0 );
+
+	env = compact_threads_env();
+	db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	compact_threads_verify(env, db);
+	t( sp_destroy(env) == 0 );
+}
+
 stgroup *compact_group(void)
 {
 	stgroup *group = st_group("compact");
 	st_groupadd(group, st_test("test", compact_test));
 	st_groupadd(group, st_test("test_direct_io", compact_test_directio));
+	st_groupadd(group, st_test("test_parallel", compact_test_parallel));
+	st_groupadd(group, st_test("test_passthrough", compact_test_passthrough));
+	st_groupadd(group, st_test("test_passthrough_compression", compact_test_passthrough_compression));
+	st_groupadd(group, st_test("test_compression_threads", compact_test_compression_threads));
+	st_groupadd(group, st_test("test_read_ahead", compact_test_read_ahead));
 	return group;
 }
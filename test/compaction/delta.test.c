@@ -0,0 +1,286 @@
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <sophia.h>
+#include <libss.h>
+#include <libsf.h>
+#include <libsr.h>
+#include <libsv.h>
+#include <libsd.h>
+#include <libst.h>
+
+#define DELTA_KEYS 1000
+
+static void*
+delta_env(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.cache", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.delta_runs", 2) == 0 );
+	t( sp_setint(env, "db.test.compaction.delta_wm", 100) == 0 );
+	t( sp_setint(env, "db.test.mmap", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_open(env) == 0 );
+	return env;
+}
+
+static void
+delta_set(void *db, int *expect, int from, int to, int value)
+{
+	int key = from;
+	while (key < to) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		if (value == -1) {
+			t( sp_delete(db, o) == 0 );
+		} else {
+			int v = key + value;
+			t( sp_setstring(o, "value", &v, sizeof(v)) == 0 );
+			t( sp_set(db, o) == 0 );
+		}
+		expect[key] = (value == -1) ? -1 : key + value;
+		key++;
+	}
+}
+
+static void
+delta_verify(void *env, void *db, int *expect)
+{
+	int count = 0;
+	int key = 0;
+	while (key < DELTA_KEYS) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		o = sp_get(db, o);
+		if (expect[key] == -1) {
+			t( o == NULL );
+		} else {
+			t( o != NULL );
+			t( *(int*)sp_getstring(o, "value", NULL) == expect[key] );
+			sp_destroy(o);
+			count++;
+		}
+		key++;
+	}
+
+	/* runs are merged in key order, deletes hide older runs */
+	void *cur = sp_cursor(env);
+	t( cur != NULL );
+	void *o = sp_document(db);
+	int prev = -1;
+	int found = 0;
+	while ((o = sp_get(cur, o))) {
+		key = *(int*)sp_getstring(o, "key", NULL);
+		t( key > prev );
+		t( expect[key] != -1 );
+		t( *(int*)sp_getstring(o, "value", NULL) == expect[key] );
+		prev = key;
+		found++;
+	}
+	t( found == count );
+	sp_destroy(cur);
+
+	cur = sp_cursor(env);
+	t( cur != NULL );
+	o = sp_document(db);
+	t( sp_setstring(o, "order", "<", 0) == 0 );
+	prev = DELTA_KEYS;
+	found = 0;
+	while ((o = sp_get(cur, o))) {
+		key = *(int*)sp_getstring(o, "key", NULL);
+		t( key < prev );
+		t( *(int*)sp_getstring(o, "value", NULL) == expect[key] );
+		prev = key;
+		found++;
+	}
+	t( found == count );
+	sp_destroy(cur);
+}
+
+static void
+delta_prepare(void *env, void *db, int *expect)
+{
+	/* node base */
+	delta_set(db, expect, 0, DELTA_KEYS, 0);
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( sp_getint(env, "db.test.index.count") == DELTA_KEYS );
+
+	/* delta run */
+	delta_set(db, expect, 0, 100, DELTA_KEYS);
+	delta_set(db, expect, 100, 150, -1);
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( sp_getint(env, "db.test.index.node_count") == 1 );
+	t( sp_getint(env, "db.test.index.count") == DELTA_KEYS + 150 );
+	t( sp_getint(env, "db.test.index.memory_used") == 0 );
+}
+
+static void
+delta_test(void)
+{
+	int expect[DELTA_KEYS];
+	void *env = delta_env();
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+
+	delta_prepare(env, db, expect);
+	delta_verify(env, db, expect);
+
+	delta_set(db, expect, 500, 600, DELTA_KEYS * 2);
+	delta_verify(env, db, expect);
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( sp_getint(env, "db.test.index.count") == DELTA_KEYS + 250 );
+	delta_verify(env, db, expect);
+
+	/* run limit is reached, node is merged */
+	delta_set(db, expect, 0, 10, DELTA_KEYS * 3);
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( sp_getint(env, "db.test.index.count") == DELTA_KEYS - 50 );
+	delta_verify(env, db, expect);
+
+	t( sp_destroy(env) == 0 );
+}
+
+static void
+delta_test_recover(void)
+{
+	int expect[DELTA_KEYS];
+	void *env = delta_env();
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	delta_prepare(env, db, expect);
+	t( sp_destroy(env) == 0 );
+
+	/* runs are recovered, log is not replayed twice */
+	env = delta_env();
+	db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_getint(env, "db.test.index.count") == DELTA_KEYS + 150 );
+	delta_verify(env, db, expect);
+	t( sp_destroy(env) == 0 );
+}
+
+static void
+delta_file(char *path, int size)
+{
+	DIR *d = opendir(st_r.conf->db_dir);
+	t( d != NULL );
+	path[0] = 0;
+	struct dirent *de;
+	while ((de = readdir(d))) {
+		if (strstr(de->d_name, ".db") == NULL)
+			continue;
+		snprintf(path, size, "%s/%s", st_r.conf->db_dir, de->d_name);
+	}
+	closedir(d);
+	t( path[0] != 0 );
+}
+
+static void
+delta_test_truncate(void)
+{
+	int expect[DELTA_KEYS];
+	void *env = delta_env();
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	delta_prepare(env, db, expect);
+	t( sp_destroy(env) == 0 );
+
+	/* simulate interrupted run append */
+	char path[1024];
+	delta_file(path, sizeof(path));
+	ssfile file;
+	ss_fileinit(&file, &st_r.vfs);
+	t( ss_fileopen(&file, path, 0) == 0 );
+	uint64_t size = file.size;
+	t( ss_fileseek(&file, size) != -1 );
+	char garbage[333];
+	memset(garbage, 'x', sizeof(garbage));
+	t( ss_filewrite(&file, garbage, sizeof(garbage)) == sizeof(garbage) );
+	t( ss_fileclose(&file) == 0 );
+
+	env = delta_env();
+	db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_getint(env, "db.test.index.count") == DELTA_KEYS + 150 );
+	delta_verify(env, db, expect);
+	t( sp_destroy(env) == 0 );
+
+	ss_fileinit(&file, &st_r.vfs);
+	t( ss_fileopen(&file, path, 0) == 0 );
+	t( file.size == size );
+	t( ss_fileclose(&file) == 0 );
+}
+
+static void
+delta_test_truncate_crc(void)
+{
+	int expect[DELTA_KEYS];
+	void *env = delta_env();
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	delta_prepare(env, db, expect);
+	t( sp_destroy(env) == 0 );
+
+	/* corrupt the newest run header, the run is
+	 * complete and must not be truncated */
+	char path[1024];
+	delta_file(path, sizeof(path));
+	ssfile file;
+	ss_fileinit(&file, &st_r.vfs);
+	t( ss_fileopen(&file, path, 0) == 0 );
+	uint64_t size = file.size;
+	uint64_t pos = size - sizeof(sdindexheader);
+	uint32_t crc;
+	t( ss_filepread(&file, pos, &crc, sizeof(crc)) == sizeof(crc) );
+	crc++;
+	t( ss_fileseek(&file, pos) != -1 );
+	t( ss_filewrite(&file, &crc, sizeof(crc)) == sizeof(crc) );
+	t( ss_fileclose(&file) == 0 );
+
+	env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setint(env, "db.test.mmap", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_open(env) == -1 );
+	t( sp_destroy(env) == 0 );
+
+	ss_fileinit(&file, &st_r.vfs);
+	t( ss_fileopen(&file, path, 0) == 0 );
+	t( file.size == size );
+	t( ss_fileclose(&file) == 0 );
+}
+
+stgroup *delta_group(void)
+{
+	stgroup *group = st_group("delta");
+	st_groupadd(group, st_test("test", delta_test));
+	st_groupadd(group, st_test("recover", delta_test_recover));
+	st_groupadd(group, st_test("truncate", delta_test_truncate));
+	st_groupadd(group, st_test("truncate_crc", delta_test_truncate_crc));
+	return group;
+}
@@ -227,11 +227,104 @@ log_recover1(void)
 	t( sp_destroy(env) == 0 );
 }
 
+static void
+log_recover_batch(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_setint(env, "log.sync", 0) == 0 );
+	t( sp_setint(env, "log.rotate_sync", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	/* more records than a single replay batch, part of
+	 * them is already on disk */
+	uint32_t key = 0;
+	while (key < 10000) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_setstring(o, "value", &key, sizeof(key)) == 0 );
+		t( sp_set(db, o) == 0 );
+		if (key == 5000)
+			t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+		key++;
+	}
+	key = 0;
+	while (key < 10000) {
+		void *tx = sp_begin(env);
+		t( tx != NULL );
+		uint32_t value = key + 1;
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_setstring(o, "value", &value, sizeof(value)) == 0 );
+		t( sp_set(tx, o) == 0 );
+		uint32_t next = key + 1;
+		o = sp_document(db);
+		t( sp_setstring(o, "key", &next, sizeof(next)) == 0 );
+		t( sp_delete(tx, o) == 0 );
+		t( sp_commit(tx) == 0 );
+		key += 3;
+	}
+	t( sp_destroy(env) == 0 );
+
+	env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_setint(env, "log.sync", 0) == 0 );
+	t( sp_setint(env, "log.rotate_sync", 0) == 0 );
+	db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	key = 0;
+	while (key < 10000) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		o = sp_get(db, o);
+		switch (key % 3) {
+		case 0:
+			t( o != NULL );
+			t( *(uint32_t*)sp_getstring(o, "value", NULL) == key + 1 );
+			break;
+		case 1:
+			t( o == NULL );
+			break;
+		case 2:
+			t( o != NULL );
+			t( *(uint32_t*)sp_getstring(o, "value", NULL) == key );
+			break;
+		}
+		if (o)
+			sp_destroy(o);
+		key++;
+	}
+	t( sp_destroy(env) == 0 );
+}
+
 stgroup *log_group(void)
 {
 	stgroup *group = st_group("log");
 	st_groupadd(group, st_test("gc", log_gc));
 	st_groupadd(group, st_test("recover0", log_recover0));
 	st_groupadd(group, st_test("recover1", log_recover1));
+	st_groupadd(group, st_test("recover_batch", log_recover_batch));
 	return group;
 }
@@ -15,12 +15,12 @@
 #include <libsd.h>
 #include <libst.h>
 
-extern void workflow_test(char*);
+extern void workflow_test(char*, char*);
 
 static void
 io_test(void)
 {
-	workflow_test("debug.error_injection.io");
+	workflow_test("debug.error_injection.io", NULL);
 }
 
 stgroup *io_group(void)
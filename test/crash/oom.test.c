@@ -15,17 +15,24 @@
 #include <libsd.h>
 #include <libst.h>
 
-extern void workflow_test(char*);
+extern void workflow_test(char*, char*);
 
 static void
 oom_test(void)
 {
-	workflow_test("debug.error_injection.oom");
+	workflow_test("debug.error_injection.oom", NULL);
+}
+
+static void
+oom_test_btree(void)
+{
+	workflow_test("debug.error_injection.oom", "btree");
 }
 
 stgroup *oom_group(void)
 {
 	stgroup *group = st_group("oom");
 	st_groupadd(group, st_test("test", oom_test));
+	st_groupadd(group, st_test("test_btree", oom_test_btree));
 	return group;
 }
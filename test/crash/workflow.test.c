@@ -37,7 +37,7 @@ workflow_upsert_operator(int count,
 }
 
 static inline void*
-workflow_open(void *env)
+workflow_open(void *env, char *memtable)
 {
 	int rc;
 	rc = sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0);
@@ -79,6 +79,11 @@ workflow_open(void *env)
 	rc = sp_setint(env, "db.test.sync", 0);
 	if (rc == -1)
 		return NULL;
+	if (memtable) {
+		rc = sp_setstring(env, "db.test.memtable", memtable, 0);
+		if (rc == -1)
+			return NULL;
+	}
 	void *db = sp_getobject(env, "db.test");
 	if (db == NULL)
 		return NULL;
@@ -280,7 +285,7 @@ workflow_compaction(void *env, void *db)
 }
 
 void
-workflow_test(char *injection)
+workflow_test(char *injection, char *memtable)
 {
 	workflow_upsert_n = 0;
 
@@ -294,7 +299,7 @@ workflow_test(char *injection)
 		void *env = sp_env();
 		t( env != NULL );
 		t( sp_setint(env, injection, i) == 0 );
-		void *db = workflow_open(env);
+		void *db = workflow_open(env, memtable);
 		if (db == NULL) {
 			sp_destroy(env); /* close(2) might fail */
 			continue;
@@ -322,7 +327,7 @@ workflow_test(char *injection)
 		env = sp_env();
 		t( env != NULL );
 		t( sp_setint(env, injection, j) == 0 );
-		db = workflow_open(env);
+		db = workflow_open(env, memtable);
 		if (db == NULL) {
 			j++;
 			sp_destroy(env);
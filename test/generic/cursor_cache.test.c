@@ -183,11 +183,222 @@ cursor_cache_invalidate(void)
 	t( sp_destroy(env) == 0 );
 }
 
+static void
+cursor_cache_stream(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)",0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.cache", 0) == 0 );
+	t( sp_open(env) == 0 );
+
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+
+	char keys[410];
+	memset(keys, 0, sizeof(keys));
+	int i = 0;
+	while (i < 400) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &i, sizeof(i)) == 0 );
+		t( sp_setstring(o, "value", &i, sizeof(i)) == 0 );
+		t( sp_set(db, o) == 0 );
+		keys[i] = 1;
+		i += 2;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	i = 1;
+	while (i < 400) {
+		keys[i] = 1;
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &i, sizeof(i)) == 0 );
+		t( sp_setstring(o, "value", &i, sizeof(i)) == 0 );
+		t( sp_set(db, o) == 0 );
+		i += 4;
+	}
+
+	/* concurrent updates must not be visible */
+	void *cur = sp_cursor(env);
+	t( cur != NULL );
+	void *o = sp_document(db);
+	int expect = 0;
+	int count = 0;
+	while ((o = sp_get(cur, o))) {
+		t( *(int*)sp_getstring(o, "key", NULL) == expect );
+		t( *(int*)sp_getstring(o, "value", NULL) == expect );
+		if ((count % 10) == 0) {
+			int key = expect + 3;
+			int value = -1;
+			void *w = sp_document(db);
+			t( sp_setstring(w, "key", &key, sizeof(key)) == 0 );
+			t( sp_setstring(w, "value", &value, sizeof(value)) == 0 );
+			t( sp_set(db, w) == 0 );
+			keys[key] = 1;
+			key = expect + 2;
+			w = sp_document(db);
+			t( sp_setstring(w, "key", &key, sizeof(key)) == 0 );
+			t( sp_setstring(w, "value", &value, sizeof(value)) == 0 );
+			t( sp_set(db, w) == 0 );
+			keys[key] = 1;
+		}
+		count++;
+		if ((expect % 4) == 1)
+			expect++;
+		else
+		if ((expect % 4) == 0)
+			expect++;
+		else
+			expect += 2;
+	}
+	t( count == 300 );
+	t( sp_destroy(cur) == 0 );
+
+	/* reverse order */
+	cur = sp_cursor(env);
+	t( cur != NULL );
+	o = sp_document(db);
+	t( sp_setstring(o, "order", "<", 0) == 0 );
+	int prev = sizeof(keys);
+	while ((o = sp_get(cur, o))) {
+		int key = *(int*)sp_getstring(o, "key", NULL);
+		t( key < prev );
+		while (--prev > key)
+			t( keys[prev] == 0 );
+		t( keys[key] == 1 );
+	}
+	while (--prev >= 0)
+		t( keys[prev] == 0 );
+	t( sp_destroy(cur) == 0 );
+
+	t( sp_destroy(env) == 0 );
+}
+
+static void
+cursor_cache_read_ahead_run(int direct_io, char *compression, int window)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setstring(env, "db.test.compression", compression, 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.node_size", 65536) == 0 );
+	t( sp_setint(env, "db.test.compaction.page_size", 1024) == 0 );
+	t( sp_setint(env, "db.test.compaction.cache", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_setint(env, "db.test.mmap", 0) == 0 );
+	t( sp_setint(env, "db.test.direct_io", direct_io) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+	t( sp_setint(env, "db.test.read_ahead", window) == 0 );
+	t( sp_getint(env, "db.test.read_ahead") == window );
+
+	uint32_t key = 0;
+	while (key < 10000) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_setstring(o, "value", &key, sizeof(key)) == 0 );
+		t( sp_set(db, o) == 0 );
+		key++;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( sp_getint(env, "db.test.index.node_count") > 1 );
+
+	/* deletes stay in memory */
+	key = 0;
+	while (key < 10000) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_delete(db, o) == 0 );
+		key += 10;
+	}
+
+	/* forward scan across pages and nodes */
+	void *cur = sp_cursor(env);
+	t( cur != NULL );
+	void *o = sp_document(db);
+	uint32_t expect = 1;
+	int count = 0;
+	while ((o = sp_get(cur, o))) {
+		t( *(uint32_t*)sp_getstring(o, "key", NULL) == expect );
+		t( *(uint32_t*)sp_getstring(o, "value", NULL) == expect );
+		expect++;
+		if ((expect % 10) == 0)
+			expect++;
+		count++;
+	}
+	t( count == 9000 );
+	t( sp_destroy(cur) == 0 );
+
+	/* reverse scan from the middle */
+	cur = sp_cursor(env);
+	t( cur != NULL );
+	o = sp_document(db);
+	key = 5005;
+	t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+	t( sp_setstring(o, "order", "<=", 0) == 0 );
+	expect = 5005;
+	count = 0;
+	while ((o = sp_get(cur, o))) {
+		t( *(uint32_t*)sp_getstring(o, "key", NULL) == expect );
+		expect--;
+		if ((expect % 10) == 0)
+			expect--;
+		count++;
+	}
+	t( count == 4505 );
+	t( sp_destroy(cur) == 0 );
+	t( sp_destroy(env) == 0 );
+}
+
+static void
+cursor_cache_read_ahead(void)
+{
+	cursor_cache_read_ahead_run(0, "none", 8);
+}
+
+static void
+cursor_cache_read_ahead_lz4(void)
+{
+	cursor_cache_read_ahead_run(0, "lz4", 1);
+}
+
+static void
+cursor_cache_read_ahead_direct_io(void)
+{
+	cursor_cache_read_ahead_run(1, "lz4", 3);
+}
+
+static void
+cursor_cache_read_ahead_off(void)
+{
+	cursor_cache_read_ahead_run(0, "none", 0);
+}
+
 stgroup *cursor_cache_group(void)
 {
 	stgroup *group = st_group("cursor_cache");
 	st_groupadd(group, st_test("test0", cursor_cache_test0));
 	st_groupadd(group, st_test("test1", cursor_cache_test1));
 	st_groupadd(group, st_test("invalidate", cursor_cache_invalidate));
+	st_groupadd(group, st_test("stream", cursor_cache_stream));
+	st_groupadd(group, st_test("read_ahead", cursor_cache_read_ahead));
+	st_groupadd(group, st_test("read_ahead_lz4", cursor_cache_read_ahead_lz4));
+	st_groupadd(group, st_test("read_ahead_direct_io", cursor_cache_read_ahead_direct_io));
+	st_groupadd(group, st_test("read_ahead_off", cursor_cache_read_ahead_off));
 	return group;
 }
@@ -239,6 +239,57 @@ document_setint(void)
 	t( sp_destroy(env) == 0 );
 }
 
+static void
+document_result_key(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.value", "u32", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	void *o = sp_document(db);
+	t( sp_setint(o, "key", 7) == 0 );
+	t( sp_setint(o, "value", 1) == 0 );
+	t( sp_set(db, o) == 0 );
+
+	/* in-memory result is used as a transaction key */
+	o = sp_document(db);
+	t( sp_setint(o, "key", 7) == 0 );
+	o = sp_get(db, o);
+	t( o != NULL );
+	void *tx = sp_begin(env);
+	t( tx != NULL );
+	o = sp_get(tx, o);
+	t( o != NULL );
+	t( sp_getint(o, "value") == 1 );
+	sp_destroy(o);
+	t( sp_commit(tx) == 0 );
+
+	o = sp_document(db);
+	t( sp_setint(o, "key", 7) == 0 );
+	t( sp_setint(o, "value", 2) == 0 );
+	t( sp_set(db, o) == 0 );
+	o = sp_document(db);
+	t( sp_setint(o, "key", 7) == 0 );
+	o = sp_get(db, o);
+	t( o != NULL );
+	t( sp_getint(o, "value") == 2 );
+	sp_destroy(o);
+
+	t( sp_destroy(env) == 0 );
+}
+
 stgroup *document_group(void)
 {
 	stgroup *group = st_group("document");
@@ -248,5 +299,6 @@ stgroup *document_group(void)
 	st_groupadd(group, st_test("readonly1", document_readonly1));
 	st_groupadd(group, st_test("hints", document_hints));
 	st_groupadd(group, st_test("setint", document_setint));
+	st_groupadd(group, st_test("result_key", document_result_key));
 	return group;
 }
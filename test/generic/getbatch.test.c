@@ -0,0 +1,225 @@
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <sophia.h>
+#include <libss.h>
+#include <libsf.h>
+#include <libsr.h>
+#include <libsv.h>
+#include <libsd.h>
+#include <libst.h>
+
+static void
+getbatch_memory(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	uint32_t key = 0;
+	while (key < 100) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_setstring(o, "value", &key, sizeof(key)) == 0 );
+		t( sp_set(db, o) == 0 );
+		key += 2;
+	}
+
+	uint32_t request[] = { 50, 3, 0, 98, 50, 101, 12 };
+	int count = sizeof(request) / sizeof(request[0]);
+	void *keys[7];
+	void *result[7];
+	int i = 0;
+	while (i < count) {
+		keys[i] = sp_document(db);
+		t( sp_setstring(keys[i], "key", &request[i], sizeof(uint32_t)) == 0 );
+		i++;
+	}
+	t( sp_getbatch(db, keys, result, count) == 0 );
+	i = 0;
+	while (i < count) {
+		if (request[i] % 2 == 0 && request[i] < 100) {
+			t( result[i] != NULL );
+			t( *(uint32_t*)sp_getstring(result[i], "key", NULL) == request[i] );
+			t( *(uint32_t*)sp_getstring(result[i], "value", NULL) == request[i] );
+			sp_destroy(result[i]);
+		} else {
+			t( result[i] == NULL );
+		}
+		i++;
+	}
+	t( sp_destroy(env) == 0 );
+}
+
+static void
+getbatch_disk_run(int mmap, int direct_io)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setstring(env, "db.test.compression", "lz4", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.node_size", 65536) == 0 );
+	t( sp_setint(env, "db.test.compaction.page_size", 1024) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_setint(env, "db.test.mmap", mmap) == 0 );
+	t( sp_setint(env, "db.test.direct_io", direct_io) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	uint32_t key = 0;
+	while (key < 10000) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_setstring(o, "value", &key, sizeof(key)) == 0 );
+		t( sp_set(db, o) == 0 );
+		key++;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( sp_getint(env, "db.test.index.node_count") > 1 );
+
+	/* deletes stay in memory */
+	key = 0;
+	while (key < 10000) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_delete(db, o) == 0 );
+		key += 10;
+	}
+
+	/* reverse order, every key of the range */
+	int count = 500;
+	uint32_t request[500];
+	void *keys[500];
+	void *result[500];
+	int i = 0;
+	while (i < count) {
+		request[i] = 9999 - i * 20;
+		keys[i] = sp_document(db);
+		t( sp_setstring(keys[i], "key", &request[i], sizeof(uint32_t)) == 0 );
+		i++;
+	}
+	t( sp_getbatch(db, keys, result, count) == 0 );
+	i = 0;
+	while (i < count) {
+		key = 9999 - i * 20;
+		t( result[i] != NULL );
+		t( *(uint32_t*)sp_getstring(result[i], "key", NULL) == key );
+		t( *(uint32_t*)sp_getstring(result[i], "value", NULL) == key );
+		sp_destroy(result[i]);
+		i++;
+	}
+
+	i = 0;
+	while (i < count) {
+		request[i] = i * 20;
+		keys[i] = sp_document(db);
+		t( sp_setstring(keys[i], "key", &request[i], sizeof(uint32_t)) == 0 );
+		i++;
+	}
+	t( sp_getbatch(db, keys, result, count) == 0 );
+	i = 0;
+	while (i < count) {
+		t( result[i] == NULL );
+		i++;
+	}
+	t( sp_destroy(env) == 0 );
+}
+
+static void
+getbatch_disk(void)
+{
+	getbatch_disk_run(1, 0);
+}
+
+static void
+getbatch_disk_pread(void)
+{
+	/* pages are read by a single batch */
+	getbatch_disk_run(0, 0);
+}
+
+static void
+getbatch_disk_direct_io(void)
+{
+	getbatch_disk_run(0, 1);
+}
+
+static void
+getbatch_order(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	uint32_t key = 0;
+	while (key < 10) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_set(db, o) == 0 );
+		key += 2;
+	}
+
+	/* range search falls back to a single get per key */
+	void *keys[2];
+	void *result[2];
+	uint32_t request[] = { 3, 4 };
+	keys[0] = sp_document(db);
+	t( sp_setstring(keys[0], "key", &request[0], sizeof(uint32_t)) == 0 );
+	t( sp_setstring(keys[0], "order", ">=", 0) == 0 );
+	keys[1] = sp_document(db);
+	t( sp_setstring(keys[1], "key", &request[1], sizeof(uint32_t)) == 0 );
+	t( sp_getbatch(db, keys, result, 2) == 0 );
+	t( result[0] != NULL );
+	t( *(uint32_t*)sp_getstring(result[0], "key", NULL) == 4 );
+	sp_destroy(result[0]);
+	t( result[1] != NULL );
+	t( *(uint32_t*)sp_getstring(result[1], "key", NULL) == 4 );
+	sp_destroy(result[1]);
+	t( sp_destroy(env) == 0 );
+}
+
+stgroup *getbatch_group(void)
+{
+	stgroup *group = st_group("getbatch");
+	st_groupadd(group, st_test("memory", getbatch_memory));
+	st_groupadd(group, st_test("disk", getbatch_disk));
+	st_groupadd(group, st_test("disk_pread", getbatch_disk_pread));
+	st_groupadd(group, st_test("disk_direct_io", getbatch_disk_direct_io));
+	st_groupadd(group, st_test("order", getbatch_order));
+	return group;
+}
@@ -67,9 +67,222 @@ profiler_count(void)
 	t( sp_destroy(env) == 0 );
 }
 
+static void
+profiler_page_cache(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setint(env, "log.sync", 0) == 0 );
+	t( sp_setint(env, "log.rotate_sync", 0) == 0 );
+	t( sp_setint(env, "page_cache.limit", 1024 * 1024) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.cache", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_setstring(env, "db.test.compression", "lz4", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	int i = 0;
+	while ( i < 100 ) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &i, sizeof(i)) == 0 );
+		t( sp_setstring(o, "value", &i, sizeof(i)) == 0 );
+		t( sp_set(db, o) == 0 );
+		i++;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+
+	t( sp_getint(env, "db.test.stat.page_cache_hit") == 0 );
+	t( sp_getint(env, "db.test.stat.page_cache_miss") == 0 );
+
+	int round = 0;
+	while ( round < 2 ) {
+		i = 0;
+		while ( i < 100 ) {
+			void *o = sp_document(db);
+			t( sp_setstring(o, "key", &i, sizeof(i)) == 0 );
+			o = sp_get(db, o);
+			t( o != NULL );
+			t( *(int*)sp_getstring(o, "value", NULL) == i );
+			sp_destroy(o);
+			i++;
+		}
+		round++;
+	}
+	t( sp_getint(env, "db.test.stat.page_cache_miss") == 1 );
+	t( sp_getint(env, "db.test.stat.page_cache_hit") == 199 );
+	t( sp_getint(env, "page_cache.count") == 1 );
+	t( sp_getint(env, "page_cache.used") > 0 );
+
+	/* compaction drops pages of the replaced node */
+	i = 0;
+	while ( i < 10 ) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &i, sizeof(i)) == 0 );
+		t( sp_setstring(o, "value", &i, sizeof(i)) == 0 );
+		t( sp_set(db, o) == 0 );
+		i++;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( sp_getint(env, "page_cache.count") == 0 );
+
+	t( sp_destroy(env) == 0 );
+}
+
+static void
+profiler_bloom(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setint(env, "log.sync", 0) == 0 );
+	t( sp_setint(env, "log.rotate_sync", 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.cache", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.bloom_bits", 10) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	int i = 0;
+	while ( i < 2000 ) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &i, sizeof(i)) == 0 );
+		t( sp_setstring(o, "value", &i, sizeof(i)) == 0 );
+		t( sp_set(db, o) == 0 );
+		i += 2;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+
+	/* existing keys */
+	i = 0;
+	while ( i < 2000 ) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &i, sizeof(i)) == 0 );
+		o = sp_get(db, o);
+		t( o != NULL );
+		t( *(int*)sp_getstring(o, "value", NULL) == i );
+		sp_destroy(o);
+		i += 2;
+	}
+	t( sp_getint(env, "db.test.stat.bloom_skip") == 0 );
+	t( sp_getint(env, "db.test.stat.bloom_false_positive") == 0 );
+
+	/* absent keys */
+	i = 1;
+	while ( i < 2000 ) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &i, sizeof(i)) == 0 );
+		o = sp_get(db, o);
+		t( o == NULL );
+		i += 2;
+	}
+	int64_t skip = sp_getint(env, "db.test.stat.bloom_skip");
+	int64_t fp = sp_getint(env, "db.test.stat.bloom_false_positive");
+	t( skip + fp == 1000 );
+	t( fp < 50 );
+
+	t( sp_destroy(env) == 0 );
+}
+
+static int
+profiler_trace_empty(void *env, char *path)
+{
+	char *s = sp_getstring(env, path, NULL);
+	t( s != NULL );
+	int empty = strcmp(s, "0 0 0.0 0 0 0") == 0;
+	free(s);
+	return empty;
+}
+
+static void
+profiler_trace(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setint(env, "log.sync", 0) == 0 );
+	t( sp_setint(env, "log.rotate_sync", 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.cache", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_setint(env, "db.test.mmap", 0) == 0 );
+	t( sp_setstring(env, "db.test.compression", "lz4", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	t( sp_getint(env, "trace.enable") == 0 );
+	int i = 0;
+	while ( i < 100 ) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &i, sizeof(i)) == 0 );
+		t( sp_setstring(o, "value", &i, sizeof(i)) == 0 );
+		t( sp_set(db, o) == 0 );
+		i++;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( profiler_trace_empty(env, "trace.log_write") );
+
+	/* tracing is enabled for open databases */
+	t( sp_setint(env, "trace.enable", 1) == 0 );
+	i = 100;
+	void *o = sp_document(db);
+	t( sp_setstring(o, "key", &i, sizeof(i)) == 0 );
+	t( sp_set(db, o) == 0 );
+	i = 0;
+	o = sp_document(db);
+	t( sp_setstring(o, "key", &i, sizeof(i)) == 0 );
+	o = sp_get(db, o);
+	t( o != NULL );
+	sp_destroy(o);
+
+	t( ! profiler_trace_empty(env, "trace.commit_lock") );
+	t( ! profiler_trace_empty(env, "trace.log_write") );
+	t( ! profiler_trace_empty(env, "db.test.trace.index_lock") );
+	t( ! profiler_trace_empty(env, "db.test.trace.index_search") );
+	t( ! profiler_trace_empty(env, "db.test.trace.page_read") );
+	t( ! profiler_trace_empty(env, "db.test.trace.decompress") );
+	t( profiler_trace_empty(env, "db.test.trace.upsert") );
+
+	/* start a new interval */
+	t( sp_setint(env, "trace.reset", 0) == 0 );
+	t( profiler_trace_empty(env, "trace.commit_lock") );
+	t( profiler_trace_empty(env, "trace.log_write") );
+	t( profiler_trace_empty(env, "db.test.trace.page_read") );
+	t( profiler_trace_empty(env, "db.test.trace.decompress") );
+	t( sp_getint(env, "db.test.stat.get") == 1 );
+
+	t( sp_destroy(env) == 0 );
+}
+
 stgroup *profiler_group(void)
 {
 	stgroup *group = st_group("profiler");
 	st_groupadd(group, st_test("count", profiler_count));
+	st_groupadd(group, st_test("page_cache", profiler_page_cache));
+	st_groupadd(group, st_test("bloom", profiler_bloom));
+	st_groupadd(group, st_test("trace", profiler_trace));
 	return group;
 }
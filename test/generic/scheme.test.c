@@ -157,6 +157,159 @@ scheme_test2(void)
 	t( sp_destroy(env) == 0 );
 }
 
+static void
+scheme_fixed_search(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32_rev,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.value", "u64", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.page_size", 1024) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	/* fixed size scheme uses the branchless page search */
+	uint32_t key = 0;
+	while (key < 4000) {
+		uint64_t value = key;
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_setstring(o, "value", &value, sizeof(value)) == 0 );
+		t( sp_set(db, o) == 0 );
+		key += 2;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+
+	key = 0;
+	while (key < 4000) {
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		o = sp_get(db, o);
+		if (key % 2) {
+			t( o == NULL );
+		} else {
+			t( o != NULL );
+			t( *(uint64_t*)sp_getstring(o, "value", NULL) == key );
+			sp_destroy(o);
+		}
+		key++;
+	}
+
+	/* keys are in reverse order */
+	void *c = sp_cursor(env);
+	t( c != NULL );
+	key = 1001;
+	void *o = sp_document(db);
+	t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+	t( sp_setstring(o, "order", ">", 0) == 0 );
+	o = sp_get(c, o);
+	t( o != NULL );
+	t( *(uint32_t*)sp_getstring(o, "key", NULL) == 1000 );
+	sp_destroy(o);
+	o = sp_document(db);
+	t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+	t( sp_setstring(o, "order", "<", 0) == 0 );
+	o = sp_get(c, o);
+	t( o != NULL );
+	t( *(uint32_t*)sp_getstring(o, "key", NULL) == 1002 );
+	sp_destroy(o);
+	sp_destroy(c);
+	t( sp_destroy(env) == 0 );
+}
+
+static void
+scheme_memtable(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.memtable", "btree", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.node_size", 64 * 1024) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_open(env) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	char *v = sp_getstring(env, "db.test.memtable", 0);
+	t( strcmp(v, "btree") == 0 );
+	free(v);
+
+	/* string keys share the first 8 bytes, so the
+	 * in-memory search has to resolve ties */
+	char key[32];
+	int count = 6000;
+	int round = 0;
+	while (round < 2) {
+		int i = 0;
+		while (i < count) {
+			int k = (i * 1031) % count;
+			snprintf(key, sizeof(key), "key_%06d", k);
+			void *o = sp_document(db);
+			t( sp_setstring(o, "key", key, strlen(key) + 1) == 0 );
+			t( sp_setstring(o, "value", &round, sizeof(round)) == 0 );
+			t( sp_set(db, o) == 0 );
+			i++;
+		}
+		if (round == 0)
+			t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+		round++;
+	}
+
+	int i = 0;
+	while (i < count) {
+		snprintf(key, sizeof(key), "key_%06d", i);
+		void *o = sp_document(db);
+		t( sp_setstring(o, "key", key, strlen(key) + 1) == 0 );
+		o = sp_get(db, o);
+		t( o != NULL );
+		t( *(int*)sp_getstring(o, "value", NULL) == 1 );
+		sp_destroy(o);
+		i++;
+	}
+
+	/* ordered scan after compaction split */
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	void *c = sp_cursor(env);
+	t( c != NULL );
+	void *o = sp_document(db);
+	i = 0;
+	while ((o = sp_get(c, o))) {
+		snprintf(key, sizeof(key), "key_%06d", i);
+		t( strcmp(sp_getstring(o, "key", NULL), key) == 0 );
+		i++;
+	}
+	t( i == count );
+	sp_destroy(c);
+	t( sp_destroy(env) == 0 );
+}
+
+static void
+scheme_memtable_unknown(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.memtable", "skiplist", 0) == 0 );
+	t( sp_open(env) == -1 );
+	t( sp_destroy(env) == 0 );
+}
+
 static int
 comparator(char *a, int a_size,
            char *b, int b_size, void *arg)
@@ -328,6 +481,9 @@ stgroup *scheme_group(void)
 	st_groupadd(group, st_test("test0", scheme_test0));
 	st_groupadd(group, st_test("test1", scheme_test1));
 	st_groupadd(group, st_test("test2", scheme_test2));
+	st_groupadd(group, st_test("fixed_search", scheme_fixed_search));
+	st_groupadd(group, st_test("memtable", scheme_memtable));
+	st_groupadd(group, st_test("memtable_unknown", scheme_memtable_unknown));
 	st_groupadd(group, st_test("comparator", scheme_comparator));
 	st_groupadd(group, st_test("timestamp0", scheme_timestamp0));
 	st_groupadd(group, st_test("timestamp1", scheme_timestamp1));
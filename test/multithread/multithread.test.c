@@ -66,6 +66,10 @@ mt_single_stmt(void)
 
 	t (sp_getint(env, "db.test.index.count") == 100000 );
 
+	/* one log write per transaction */
+	t( sp_getint(env, "log.commits") == 100000 );
+	t( sp_getint(env, "log.writes") == 100000 );
+
 	t( sp_destroy(env) == 0 );
 }
 
@@ -261,6 +265,458 @@ mt_multi_stmt_conflict1(void)
 	t( sp_destroy(env) == 0 );
 }
 
+static void
+mt_group_commit(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setint(env, "log.rotate_sync", 0) == 0 );
+	t( sp_setint(env, "log.sync", 0) == 0 );
+	t( sp_setint(env, "log.group_commit", 1) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	ssthreadpool p;
+	ss_threadpool_init(&p);
+	t( ss_threadpool_new(&p, &st_r.a, 5, single_stmt_thread, db) == 0 );
+	t( ss_threadpool_shutdown(&p, &st_r.a) == 0 );
+
+	/* concurrent commits may share log writes, batching
+	 * itself is checked by the sw unit test */
+	t( sp_getint(env, "log.commits") == 100000 );
+	t( sp_getint(env, "log.writes") <= 100000 );
+
+	void *ptr[2] = { env, db };
+	ss_threadpool_init(&p);
+	t( ss_threadpool_new(&p, &st_r.a, 5, multi_stmt_thread, ptr) == 0 );
+	t( ss_threadpool_shutdown(&p, &st_r.a) == 0 );
+
+	t( sp_getint(env, "db.test.index.count") == 200000 );
+	t( sp_destroy(env) == 0 );
+
+	/* recover */
+	env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setint(env, "log.rotate_sync", 0) == 0 );
+	t( sp_setint(env, "log.sync", 0) == 0 );
+	t( sp_setint(env, "log.group_commit", 1) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+	t( sp_getint(env, "db.test.index.count") == 200000 );
+	t( sp_destroy(env) == 0 );
+}
+
+static inline void *snapshot_writer_thread(void *arg)
+{
+	ssthread *self = arg;
+	void *env = ((void**)self->arg)[0];
+	void *db  = ((void**)self->arg)[1];
+	uint32_t i = 0;
+	while (i < 10000) {
+		void *tx = sp_begin(env);
+		assert(tx != NULL);
+		uint32_t key = 0;
+		while (key < 2) {
+			void *o = sp_document(db);
+			sp_setstring(o, "key", &key, sizeof(key));
+			sp_setstring(o, "value", &i, sizeof(i));
+			int rc = sp_set(tx, o);
+			assert(rc == 0);
+			key++;
+		}
+		int rc = sp_commit(tx);
+		assert(rc == 0);
+		i++;
+	}
+	return NULL;
+}
+
+static inline void *snapshot_reader_thread(void *arg)
+{
+	ssthread *self = arg;
+	void *env = ((void**)self->arg)[0];
+	void *db  = ((void**)self->arg)[1];
+	int i = 0;
+	while (i < 10000) {
+		void *tx = sp_begin(env);
+		assert(tx != NULL);
+		uint32_t value[2];
+		int found = 0;
+		uint32_t key = 0;
+		while (key < 2) {
+			void *o = sp_document(db);
+			sp_setstring(o, "key", &key, sizeof(key));
+			o = sp_get(tx, o);
+			if (o) {
+				value[key] = *(uint32_t*)sp_getstring(o, "value", NULL);
+				sp_destroy(o);
+				found++;
+			}
+			key++;
+		}
+		/* both keys are written by the same transaction */
+		assert(found == 0 || found == 2);
+		assert(found == 0 || value[0] == value[1]);
+		sp_destroy(tx);
+		i++;
+	}
+	return NULL;
+}
+
+static void
+mt_snapshot_read(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 3) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setint(env, "log.rotate_sync", 0) == 0 );
+	t( sp_setint(env, "log.sync", 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	void *ptr[2] = { env, db };
+	ssthreadpool writers;
+	ssthreadpool readers;
+	ss_threadpool_init(&writers);
+	ss_threadpool_init(&readers);
+	t( ss_threadpool_new(&writers, &st_r.a, 1, snapshot_writer_thread, ptr) == 0 );
+	t( ss_threadpool_new(&readers, &st_r.a, 4, snapshot_reader_thread, ptr) == 0 );
+	t( ss_threadpool_shutdown(&readers, &st_r.a) == 0 );
+	t( ss_threadpool_shutdown(&writers, &st_r.a) == 0 );
+
+	uint32_t key = 1;
+	void *o = sp_document(db);
+	sp_setstring(o, "key", &key, sizeof(key));
+	o = sp_get(db, o);
+	t( o != NULL );
+	t( *(uint32_t*)sp_getstring(o, "value", NULL) == 9999 );
+	sp_destroy(o);
+
+	t( sp_destroy(env) == 0 );
+}
+
+static inline void *cursor_writer_thread(void *arg)
+{
+	ssthread *self = arg;
+	void *env = ((void**)self->arg)[0];
+	void *db  = ((void**)self->arg)[1];
+	uint32_t i = 0;
+	while (i < 20000) {
+		uint32_t key = (i * 7919) % 20000;
+		void *o = sp_document(db);
+		sp_setstring(o, "key", &key, sizeof(key));
+		sp_setstring(o, "value", &i, sizeof(i));
+		int rc = sp_set(db, o);
+		assert(rc == 0);
+		i++;
+	}
+	(void)env;
+	return NULL;
+}
+
+static inline void *cursor_reader_thread(void *arg)
+{
+	ssthread *self = arg;
+	void *env = ((void**)self->arg)[0];
+	void *db  = ((void**)self->arg)[1];
+	int i = 0;
+	while (i < 20) {
+		void *c = sp_cursor(env);
+		assert(c != NULL);
+		void *o = sp_document(db);
+		int64_t prev = -1;
+		while ((o = sp_get(c, o))) {
+			uint32_t key = *(uint32_t*)sp_getstring(o, "key", NULL);
+			assert((int64_t)key > prev);
+			prev = key;
+		}
+		sp_destroy(c);
+		i++;
+	}
+	return NULL;
+}
+
+static void
+mt_cursor_write(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 3) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setint(env, "log.rotate_sync", 0) == 0 );
+	t( sp_setint(env, "log.sync", 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setstring(env, "db.test.memtable", "btree", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.node_size", 64 * 1024) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	/* cursors walk nodes while documents are applied
+	 * under the node locks */
+	void *ptr[2] = { env, db };
+	ssthreadpool writers;
+	ssthreadpool readers;
+	ss_threadpool_init(&writers);
+	ss_threadpool_init(&readers);
+	t( ss_threadpool_new(&writers, &st_r.a, 2, cursor_writer_thread, ptr) == 0 );
+	t( ss_threadpool_new(&readers, &st_r.a, 4, cursor_reader_thread, ptr) == 0 );
+	t( ss_threadpool_shutdown(&readers, &st_r.a) == 0 );
+	t( ss_threadpool_shutdown(&writers, &st_r.a) == 0 );
+
+	uint32_t key = 0;
+	while (key < 20000) {
+		void *o = sp_document(db);
+		sp_setstring(o, "key", &key, sizeof(key));
+		o = sp_get(db, o);
+		t( o != NULL );
+		sp_destroy(o);
+		key++;
+	}
+	t( sp_destroy(env) == 0 );
+}
+
+static inline void *cursor_count_thread(void *arg)
+{
+	ssthread *self = arg;
+	void *env = ((void**)self->arg)[0];
+	void *db  = ((void**)self->arg)[1];
+	int i = 0;
+	while (i < 20) {
+		void *c = sp_cursor(env);
+		assert(c != NULL);
+		void *o = sp_document(db);
+		uint32_t count = 0;
+		while ((o = sp_get(c, o))) {
+			uint32_t key = *(uint32_t*)sp_getstring(o, "key", NULL);
+			assert(key == count);
+			count++;
+		}
+		assert(count == 20000);
+		sp_destroy(c);
+		i++;
+	}
+	return NULL;
+}
+
+static void
+mt_cursor_compaction(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 3) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setint(env, "log.rotate_sync", 0) == 0 );
+	t( sp_setint(env, "log.sync", 0) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.node_size", 64 * 1024) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	uint32_t key = 0;
+	while (key < 20000) {
+		void *o = sp_document(db);
+		sp_setstring(o, "key", &key, sizeof(key));
+		sp_setstring(o, "value", &key, sizeof(key));
+		t( sp_set(db, o) == 0 );
+		key++;
+	}
+
+	/* nodes are compacted and replaced while cursors
+	 * read them without the index lock */
+	void *ptr[2] = { env, db };
+	ssthreadpool writers;
+	ssthreadpool readers;
+	ss_threadpool_init(&writers);
+	ss_threadpool_init(&readers);
+	t( ss_threadpool_new(&writers, &st_r.a, 2, cursor_writer_thread, ptr) == 0 );
+	t( ss_threadpool_new(&readers, &st_r.a, 4, cursor_count_thread, ptr) == 0 );
+	t( ss_threadpool_shutdown(&readers, &st_r.a) == 0 );
+	t( ss_threadpool_shutdown(&writers, &st_r.a) == 0 );
+	t( sp_destroy(env) == 0 );
+}
+
+static void
+mt_wakeup_db(void *env, char *name, int cache)
+{
+	char path[128];
+	t( sp_setstring(env, "db", name, 0) == 0 );
+	snprintf(path, sizeof(path), "db.%s.path", name);
+	t( sp_setstring(env, path, st_r.conf->db_dir, 0) == 0 );
+	snprintf(path, sizeof(path), "db.%s.scheme", name);
+	t( sp_setstring(env, path, "key", 0) == 0 );
+	snprintf(path, sizeof(path), "db.%s.scheme.key", name);
+	t( sp_setstring(env, path, "u32,key(0)", 0) == 0 );
+	snprintf(path, sizeof(path), "db.%s.compaction.cache", name);
+	t( sp_setint(env, path, cache) == 0 );
+	snprintf(path, sizeof(path), "db.%s.sync", name);
+	t( sp_setint(env, path, 0) == 0 );
+}
+
+static void
+mt_wakeup(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 1) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setint(env, "log.sync", 0) == 0 );
+	t( sp_setint(env, "log.rotate_sync", 0) == 0 );
+	mt_wakeup_db(env, "a", 1024 * 1024 * 1024);
+	mt_wakeup_db(env, "b", 1024 * 1024 * 1024);
+	mt_wakeup_db(env, "c", 0);
+	void *db = sp_getobject(env, "db.c");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	/* a commit to the last database wakes the worker,
+	 * which must find the work in a single pass and
+	 * not sleep on the idle databases */
+	uint32_t key = 0;
+	while (key < 5) {
+		usleep(50000);
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_set(db, o) == 0 );
+		uint64_t start = ss_utime();
+		while (sp_getint(env, "db.c.index.memory_used") > 0) {
+			t( (ss_utime() - start) < 500000 );
+			usleep(1000);
+		}
+		key++;
+	}
+	t( sp_destroy(env) == 0 );
+}
+
+static inline void *apply_thread(void *arg)
+{
+	ssthread *self = arg;
+	void *db = ((void**)self->arg)[0];
+	int from = (intptr_t)((void**)self->arg)[1];
+	int i = 0;
+	while (i < 10) {
+		int key = from;
+		while (key < from + 2000) {
+			void *o = sp_document(db);
+			assert(o != NULL);
+			sp_setstring(o, "key", &key, sizeof(key));
+			sp_setstring(o, "value", &i, sizeof(i));
+			int rc = sp_set(db, o);
+			assert(rc == 0);
+			key++;
+		}
+		i++;
+	}
+	return NULL;
+}
+
+static void
+mt_concurrent_apply(void)
+{
+	void *env = sp_env();
+	t( env != NULL );
+	t( sp_setstring(env, "sophia.path", st_r.conf->sophia_dir, 0) == 0 );
+	t( sp_setint(env, "scheduler.threads", 0) == 0 );
+	t( sp_setstring(env, "log.path", st_r.conf->log_dir, 0) == 0 );
+	t( sp_setint(env, "log.rotate_sync", 0) == 0 );
+	t( sp_setint(env, "log.sync", 0) == 0 );
+	t( sp_setint(env, "log.group_commit", 1) == 0 );
+	t( sp_setstring(env, "db", "test", 0) == 0 );
+	t( sp_setstring(env, "db.test.path", st_r.conf->db_dir, 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "key", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme.key", "u32,key(0)", 0) == 0 );
+	t( sp_setstring(env, "db.test.scheme", "value", 0) == 0 );
+	t( sp_setint(env, "db.test.sync", 0) == 0 );
+	t( sp_setint(env, "db.test.compaction.node_size", 65536) == 0 );
+	t( sp_setint(env, "db.test.compaction.page_size", 1024) == 0 );
+	void *db = sp_getobject(env, "db.test");
+	t( db != NULL );
+	t( sp_open(env) == 0 );
+
+	/* split keys into several nodes */
+	char value[100];
+	memset(value, 0, sizeof(value));
+	int key = 0;
+	while (key < 8000) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		t( sp_setstring(o, "value", value, sizeof(value)) == 0 );
+		t( sp_set(db, o) == 0 );
+		key++;
+	}
+	t( sp_setint(env, "db.test.compaction.compact", 0) == 0 );
+	t( sp_getint(env, "db.test.index.node_count") > 4 );
+
+	/* writers on disjoint key ranges */
+	ssthreadpool p;
+	ss_threadpool_init(&p);
+	void *ptr[4][2];
+	int i = 0;
+	while (i < 4) {
+		ptr[i][0] = db;
+		ptr[i][1] = (void*)(intptr_t)(i * 2000);
+		t( ss_threadpool_new(&p, &st_r.a, 1, apply_thread, ptr[i]) == 0 );
+		i++;
+	}
+	t( ss_threadpool_shutdown(&p, &st_r.a) == 0 );
+
+	/* commits were applied to the index concurrently */
+	t( sp_getint(env, "db.test.index.writers_max") > 1 );
+
+	key = 0;
+	while (key < 8000) {
+		void *o = sp_document(db);
+		t( o != NULL );
+		t( sp_setstring(o, "key", &key, sizeof(key)) == 0 );
+		o = sp_get(db, o);
+		t( o != NULL );
+		t( *(int*)sp_getstring(o, "value", NULL) == 9 );
+		sp_destroy(o);
+		key++;
+	}
+
+	t( sp_destroy(env) == 0 );
+}
+
 stgroup *multithread_group(void)
 {
 	stgroup *group = st_group("mt");
@@ -268,5 +724,11 @@ stgroup *multithread_group(void)
 	st_groupadd(group, st_test("multi_stmt", mt_multi_stmt));
 	st_groupadd(group, st_test("multi_stmt_conflict0", mt_multi_stmt_conflict0));
 	st_groupadd(group, st_test("multi_stmt_conflict1", mt_multi_stmt_conflict1));
+	st_groupadd(group, st_test("group_commit", mt_group_commit));
+	st_groupadd(group, st_test("snapshot_read", mt_snapshot_read));
+	st_groupadd(group, st_test("cursor_write", mt_cursor_write));
+	st_groupadd(group, st_test("cursor_compaction", mt_cursor_compaction));
+	st_groupadd(group, st_test("wakeup", mt_wakeup));
+	st_groupadd(group, st_test("concurrent_apply", mt_concurrent_apply));
 	return group;
 }
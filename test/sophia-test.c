@@ -19,6 +19,7 @@
 extern stgroup *ss_a_group(void);
 extern stgroup *ss_order_group(void);
 extern stgroup *ss_rq_group(void);
+extern stgroup *ss_hist_group(void);
 extern stgroup *ss_ht_group(void);
 extern stgroup *ss_zstdfilter_group(void);
 extern stgroup *ss_lz4filter_group(void);
@@ -28,6 +29,7 @@ extern stgroup *sf_scheme_group(void);
 
 /* runtime */
 extern stgroup *sr_conf_group(void);
+extern stgroup *sr_seq_group(void);
 
 /* version */
 extern stgroup *sv_v_group(void);
@@ -40,6 +42,7 @@ extern stgroup *sw_iter_group(void);
 extern stgroup *sd_build_group(void);
 extern stgroup *sd_v_group(void);
 extern stgroup *sd_read_group(void);
+extern stgroup *sd_iobatch_group(void);
 extern stgroup *sd_pageiter_group(void);
 
 /* generic */
@@ -56,6 +59,7 @@ extern stgroup *scheme_group(void);
 extern stgroup *rev_group(void);
 extern stgroup *backup_group(void);
 extern stgroup *prefix_group(void);
+extern stgroup *getbatch_group(void);
 extern stgroup *transaction_md_group(void);
 extern stgroup *transaction_misc_group(void);
 extern stgroup *cursor_cache_group(void);
@@ -73,6 +77,7 @@ extern stgroup *compact_delete_group(void);
 extern stgroup *gc_group(void);
 extern stgroup *expire_group(void);
 extern stgroup *checkpoint_group(void);
+extern stgroup *delta_group(void);
 
 /* functional */
 extern stgroup *transaction_group(void);
@@ -183,10 +188,12 @@ main(int argc, char *argv[])
 	st_planadd(plan, ss_a_group());
 	st_planadd(plan, ss_order_group());
 	st_planadd(plan, ss_rq_group());
+	st_planadd(plan, ss_hist_group());
 	st_planadd(plan, ss_ht_group());
 	st_planadd(plan, ss_zstdfilter_group());
 	st_planadd(plan, ss_lz4filter_group());
 	st_planadd(plan, sr_conf_group());
+	st_planadd(plan, sr_seq_group());
 	st_planadd(plan, sf_scheme_group());
 	st_planadd(plan, sv_v_group());
 	st_planadd(plan, sv_index_group());
@@ -198,6 +205,7 @@ main(int argc, char *argv[])
 	st_planadd(plan, sd_build_group());
 	st_planadd(plan, sd_v_group());
 	st_planadd(plan, sd_read_group());
+	st_planadd(plan, sd_iobatch_group());
 	st_planadd(plan, sd_pageiter_group());
 	st_suiteadd(&st_r.suite, plan);
 
@@ -221,6 +229,7 @@ main(int argc, char *argv[])
 	st_planadd(plan, rev_group());
 	st_planadd(plan, backup_group());
 	st_planadd(plan, prefix_group());
+	st_planadd(plan, getbatch_group());
 	st_planadd(plan, transaction_md_group());
 	st_planadd(plan, transaction_misc_group());
 	st_planadd(plan, cursor_cache_group());
@@ -252,6 +261,7 @@ main(int argc, char *argv[])
 	st_planadd(plan, gc_group());
 	st_planadd(plan, expire_group());
 	st_planadd(plan, checkpoint_group());
+	st_planadd(plan, delta_group());
 	st_suiteadd(&st_r.suite, plan);
 
 	plan = st_plan("memory");
@@ -0,0 +1,97 @@
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <sophia.h>
+#include <libss.h>
+#include <libsf.h>
+#include <libsr.h>
+#include <libsv.h>
+#include <libsd.h>
+#include <libst.h>
+
+static void
+sd_iobatch_prepare(ssfile *f, int size)
+{
+	ss_fileinit(f, &st_r.vfs);
+	t( ss_filenew(f, "./0000.db", 0) == 0 );
+	uint32_t *data = malloc(size);
+	t( data != NULL );
+	int i = 0;
+	while (i < size / (int)sizeof(uint32_t)) {
+		data[i] = i;
+		i++;
+	}
+	t( ss_filewrite(f, data, size) == size );
+	free(data);
+}
+
+static void
+sd_iobatch_run(int direct)
+{
+	int size = 1024 * 1024;
+	ssfile f;
+	sd_iobatch_prepare(&f, size);
+
+	sdio io;
+	sd_ioinit(&io);
+	io.direct = direct;
+	io.size_page = 4096;
+
+	/* more requests than a single ring submission */
+	sdiobatch b;
+	sd_iobatch_init(&b);
+	int count = 200;
+	int i = 0;
+	while (i < count) {
+		uint64_t offset = ((i * 7919) % (size / 4 - 64)) * 4;
+		t( sd_iobatch_add(&b, &st_r.r, &f, offset, 100 + i) == 0 );
+		i++;
+	}
+	t( sd_iobatch_read(&b, &io, &st_r.r, 0) == 0 );
+	i = 0;
+	while (i < count) {
+		uint64_t offset = ((i * 7919) % (size / 4 - 64)) * 4;
+		sdioreq *req = sd_iobatch_match(&b, &f, offset);
+		t( req != NULL );
+		t( req->offset == offset );
+		uint32_t *v = (uint32_t*)req->page;
+		t( v[0] == offset / 4 );
+		t( v[(req->size / 4) - 1] == (offset / 4) + (req->size / 4) - 1 );
+		if (direct)
+			t( ((intptr_t)req->page % 4096) == (intptr_t)(offset % 4096) );
+		i++;
+	}
+	t( sd_iobatch_match(&b, &f, 3) == NULL );
+	sd_iobatch_free(&b, &st_r.r);
+
+	ss_fileclose(&f);
+	t( ss_vfsunlink(&st_r.vfs, "./0000.db") == 0 );
+}
+
+static void
+sd_iobatch_read_test(void)
+{
+	sd_iobatch_run(0);
+}
+
+static void
+sd_iobatch_read_direct(void)
+{
+	/* offsets and buffers are aligned, file is opened
+	 * without O_DIRECT so the test runs on any fs */
+	sd_iobatch_run(1);
+}
+
+stgroup *sd_iobatch_group(void)
+{
+	stgroup *group = st_group("sdiobatch");
+	st_groupadd(group, st_test("read", sd_iobatch_read_test));
+	st_groupadd(group, st_test("read_direct", sd_iobatch_read_direct));
+	return group;
+}
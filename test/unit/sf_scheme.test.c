@@ -62,9 +62,106 @@ sf_scheme_saveload(void)
 	ss_buffree(&buf, &st_r.a);
 }
 
+static void
+sf_scheme_search_gen(sfscheme *s, char *dest)
+{
+	/* small domains to produce equal values and
+	 * common string prefixes */
+	static char alphabet[] = { 0, 'a', 'b', (char)0xff };
+	char str[2][16];
+	int nstr = 0;
+	sfv pv[8];
+	memset(pv, 0, sizeof(pv));
+	int i = 0;
+	while (i < s->fields_count) {
+		sffield *f = s->fields[i];
+		if (f->lsn || f->flags) {
+			i++;
+			continue;
+		}
+		if (f->type == SS_STRING) {
+			char *p = str[nstr++];
+			int size = rand() % 13;
+			int j = 0;
+			while (j < size) {
+				p[j] = alphabet[rand() % 4];
+				j++;
+			}
+			pv[i].pointer = p;
+			pv[i].size = size;
+		} else {
+			pv[i].numeric.u64 = 0;
+			switch (f->fixed_size) {
+			case 1: pv[i].numeric.u8 = rand() % 4;
+				break;
+			case 2: pv[i].numeric.u16 = (rand() % 4) * 1000;
+				break;
+			case 4: pv[i].numeric.u32 = (rand() % 4) * 100000;
+				break;
+			case 8: pv[i].numeric.u64 = (rand() % 4) * 10000000000ULL;
+				break;
+			}
+			pv[i].pointer = (char*)&pv[i].numeric;
+			pv[i].size = f->fixed_size;
+		}
+		i++;
+	}
+	sf_write(s, pv, dest);
+}
+
+static void
+sf_scheme_search_run(char **options, int count)
+{
+	sfscheme cmp;
+	sf_schemeinit(&cmp);
+	int i = 0;
+	while (i < count) {
+		char name[16];
+		snprintf(name, sizeof(name), "f%d", i);
+		sffield *field = sf_fieldnew(&st_r.a, name);
+		t( field != NULL );
+		t( sf_fieldoptions(field, &st_r.a, options[i]) == 0);
+		t( sf_schemeadd(&cmp, &st_r.a, field) == 0);
+		i++;
+	}
+	t( sf_schemevalidate(&cmp, &st_r.a) == 0 );
+
+	char a[128];
+	char b[128];
+	i = 0;
+	while (i < 20000) {
+		sf_scheme_search_gen(&cmp, a);
+		sf_scheme_search_gen(&cmp, b);
+		sfsearch s;
+		sf_searchinit(&s, &cmp, b);
+		t( s.normalized == 1 );
+		t( sf_searchcmp(&s, a) == sf_compare(&cmp, a, b) );
+		i++;
+	}
+	sf_schemefree(&cmp, &st_r.a);
+}
+
+static void
+sf_scheme_search(void)
+{
+	char *string[] = { "string,key(0)", "string" };
+	sf_scheme_search_run(string, 2);
+	char *u32rev[] = { "u32_rev,key(0)", "u32" };
+	sf_scheme_search_run(u32rev, 2);
+	char *u64[] = { "u64,key(0)" };
+	sf_scheme_search_run(u64, 1);
+	char *u8[] = { "u8,key(0)", "u8_rev,key(1)" };
+	sf_scheme_search_run(u8, 2);
+	char *multi[] = { "u16,key(0)", "string,key(1)", "u16_rev" };
+	sf_scheme_search_run(multi, 3);
+	char *multistr[] = { "string,key(0)", "u64_rev,key(1)" };
+	sf_scheme_search_run(multistr, 2);
+}
+
 stgroup *sf_scheme_group(void)
 {
 	stgroup *group = st_group("sfscheme");
 	st_groupadd(group, st_test("save_load", sf_scheme_saveload));
+	st_groupadd(group, st_test("search", sf_scheme_search));
 	return group;
 }
@@ -0,0 +1,104 @@
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <sophia.h>
+#include <libss.h>
+#include <libsf.h>
+#include <libsr.h>
+#include <libsv.h>
+#include <libso.h>
+#include <libst.h>
+
+static srseq sr_seq_test_seq;
+static int   sr_seq_test_count = 500000;
+
+static void*
+sr_seq_test_thread(void *arg)
+{
+	uint64_t *fail = arg;
+	uint64_t last = 0;
+	int i = 0;
+	while (i < sr_seq_test_count) {
+		uint64_t lsn = sr_seq(&sr_seq_test_seq, SR_LSNNEXT);
+		if (lsn <= last)
+			__sync_fetch_and_add(fail, 1);
+		last = lsn;
+		sr_seq(&sr_seq_test_seq, SR_VLSN);
+		i++;
+	}
+	return NULL;
+}
+
+static void
+sr_seq_test_next(void)
+{
+	sr_seqinit(&sr_seq_test_seq);
+	uint64_t fail = 0;
+	ssthreadpool p;
+	ss_threadpool_init(&p);
+	t( ss_threadpool_new(&p, &st_r.a, 4, sr_seq_test_thread, &fail) == 0 );
+	t( ss_threadpool_shutdown(&p, &st_r.a) == 0 );
+	t( fail == 0 );
+	t( sr_seq(&sr_seq_test_seq, SR_LSN) == (uint64_t)sr_seq_test_count * 4 );
+	sr_seqfree(&sr_seq_test_seq);
+}
+
+static void
+sr_seq_test_follow(void)
+{
+	srseq seq;
+	sr_seqinit(&seq);
+	sr_seqfollow(&seq.lsn, 10);
+	t( sr_seq(&seq, SR_LSN) == 10 );
+	sr_seqfollow(&seq.lsn, 5);
+	t( sr_seq(&seq, SR_LSN) == 10 );
+	t( sr_seq(&seq, SR_LSNNEXT) == 11 );
+
+	srseq copy;
+	sr_seqcopy(&seq, &copy);
+	t( copy.lsn == 11 );
+	t( copy.vlsn == 0 );
+	sr_seqfree(&seq);
+}
+
+static void
+sr_seq_test_scale(void)
+{
+	/* print sequence throughput for a number
+	 * of concurrent threads */
+	uint64_t fail = 0;
+	int threads;
+	for (threads = 1; threads <= 8; threads *= 2) {
+		sr_seqinit(&sr_seq_test_seq);
+		uint64_t start = ss_utime();
+		ssthreadpool p;
+		ss_threadpool_init(&p);
+		t( ss_threadpool_new(&p, &st_r.a, threads, sr_seq_test_thread, &fail) == 0 );
+		t( ss_threadpool_shutdown(&p, &st_r.a) == 0 );
+		uint64_t time = ss_utime() - start;
+		if (time == 0)
+			time = 1;
+		uint64_t total = (uint64_t)sr_seq_test_count * threads;
+		fprintf(st_r.output, " %d:%.1fM/s", threads,
+		        (double)total / time);
+		fflush(st_r.output);
+		t( sr_seq(&sr_seq_test_seq, SR_LSN) == total );
+		sr_seqfree(&sr_seq_test_seq);
+	}
+	t( fail == 0 );
+}
+
+stgroup *sr_seq_group(void)
+{
+	stgroup *group = st_group("srseq");
+	st_groupadd(group, st_test("next", sr_seq_test_next));
+	st_groupadd(group, st_test("follow", sr_seq_test_follow));
+	st_groupadd(group, st_test("scale", sr_seq_test_scale));
+	return group;
+}
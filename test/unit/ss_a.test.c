@@ -39,10 +39,75 @@ ssa_realloc(void)
 	ss_aclose(&a);
 }
 
+static void
+ssa_slab(void)
+{
+	ssa std;
+	ss_aopen(&std, &ss_stda);
+	ssa a;
+	t( ss_aopen(&a, &ss_slaba, &std) == 0 );
+	void **objs = malloc(sizeof(void*) * 20000);
+	t( objs != NULL );
+	int i = 0;
+	while (i < 20000) {
+		objs[i] = ss_malloc(&a, 1 + (i % 1500));
+		t( objs[i] != NULL );
+		memset(objs[i], i & 0xff, 1 + (i % 1500));
+		i++;
+	}
+	i = 0;
+	while (i < 20000) {
+		unsigned char *p = objs[i];
+		t( p[0] == (i & 0xff) );
+		t( p[i % 1500] == (i & 0xff) );
+		if (i % 2)
+			ss_free(&a, objs[i]);
+		i++;
+	}
+	i = 0;
+	while (i < 20000) {
+		if ((i % 2) == 0)
+			ss_free(&a, objs[i]);
+		i++;
+	}
+	free(objs);
+	ss_aclose(&a);
+	ss_aclose(&std);
+}
+
+static void
+ssa_slab_realloc(void)
+{
+	ssa std;
+	ss_aopen(&std, &ss_stda);
+	ssa a;
+	t( ss_aopen(&a, &ss_slaba, &std) == 0 );
+	char *buf = ss_malloc(&a, 16);
+	t( buf != NULL );
+	memcpy(buf, "0123456789abcdef", 16);
+	buf = ss_realloc(&a, buf, 321);
+	t( buf != NULL );
+	t( memcmp(buf, "0123456789abcdef", 16) == 0 );
+	buf = ss_realloc(&a, buf, 4000);
+	t( buf != NULL );
+	t( memcmp(buf, "0123456789abcdef", 16) == 0 );
+	buf = ss_realloc(&a, buf, 8000);
+	t( buf != NULL );
+	t( memcmp(buf, "0123456789abcdef", 16) == 0 );
+	buf = ss_realloc(&a, buf, 16);
+	t( buf != NULL );
+	t( memcmp(buf, "0123456789abcdef", 16) == 0 );
+	ss_free(&a, buf);
+	ss_aclose(&a);
+	ss_aclose(&std);
+}
+
 stgroup *ss_a_group(void)
 {
 	stgroup *group = st_group("ssa");
 	st_groupadd(group, st_test("malloc", ssa_malloc));
 	st_groupadd(group, st_test("realloc", ssa_realloc));
+	st_groupadd(group, st_test("slab", ssa_slab));
+	st_groupadd(group, st_test("slab_realloc", ssa_slab_realloc));
 	return group;
 }
@@ -0,0 +1,88 @@
+
+/*
+ * sophia database
+ * sphia.org
+ *
+ * Copyright (c) Dmitry Simonenko
+ * BSD License
+*/
+
+#include <sophia.h>
+#include <libss.h>
+#include <libsf.h>
+#include <libsr.h>
+#include <libsv.h>
+#include <libso.h>
+#include <libst.h>
+
+static void
+ss_hist_bucket(void)
+{
+	uint32_t v = 0;
+	while (v < 100000) {
+		int bucket = ss_histbucket(v);
+		t( bucket < SS_HIST_BUCKETS );
+		t( ss_histvalue(bucket) >= v );
+		if (bucket > 0)
+			t( ss_histvalue(bucket - 1) < v );
+		v++;
+	}
+	t( ss_histbucket(UINT32_MAX) == SS_HIST_BUCKETS - 1 );
+	t( ss_histvalue(SS_HIST_BUCKETS - 1) == UINT32_MAX );
+}
+
+static void
+ss_hist_percentile(void)
+{
+	sshist h;
+	ss_histinit(&h);
+	t( ss_histpercentile(&h, 99.0) == 0 );
+	uint32_t i = 1;
+	while (i <= 1000) {
+		ss_histadd(&h, i);
+		i++;
+	}
+	t( h.count == 1000 );
+	t( h.min == 1 );
+	t( h.max == 1000 );
+	uint32_t p50 = ss_histpercentile(&h, 50.0);
+	uint32_t p99 = ss_histpercentile(&h, 99.0);
+	t( p50 >= 500 && p50 <= 500 * 1.125 );
+	t( p99 >= 990 && p99 <= 1000 );
+	t( ss_histpercentile(&h, 100.0) == 1000 );
+}
+
+static void
+ss_hist_merge(void)
+{
+	sshist a, b;
+	ss_histinit(&a);
+	ss_histinit(&b);
+	int i = 0;
+	while (i < 990) {
+		ss_histadd(&a, 10);
+		i++;
+	}
+	while (i < 1000) {
+		ss_histadd(&b, 5000);
+		i++;
+	}
+	ss_histmerge(&a, &b);
+	t( a.count == 1000 );
+	t( a.min == 10 );
+	t( a.max == 5000 );
+	t( ss_histpercentile(&a, 50.0) == 10 );
+	t( ss_histpercentile(&a, 99.9) >= 5000 );
+	char sz[SS_HIST_SZ];
+	ss_histprepare(&a, sz, sizeof(sz));
+	t( strncmp(sz, "10 5000 ", 8) == 0 );
+}
+
+stgroup *ss_hist_group(void)
+{
+	stgroup *group = st_group("sshist");
+	st_groupadd(group, st_test("bucket", ss_hist_bucket));
+	st_groupadd(group, st_test("percentile", ss_hist_percentile));
+	st_groupadd(group, st_test("merge", ss_hist_merge));
+	return group;
+}
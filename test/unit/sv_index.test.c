@@ -29,7 +29,7 @@ static void
 sv_index_replace0(void)
 {
 	svindex i;
-	t( sv_indexinit(&i) == 0 );
+	t( sv_indexinit(&i, SV_INDEXRB) == 0 );
 
 	uint32_t key = 7;
 	svv *h = st_svv(&st_r.g, NULL, 0, 0, key, NULL, 0);
@@ -50,9 +50,66 @@ sv_index_replace0(void)
 	sv_indexfree(&i, &st_r.r);
 }
 
+static void
+sv_index_btree_replace0(void)
+{
+	svindex i;
+	t( sv_indexinit(&i, SV_INDEXBTREE) == 0 );
+
+	uint32_t key = 7;
+	svv *h = st_svv(&st_r.g, NULL, 0, 0, key, NULL, 0);
+	svv *n = st_svv(&st_r.g, NULL, 1, 0, key, NULL, 0);
+
+	t( sv_indexset(&i, &st_r.r, h) == 0 );
+	t( sv_indexset(&i, &st_r.r, n) == 0 );
+	t( i.count == 2 );
+
+	svv *keyv = st_svv(&st_r.g, &st_r.gc, 0, 0, key, NULL, 0);
+	svindexpos pos;
+	svv *p = sv_indexget(&i, &st_r.r, &pos, keyv);
+	t( p == n );
+	t( n->next == h );
+	t( sv_vvisible(p, &st_r.r, 0) == h );
+
+	sv_indexfree(&i, &st_r.r);
+}
+
+static void
+sv_index_btree_reserve(void)
+{
+	svindex i;
+	t( sv_indexinit(&i, SV_INDEXBTREE) == 0 );
+	svbtreepool pool;
+	sv_btreepool_init(&pool);
+
+	/* inserts take split nodes from the reservation */
+	uint32_t key = 0;
+	while (key < 2000) {
+		uint32_t reserve;
+		t( sv_btreereserve(&pool, &st_r.r, 1, &reserve) == 0 );
+		t( reserve == pool.height + 2 );
+		t( pool.count >= reserve );
+		svv *v = st_svv(&st_r.g, NULL, key, 0, key, NULL, 0);
+		svindexpos pos;
+		sv_indexget(&i, &st_r.r, &pos, v);
+		t( sv_indexupdate(&i, &st_r.r, &pool, &pos, v) == 0 );
+		sv_btreerelease(&pool, &st_r.r, reserve);
+		key++;
+	}
+	t( i.count == 2000 );
+	t( pool.height == i.bt.height );
+	t( pool.reserved == 0 );
+	t( pool.count <= SV_BTREE_SPARE );
+
+	sv_btreepool_free(&pool, &st_r.r);
+	sv_indexfree(&i, &st_r.r);
+}
+
 stgroup *sv_index_group(void)
 {
 	stgroup *group = st_group("svindex");
 	st_groupadd(group, st_test("replace0", sv_index_replace0));
+	st_groupadd(group, st_test("btree_replace0", sv_index_btree_replace0));
+	st_groupadd(group, st_test("btree_reserve", sv_index_btree_reserve));
 	return group;
 }
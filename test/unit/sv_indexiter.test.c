@@ -18,7 +18,7 @@ static void
 sv_indexiter_lte_empty(void)
 {
 	svindex i;
-	t( sv_indexinit(&i) == 0 );
+	t( sv_indexinit(&i, SV_INDEXRB) == 0 );
 
 	ssiter it;
 	ss_iterinit(sv_indexiter, &it);
@@ -33,7 +33,7 @@ static void
 sv_indexiter_lte_eq(void)
 {
 	svindex i;
-	t( sv_indexinit(&i) == 0 );
+	t( sv_indexinit(&i, SV_INDEXRB) == 0 );
 
 	int keya = 7;
 	int keyb = 5;
@@ -71,7 +71,7 @@ static void
 sv_indexiter_lt_eq(void)
 {
 	svindex i;
-	t( sv_indexinit(&i) == 0 );
+	t( sv_indexinit(&i, SV_INDEXRB) == 0 );
 
 	int keya = 7;
 	int keyb = 5;
@@ -109,7 +109,7 @@ static void
 sv_indexiter_gte_empty(void)
 {
 	svindex i;
-	t( sv_indexinit(&i) == 0 );
+	t( sv_indexinit(&i, SV_INDEXRB) == 0 );
 
 	svv *key = st_svv(&st_r.g, NULL, 0, 0, 7, NULL, 0);
 	ssiter it;
@@ -127,7 +127,7 @@ static void
 sv_indexiter_gte_eq(void)
 {
 	svindex i;
-	t( sv_indexinit(&i) == 0 );
+	t( sv_indexinit(&i, SV_INDEXRB) == 0 );
 
 	int keya = 7;
 	int keyb = 5;
@@ -165,7 +165,7 @@ static void
 sv_indexiter_gt_eq(void)
 {
 	svindex i;
-	t( sv_indexinit(&i) == 0 );
+	t( sv_indexinit(&i, SV_INDEXRB) == 0 );
 
 	int keya = 7;
 	int keyb = 5;
@@ -203,7 +203,7 @@ static void
 sv_indexiter_iterate0(void)
 {
 	svindex i;
-	t( sv_indexinit(&i) == 0 );
+	t( sv_indexinit(&i, SV_INDEXRB) == 0 );
 
 	int keyb = 3;
 	int keya = 7;
@@ -256,7 +256,7 @@ static void
 sv_indexiter_iterate1(void)
 {
 	svindex i;
-	t( sv_indexinit(&i) == 0 );
+	t( sv_indexinit(&i, SV_INDEXRB) == 0 );
 
 	int j = 0;
 	while (j < 16) {
@@ -280,6 +280,97 @@ sv_indexiter_iterate1(void)
 	sv_indexfree(&i, &st_r.r);
 }
 
+static void
+sv_indexiter_btree(void)
+{
+	svindex i;
+	t( sv_indexinit(&i, SV_INDEXBTREE) == 0 );
+
+	/* odd keys in shuffled order, every fifth key
+	 * gets a second version */
+	int count = 4000;
+	int j = 0;
+	while (j < count) {
+		uint32_t key = ((j * 1031) % count) * 2 + 1;
+		svv *v = st_svv(&st_r.g, NULL, j, 0, key, NULL, 0);
+		t( sv_indexset(&i, &st_r.r, v) == 0 );
+		if ((key % 10) == 1) {
+			v = st_svv(&st_r.g, NULL, count + j, 0, key, NULL, 0);
+			t( sv_indexset(&i, &st_r.r, v) == 0 );
+		}
+		j++;
+	}
+	t( i.bt.height > 1 );
+
+	/* ordered scans */
+	ssiter it;
+	ss_iterinit(sv_indexiter, &it);
+	ss_iteropen(sv_indexiter, &it, &st_r.r, &i, SS_GTE, NULL);
+	uint32_t prev = 0;
+	j = 0;
+	while (ss_iteratorhas(&it)) {
+		svv *v = sv_vv(ss_iteratorof(&it));
+		uint32_t key = *(uint32_t*)sf_field(st_r.r.scheme, 0, sv_vpointer(v), &st_r.size);
+		t( key >= prev );
+		prev = key;
+		ss_iteratornext(&it);
+		j++;
+	}
+	t( j == count + count / 5 );
+
+	ss_iterinit(sv_indexiter, &it);
+	ss_iteropen(sv_indexiter, &it, &st_r.r, &i, SS_LTE, NULL);
+	prev = UINT32_MAX;
+	j = 0;
+	while (ss_iteratorhas(&it)) {
+		svv *v = sv_vv(ss_iteratorof(&it));
+		uint32_t key = *(uint32_t*)sf_field(st_r.r.scheme, 0, sv_vpointer(v), &st_r.size);
+		t( key <= prev );
+		prev = key;
+		ss_iteratornext(&it);
+		j++;
+	}
+	t( j == count + count / 5 );
+
+	/* positioning on present and missing keys */
+	uint32_t probe = 0;
+	while (probe <= (uint32_t)count * 2) {
+		svv *keyv = st_svv(&st_r.g, &st_r.gc, 0, 0, probe, NULL, 0);
+		int present = (probe % 2) == 1;
+		ssorder orders[] = { SS_GTE, SS_GT, SS_LTE, SS_LT };
+		int k = 0;
+		while (k < 4) {
+			ss_iterinit(sv_indexiter, &it);
+			int eq = ss_iteropen(sv_indexiter, &it, &st_r.r, &i, orders[k],
+			                     sv_vpointer(keyv));
+			t( eq == present );
+			int64_t expect;
+			switch (orders[k]) {
+			case SS_GTE: expect = present ? probe : probe + 1;
+				break;
+			case SS_GT:  expect = present ? probe + 2 : probe + 1;
+				break;
+			case SS_LTE: expect = present ? probe : (int64_t)probe - 1;
+				break;
+			default:     expect = present ? (int64_t)probe - 2 : (int64_t)probe - 1;
+				break;
+			}
+			if (expect < 1 || expect > count * 2 - 1) {
+				t( ss_iteratorhas(&it) == 0 );
+			} else {
+				t( ss_iteratorhas(&it) != 0 );
+				svv *v = sv_vv(ss_iteratorof(&it));
+				uint32_t key = *(uint32_t*)sf_field(st_r.r.scheme, 0, sv_vpointer(v), &st_r.size);
+				t( key == expect );
+			}
+			k++;
+		}
+		probe++;
+	}
+
+	sv_indexfree(&i, &st_r.r);
+}
+
 stgroup *sv_indexiter_group(void)
 {
 	stgroup *group = st_group("svindexiter");
@@ -291,5 +382,6 @@ stgroup *sv_indexiter_group(void)
 	st_groupadd(group, st_test("gt_eq", sv_indexiter_gt_eq));
 	st_groupadd(group, st_test("iterate0", sv_indexiter_iterate0));
 	st_groupadd(group, st_test("iterate1", sv_indexiter_iterate1));
+	st_groupadd(group, st_test("btree", sv_indexiter_btree));
 	return group;
 }
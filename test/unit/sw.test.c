@@ -68,16 +68,15 @@ sw_begin_commit(void)
 	alloclogv(&log, &st_r.r, 0, 0, 7);
 
 	swtx ltx;
-	t( sw_begin(&lp, &ltx, 0, 0) == 0 );
-	t( sw_write(&ltx, &log) == 0 );
-	t( sw_commit(&ltx) == 0 );
+	t( sw_begin(&lp, &ltx, &log, 0, 0) == 0 );
+	t( sw_write(&ltx) == 0 );
 
 	freelog(&log, &st_r.r);
 	t( sw_managershutdown(&lp) == 0 );
 }
 
 static void
-sw_begin_rollback(void)
+sw_begin_order(void)
 {
 	swmanager lp;
 	t( sw_managerinit(&lp, &st_r.r) == 0 );
@@ -91,15 +90,81 @@ sw_begin_rollback(void)
 	svlog log;
 	sv_loginit(&log, &st_r.r, 1);
 	sv_loginit_index(&log, 0, &st_r.r);
+	alloclogv(&log, &st_r.r, 0, 0, 7);
+
+	svlog log2;
+	sv_loginit(&log2, &st_r.r, 1);
+	sv_loginit_index(&log2, 0, &st_r.r);
+	alloclogv(&log2, &st_r.r, 0, 0, 8);
+
+	/* transactions are written in the begin order */
+	swtx ltx, ltx2;
+	t( sw_begin(&lp, &ltx, &log, 0, 0) == 0 );
+	t( sw_begin(&lp, &ltx2, &log2, 0, 0) == 0 );
+	t( ltx.lsn < ltx2.lsn );
+	t( sw_write(&ltx2) == 0 );
+	t( sw_write(&ltx) == 0 );
+
+	freelog(&log, &st_r.r);
+	freelog(&log2, &st_r.r);
+
+	sw *current = sscast(lp.list.prev, sw, link);
+	ssiter li;
+	ss_iterinit(sw_iter, &li);
+	t( ss_iteropen(sw_iter, &li, &st_r.r, &current->file, 1) == 0 );
+	int key = 7;
+	for (;;) {
+		while (ss_iteratorhas(&li)) {
+			swv *v = ss_iteratorof(&li);
+			t( *(int*)sf_field(st_r.r.scheme, 0, sw_vpointer(v), &st_r.size) == key );
+			key++;
+			ss_iteratornext(&li);
+		}
+		t( sw_iter_error(&li) == 0 );
+		if (! sw_iter_continue(&li) )
+			break;
+	}
+	ss_iteratorclose(&li);
+	t( key == 9 );
+
+	t( sw_managershutdown(&lp) == 0 );
+}
 
+static void
+sw_group_commit(void)
+{
+	swmanager lp;
+	t( sw_managerinit(&lp, &st_r.r) == 0 );
+	swconf *conf = sw_conf(&lp);
+	conf->path         = strdup(st_r.conf->log_dir);
+	conf->enable       = 1;
+	conf->rotatewm     = 1000;
+	conf->group_commit = 1;
+	t( sw_manageropen(&lp) == 0 );
+	t( sw_managerrotate(&lp) == 0 );
+
+	svlog log;
+	sv_loginit(&log, &st_r.r, 1);
+	sv_loginit_index(&log, 0, &st_r.r);
 	alloclogv(&log, &st_r.r, 0, 0, 7);
 
-	swtx ltx;
-	t( sw_begin(&lp, &ltx, 0, 0) == 0 );
-	t( sw_write(&ltx, &log) == 0 );
-	t( sw_rollback(&ltx) == 0 );
+	svlog log2;
+	sv_loginit(&log2, &st_r.r, 1);
+	sv_loginit_index(&log2, 0, &st_r.r);
+	alloclogv(&log2, &st_r.r, 0, 0, 8);
+
+	/* the first writer takes all queued transactions */
+	swtx ltx, ltx2;
+	t( sw_begin(&lp, &ltx, &log, 0, 0) == 0 );
+	t( sw_begin(&lp, &ltx2, &log2, 0, 0) == 0 );
+	t( sw_write(&ltx) == 0 );
+	t( ltx2.done == 1 );
+	t( sw_write(&ltx2) == 0 );
+	t( lp.commits == 2 );
+	t( lp.writes == 1 );
 
 	freelog(&log, &st_r.r);
+	freelog(&log2, &st_r.r);
 	t( sw_managershutdown(&lp) == 0 );
 }
 
@@ -107,6 +172,7 @@ stgroup *sw_group(void)
 {
 	stgroup *group = st_group("sw");
 	st_groupadd(group, st_test("begin_commit", sw_begin_commit));
-	st_groupadd(group, st_test("begin_rollback", sw_begin_rollback));
+	st_groupadd(group, st_test("begin_order", sw_begin_order));
+	st_groupadd(group, st_test("group_commit", sw_group_commit));
 	return group;
 }
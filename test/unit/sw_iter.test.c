@@ -67,9 +67,8 @@ sw_itertx(void)
 	alloclogv(&log, &st_r.r, 0, 7);
 
 	swtx ltx;
-	t( sw_begin(&lp, &ltx, 0, 0) == 0 );
-	t( sw_write(&ltx, &log) == 0 );
-	t( sw_commit(&ltx) == 0 );
+	t( sw_begin(&lp, &ltx, &log, 0, 0) == 0 );
+	t( sw_write(&ltx) == 0 );
 
 	freelog(&log, &st_r.r);
 	t( sw_managershutdown(&lp) == 0 );
@@ -128,9 +127,8 @@ sw_itertx_read0(void)
 	sv_loginit_index(&log, 0, &st_r.r);
 	alloclogv(&log, &st_r.r, 0, 7);
 	swtx ltx;
-	t( sw_begin(&lp, &ltx, 0, 0) == 0 );
-	t( sw_write(&ltx, &log) == 0 );
-	t( sw_commit(&ltx) == 0 );
+	t( sw_begin(&lp, &ltx, &log, 0, 0) == 0 );
+	t( sw_write(&ltx) == 0 );
 	freelog(&log, &st_r.r);
 
 	sw *current = sscast(lp.list.prev, sw, link);
@@ -172,9 +170,8 @@ sw_itertx_read1(void)
 	alloclogv(&log, &st_r.r, 0, 8);
 	alloclogv(&log, &st_r.r, 0, 9);
 	swtx ltx;
-	t( sw_begin(&lp, &ltx, 0, 0) == 0 );
-	t( sw_write(&ltx, &log) == 0 );
-	t( sw_commit(&ltx) == 0 );
+	t( sw_begin(&lp, &ltx, &log, 0, 0) == 0 );
+	t( sw_write(&ltx) == 0 );
 	freelog(&log, &st_r.r);
 
 	sw *current = sscast(lp.list.prev, sw, link);
@@ -225,13 +222,11 @@ sw_itertx_read2(void)
 	alloclogv(&log, &st_r.r, 0, 8);
 	alloclogv(&log, &st_r.r, 0, 9);
 	swtx ltx;
-	t( sw_begin(&lp, &ltx, 0, 0) == 0 );
-	t( sw_write(&ltx, &log) == 0 );
-	t( sw_commit(&ltx) == 0 );
+	t( sw_begin(&lp, &ltx, &log, 0, 0) == 0 );
+	t( sw_write(&ltx) == 0 );
 
-	t( sw_begin(&lp, &ltx, 0, 0) == 0 );
-	t( sw_write(&ltx, &log) == 0 );
-	t( sw_commit(&ltx) == 0 );
+	t( sw_begin(&lp, &ltx, &log, 0, 0) == 0 );
+	t( sw_write(&ltx) == 0 );
 	freelog(&log, &st_r.r);
 
 	sw *current = sscast(lp.list.prev, sw, link);
@@ -281,9 +276,8 @@ sw_itertx_read3(void)
 	sv_loginit_index(&log, 0, &st_r.r);
 	alloclogv(&log, &st_r.r, 0, 7); /* single stmt */
 	swtx ltx;
-	t( sw_begin(&lp, &ltx, 0, 0) == 0 );
-	t( sw_write(&ltx, &log) == 0 );
-	t( sw_commit(&ltx) == 0 );
+	t( sw_begin(&lp, &ltx, &log, 0, 0) == 0 );
+	t( sw_write(&ltx) == 0 );
 	freelog(&log, &st_r.r);
 
 	sv_loginit(&log, &st_r.r, 1);
@@ -291,9 +285,8 @@ sw_itertx_read3(void)
 	alloclogv(&log, &st_r.r, 0, 8); /* multi stmt */
 	alloclogv(&log, &st_r.r, 0, 9);
 	alloclogv(&log, &st_r.r, 0, 10);
-	t( sw_begin(&lp, &ltx, 0, 0) == 0 );
-	t( sw_write(&ltx, &log) == 0 );
-	t( sw_commit(&ltx) == 0 );
+	t( sw_begin(&lp, &ltx, &log, 0, 0) == 0 );
+	t( sw_write(&ltx) == 0 );
 	freelog(&log, &st_r.r);
 
 	sv_loginit(&log, &st_r.r, 1);
@@ -301,17 +294,15 @@ sw_itertx_read3(void)
 	alloclogv(&log, &st_r.r, 0, 11); /* multi stmt */
 	alloclogv(&log, &st_r.r, 0, 12);
 	alloclogv(&log, &st_r.r, 0, 13);
-	t( sw_begin(&lp, &ltx, 0, 0) == 0 );
-	t( sw_write(&ltx, &log) == 0 );
-	t( sw_commit(&ltx) == 0 );
+	t( sw_begin(&lp, &ltx, &log, 0, 0) == 0 );
+	t( sw_write(&ltx) == 0 );
 	freelog(&log, &st_r.r);
 
 	sv_loginit(&log, &st_r.r, 1);
 	sv_loginit_index(&log, 0, &st_r.r);
 	alloclogv(&log, &st_r.r, 0, 14); /* single stmt */
-	t( sw_begin(&lp, &ltx, 0, 0) == 0 );
-	t( sw_write(&ltx, &log) == 0 );
-	t( sw_commit(&ltx) == 0 );
+	t( sw_begin(&lp, &ltx, &log, 0, 0) == 0 );
+	t( sw_write(&ltx) == 0 );
 	freelog(&log, &st_r.r);
 
 	int state = 0;